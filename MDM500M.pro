@@ -1,3 +1,6 @@
 TEMPLATE = subdirs
 
-SUBDIRS = src
+SUBDIRS = src daemon tests
+
+# Имитатор работает через псевдотерминалы
+unix: SUBDIRS += simulator
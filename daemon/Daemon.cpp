@@ -0,0 +1,266 @@
+#include <map>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QSocketNotifier>
+#include <QTimer>
+
+#ifdef Q_OS_UNIX
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "Daemon.h"
+#include "DeviceCache.h"
+#include "DeviceController.h"
+#include "DeviceDiscovery.h"
+#include "DeviceSupervisor.h"
+#include "EventLog.h"
+#include "LinkReactor.h"
+#include "LinkStatistics.h"
+#include "Modules.h"
+#include "NameRepository.h"
+#include "PollScheduler.h"
+#include "Transactions.h"
+#include "Transport.h"
+
+using namespace std::chrono;
+
+namespace {
+
+#ifdef Q_OS_UNIX
+int signalPipe[2] = { -1, -1 };
+
+void onSignal(int)
+{
+    // В обработчике сигнала допустима только запись в дескриптор
+    char byte = 1;
+    auto written = ::write(signalPipe[1], &byte, sizeof(byte));
+    Q_UNUSED(written);
+}
+#endif
+
+} // namespace
+
+Daemon::Daemon(const QString &configFile, QObject *parent)
+    : QObject(parent)
+    , m_configFile(configFile)
+    , m_reactor(std::make_shared<LinkReactor>())
+{
+}
+
+Daemon::~Daemon()
+{
+    m_supervisor.reset();
+    if (!m_statisticsLog.isEmpty()) {
+        LinkStatistics::dumpAll(m_statisticsLog);
+    }
+}
+
+void Daemon::setFirmwareFile(const QString &fileName)
+{
+    m_firmwareFile = fileName;
+}
+
+bool Daemon::start()
+{
+    if (!QFileInfo::exists(m_configFile)) {
+        qWarning("Файл настроек %s не найден", qPrintable(m_configFile));
+        return false;
+    }
+    QSettings settings(m_configFile, QSettings::Format::IniFormat);
+
+    m_directory = settings.value("files/directory", QDir::currentPath()).toString();
+    if (!QDir().mkpath(m_directory)) {
+        qWarning("Не удалось создать каталог %s", qPrintable(m_directory));
+        return false;
+    }
+    EventLog::setBaseDirectory(m_directory);
+    m_statisticsLog = path(settings.value("files/statistics", "statistics.log").toString());
+    m_cache = std::make_shared<DeviceCache>(path(settings.value("files/cache", "devices.cache.ini").toString()));
+
+    auto transports = settings.value("ports/transports").toStringList();
+    for (auto &&address : transports) {
+        if (!Transport::isValidAddress(address)) {
+            qWarning("Неверный адрес в ports/transports: %s", qPrintable(address));
+        }
+    }
+    m_supervisor = std::make_unique<DeviceSupervisor>(m_reactor, transports, m_cache);
+    m_supervisor->discovery().setSerialPortsScanned(settings.value("ports/scanSerialPorts", true).toBool());
+    m_supervisor->setFootprintLog(path(settings.value("files/footprint", "footprint.log").toString()));
+
+    PollScheduler::Intervals intervals;
+    intervals.fast = milliseconds(settings.value("poll/fast", static_cast<int>(intervals.fast.count())).toInt());
+    intervals.slow = milliseconds(settings.value("poll/slow", static_cast<int>(intervals.slow.count())).toInt());
+    intervals.max = milliseconds(settings.value("poll/max", static_cast<int>(intervals.max.count())).toInt());
+    if (intervals.fast.count() <= 0 || intervals.fast > intervals.slow || intervals.slow > intervals.max) {
+        qWarning("Неверные интервалы опроса: требуется 0 < fast <= slow <= max");
+        return false;
+    }
+    auto &&scheduler = m_supervisor->scheduler();
+    scheduler.setIntervals(intervals);
+    scheduler.setBudget(settings.value("poll/budget", scheduler.budget()).toDouble());
+
+    if (!m_firmwareFile.isEmpty()) {
+        if (!loadFirmware()) {
+            return false;
+        }
+        m_rolloutSettings.parallelism = settings.value("rollout/parallelism", m_rolloutSettings.parallelism).toInt();
+        m_rolloutSettings.canaries = settings.value("rollout/canaries", m_rolloutSettings.canaries).toInt();
+        m_rolloutSettings.maxFailures = settings.value("rollout/maxFailures", m_rolloutSettings.maxFailures).toInt();
+        QTimer::singleShot(settings.value("rollout/delay", 10000).toInt(), this, &Daemon::startRollout);
+    }
+
+    DeviceControllerBuilder builder;
+    builder.type = DeviceType::MDM500M;
+    builder.moduleFabric = std::make_shared<ModuleFabric>();
+    builder.nameRepo = std::make_shared<NameRepository>(
+                new QFile(path(settings.value("files/names", "devices.xml").toString())));
+    builder.transactionFabric = std::make_shared<MDM500M::TransactionFabric>();
+    m_supervisor->setBuilder(DeviceType::MDM500M, builder);
+    builder.type = DeviceType::MDM500;
+    builder.transactionFabric = std::make_shared<MDM500::TransactionFabric>();
+    m_supervisor->setBuilder(DeviceType::MDM500, builder);
+
+    connect(m_supervisor.get(), &DeviceSupervisor::added, this, &Daemon::onAdded);
+    connect(m_supervisor.get(), &DeviceSupervisor::removed, this, &Daemon::onRemoved);
+    installSignalHandlers();
+    m_supervisor->start();
+    qInfo("Поиск устройств начат, настройки: %s", qPrintable(m_configFile));
+    return true;
+}
+
+void Daemon::onAdded(DeviceController *controller)
+{
+    auto address = controller->address();
+    qInfo("%s: найдено устройство %s", qPrintable(address), qPrintable(controller->device().type()));
+    connect(controller, &DeviceController::ready, this, [=]
+    {
+        auto &&device = controller->device();
+        qInfo("%s: %s \"%s\", серийный номер %s", qPrintable(address),
+              qPrintable(device.type()), qPrintable(device.name()), qPrintable(device.serialNumber()));
+    });
+    connect(controller, &DeviceController::logFailed, this, [=](const QString &message)
+    {
+        qWarning("%s: %s", qPrintable(address), qPrintable(message));
+    });
+}
+
+void Daemon::onRemoved(DeviceController *controller)
+{
+    qInfo("%s: устройство отключено", qPrintable(controller->address()));
+}
+
+bool Daemon::loadFirmware()
+{
+    m_firmware = Firmware(m_firmwareFile);
+    if (m_firmware.isError()) {
+        qWarning("Ошибка при открытии файла прошивки %s: %s",
+                 qPrintable(m_firmwareFile), qPrintable(m_firmware.errorString()));
+        return false;
+    }
+    if (!m_firmware.isCompatible(MDM500M::kHardwareVersion)) {
+        qWarning("Прошивка %s не предназначена для МДМ-500М", qPrintable(m_firmwareFile));
+        return false;
+    }
+    return true;
+}
+
+void Daemon::startRollout()
+{
+    const auto version = m_firmware.softwareVersion();
+    // Контроллер может быть удален до конца обновления, поэтому адреса
+    // запоминаются заранее
+    std::map<const DeviceController *, QString> addresses;
+    std::vector<DeviceController *> devices;
+    for (auto &&controller : m_supervisor->controllers()) {
+        auto address = controller->address();
+        auto &&device = controller->device();
+        if (!controller->isReady()) {
+            qWarning("%s: устройство не прочитано, прошивка не обновляется", qPrintable(address));
+            continue;
+        }
+        if (device.isMDM500() || !m_firmware.isCompatible(device.data().info.hardwareVersion)) {
+            qWarning("%s: прошивка не предназначена для %s", qPrintable(address), qPrintable(device.type()));
+            continue;
+        }
+        if (device.softwareVersion() >= version) {
+            qInfo("%s: версия прошивки %s не старше обновления", qPrintable(address),
+                  qPrintable(device.softwareVersion().toString()));
+            continue;
+        }
+        addresses[controller] = address;
+        devices.push_back(controller);
+    }
+    qInfo("Обновление прошивки до версии %s, устройств: %d",
+          qPrintable(version.toString()), static_cast<int>(devices.size()));
+
+    m_rollout = new FirmwareRollout(m_firmware, devices, this);
+    m_rollout->setSettings(m_rolloutSettings);
+    connect(m_rollout, &FirmwareRollout::deviceStarted, this, [=](DeviceController *controller)
+    {
+        qInfo("%s: обновление прошивки начато", qPrintable(addresses.at(controller)));
+    });
+    connect(m_rollout, &FirmwareRollout::deviceFinished, this, [=](DeviceController *controller, bool succeeded)
+    {
+        if (succeeded) {
+            qInfo("%s: прошивка обновлена", qPrintable(addresses.at(controller)));
+        }
+        else {
+            qWarning("%s: не удалось обновить прошивку", qPrintable(addresses.at(controller)));
+        }
+    });
+    connect(m_rollout, &FirmwareRollout::finished, this, &Daemon::onRolloutFinished);
+    m_rollout->start();
+}
+
+void Daemon::onRolloutFinished(bool completed)
+{
+    using State = FirmwareRollout::State;
+
+    const int failed = m_rollout->count(State::Failed);
+    qInfo("Обновление прошивки %s: успешно %d, с ошибкой %d, пропущено %d",
+          completed ? "завершено" : "остановлено",
+          m_rollout->count(State::Succeeded), failed, m_rollout->count(State::Skipped));
+    QCoreApplication::exit(completed && failed == 0 ? 0 : 1);
+}
+
+QString Daemon::path(const QString &fileName) const
+{
+    return QDir(m_directory).absoluteFilePath(fileName);
+}
+
+void Daemon::installSignalHandlers()
+{
+#ifdef Q_OS_UNIX
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, signalPipe) != 0) {
+        qWarning("Не удалось установить обработчики сигналов");
+        return ;
+    }
+    m_signalNotifier = new QSocketNotifier(signalPipe[0], QSocketNotifier::Read, this);
+    connect(m_signalNotifier, &QSocketNotifier::activated, this, [this]
+    {
+        char byte;
+        auto received = ::read(signalPipe[0], &byte, sizeof(byte));
+        Q_UNUSED(received);
+        if (m_rollout && !m_rollout->isFinished()) {
+            // Прерванная запись страниц оставила бы устройство без прошивки
+            qInfo("Получен сигнал завершения, ожидание начатых обновлений прошивки");
+            m_rollout->halt();
+            return ;
+        }
+        qInfo("Получен сигнал завершения");
+        QCoreApplication::quit();
+    });
+    struct sigaction action {};
+    action.sa_handler = onSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGINT, &action, nullptr);
+#endif
+}
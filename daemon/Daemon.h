@@ -0,0 +1,92 @@
+#pragma once
+
+#include <memory>
+
+#include <QObject>
+#include <QString>
+
+#include "Firmware.h"
+#include "FirmwareRollout.h"
+
+class DeviceCache;
+class DeviceController;
+class DeviceSupervisor;
+class LinkReactor;
+class QSocketNotifier;
+
+/**
+ * @brief Наблюдение за устройствами без графического интерфейса
+ *
+ * Создает те же DeviceSupervisor, DeviceController и EventLog, что и
+ * программа с окном, но вместо вкладок только пишет в журнал о
+ * подключении и отключении устройств. Параметры читаются из INI-файла:
+ *
+ * @code
+ * [ports]
+ * transports=tcp://10.0.0.5:4001, pty:/dev/pts/3 ; см. Transport::create
+ * scanSerialPorts=true                           ; проверять все COM-порты
+ *
+ * [poll]
+ * fast=800      ; мс, устройства с аварией
+ * slow=10000    ; мс, предел адаптивного интервала
+ * max=60000     ; мс, предел при нехватке бюджета
+ * budget=8      ; доля постоянно занятой линии
+ *
+ * [files]
+ * directory=/var/lib/mdm500m ; каталог для журналов и файлов ниже
+ * names=devices.xml
+ * cache=devices.cache.ini
+ * footprint=footprint.log
+ * statistics=statistics.log
+ *
+ * [rollout]
+ * delay=10000   ; мс ожидания подключения устройств перед обновлением
+ * parallelism=4 ; см. FirmwareRollout::Settings
+ * canaries=1
+ * maxFailures=1
+ * @endcode
+ *
+ * Относительные имена файлов отсчитываются от files/directory. На Unix
+ * SIGTERM и SIGINT завершают работу после записи статистики.
+ *
+ * Если задан файл прошивки (setFirmwareFile()), через rollout/delay после
+ * начала поиска прошивка обновляется на всех готовых совместимых
+ * устройствах с более старой версией, после чего работа завершается с
+ * кодом 0, только если все обновления успешны. Сигнал завершения во время
+ * обновления не прерывает начатые прошивки, а только не дает начать новые.
+ */
+class Daemon : public QObject
+{
+    Q_OBJECT
+
+public:
+    Daemon(const QString &configFile, QObject *parent = nullptr);
+    ~Daemon() override;
+
+    /**
+     * @brief Обновить прошивку устройств; задается до start()
+     */
+    void setFirmwareFile(const QString &fileName);
+    bool start();
+
+private:
+    void onAdded(DeviceController *controller);
+    void onRemoved(DeviceController *controller);
+    bool loadFirmware();
+    void startRollout();
+    void onRolloutFinished(bool completed);
+    QString path(const QString &fileName) const;
+    void installSignalHandlers();
+
+    QString m_configFile;
+    QString m_directory;
+    QString m_statisticsLog;
+    QString m_firmwareFile;
+    Firmware m_firmware;
+    FirmwareRollout::Settings m_rolloutSettings;
+    FirmwareRollout *m_rollout = nullptr;
+    std::shared_ptr<LinkReactor> m_reactor;
+    std::shared_ptr<DeviceCache> m_cache;
+    std::unique_ptr<DeviceSupervisor> m_supervisor;
+    QSocketNotifier *m_signalNotifier = nullptr;
+};
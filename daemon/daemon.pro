@@ -0,0 +1,86 @@
+QT -= gui
+QT += serialport network
+
+CONFIG += c++14 console
+CONFIG -= app_bundle
+
+TARGET = mdm500m-daemon
+
+win32: LIBS += -lpsapi
+
+SRC = $$PWD/../src
+INCLUDEPATH += $$SRC
+
+HEADERS += \
+    Daemon.h \
+    $$SRC/Types.h \
+    $$SRC/Cancelation.h \
+    $$SRC/InterruptibleWait.h \
+    $$SRC/Protocol.h \
+    $$SRC/AsyncProtocol.h \
+    $$SRC/FrameDecoder.h \
+    $$SRC/RttEstimator.h \
+    $$SRC/LatencyHistogram.h \
+    $$SRC/LinkStatistics.h \
+    $$SRC/Link.h \
+    $$SRC/Transport.h \
+    $$SRC/SerialTransport.h \
+    $$SRC/TcpTransport.h \
+    $$SRC/LinkReactor.h \
+    $$SRC/LinkSession.h \
+    $$SRC/Device.h \
+    $$SRC/DeviceCache.h \
+    $$SRC/DeviceController.h \
+    $$SRC/DeviceSupervisor.h \
+    $$SRC/DeviceDiscovery.h \
+    $$SRC/PortWatcher.h \
+    $$SRC/PollScheduler.h \
+    $$SRC/Modules.h \
+    $$SRC/ChannelTable.h \
+    $$SRC/Frequency.h \
+    $$SRC/NameRepository.h \
+    $$SRC/EventLog.h \
+    $$SRC/BootLoad.h \
+    $$SRC/Crc16.h \
+    $$SRC/UpdaterProtocol.h \
+    $$SRC/Firmware.h \
+    $$SRC/BootFrames.h \
+    $$SRC/FirmwareRollout.h \
+    $$SRC/TransactionInvoker.h \
+    $$SRC/Transactions.h
+
+SOURCES += \
+    main.cpp \
+    Daemon.cpp \
+    $$SRC/Cancelation.cpp \
+    $$SRC/InterruptibleWait.cpp \
+    $$SRC/Protocol.cpp \
+    $$SRC/AsyncProtocol.cpp \
+    $$SRC/FrameDecoder.cpp \
+    $$SRC/RttEstimator.cpp \
+    $$SRC/LatencyHistogram.cpp \
+    $$SRC/LinkStatistics.cpp \
+    $$SRC/Link.cpp \
+    $$SRC/Transport.cpp \
+    $$SRC/SerialTransport.cpp \
+    $$SRC/TcpTransport.cpp \
+    $$SRC/LinkReactor.cpp \
+    $$SRC/LinkSession.cpp \
+    $$SRC/Device.cpp \
+    $$SRC/DeviceCache.cpp \
+    $$SRC/DeviceController.cpp \
+    $$SRC/DeviceSupervisor.cpp \
+    $$SRC/DeviceDiscovery.cpp \
+    $$SRC/PortWatcher.cpp \
+    $$SRC/PollScheduler.cpp \
+    $$SRC/Modules.cpp \
+    $$SRC/ChannelTable.cpp \
+    $$SRC/NameRepository.cpp \
+    $$SRC/EventLog.cpp \
+    $$SRC/Crc16.cpp \
+    $$SRC/UpdaterProtocol.cpp \
+    $$SRC/Firmware.cpp \
+    $$SRC/BootFrames.cpp \
+    $$SRC/FirmwareRollout.cpp \
+    $$SRC/TransactionInvoker.cpp \
+    $$SRC/Transactions.cpp
@@ -0,0 +1,30 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+
+#include "Daemon.h"
+
+/**
+ * Наблюдает за устройствами без графического интерфейса, пока не получит
+ * сигнал завершения. Формат файла настроек описан в Daemon.h.
+ */
+int main(int argc, char *argv[])
+{
+    qSetMessagePattern("[%{time}] %{type}: %{message}");
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("mdm500m-daemon");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QObject::tr("Наблюдение за демодуляторами МДМ-500 и МДМ-500М"));
+    parser.addHelpOption();
+    QCommandLineOption config("config", QObject::tr("Файл настроек"), "file", "mdm500m-daemon.ini");
+    QCommandLineOption firmware("firmware", QObject::tr("Обновить прошивку устройств и завершить работу"), "file.bsk");
+    parser.addOptions({ config, firmware });
+    parser.process(app);
+
+    Daemon daemon(parser.value(config));
+    daemon.setFirmwareFile(parser.value(firmware));
+    if (!daemon.start()) {
+        return 1;
+    }
+    return app.exec();
+}
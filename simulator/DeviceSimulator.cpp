@@ -0,0 +1,390 @@
+#include <algorithm>
+
+#include <QTimer>
+
+#include "Crc16.h"
+#include "DeviceSimulator.h"
+#include "Transport.h"
+
+using namespace std::chrono;
+
+namespace {
+
+constexpr uint8_t kBootMarker = 0x55;
+constexpr int kBootQueryInterval = 1000;
+constexpr int kDriftInterval = 1000;
+constexpr int8_t kMinSignalLevel = 20;
+constexpr int8_t kMaxSignalLevel = 90;
+
+} // namespace
+
+DeviceSimulator::DeviceSimulator(Transport &transport, Options options, QObject *parent)
+    : QObject(parent)
+    , m_transport(transport)
+    , m_options(options)
+    , m_random(options.seed)
+    , m_bootTimer(new QTimer(this))
+    , m_bootIdle(new QTimer(this))
+{
+    m_clock.start();
+
+    memset(&m_config, 0, sizeof(m_config));
+    memset(&m_errors, 0, sizeof(m_errors));
+    memset(&m_states, 0, sizeof(m_states));
+    for (int slot = 0; slot < kSlotCount; ++slot) {
+        auto &&module = m_config.modules[slot];
+        module.isModule = 1;
+        // Последние четыре слота - радиомодули ДМ-500FM
+        if (slot < kSlotCount - 4) {
+            module.type = ModuleInfo<DM500M>::typeIndex();
+            module.frequency = static_cast<uint32_t>(48250 + slot * 8000);
+            m_thresholdLevels[slot] = ModuleInfo<DM500M>::serializeThresholdLevel(1);
+        } else {
+            module.type = ModuleInfo<DM500FM>::typeIndex();
+            module.frequency = static_cast<uint32_t>(88000 + slot * 1000);
+            module.volume = 8;
+            m_thresholdLevels[slot] = ModuleInfo<DM500FM>::serializeThresholdLevel(1);
+            m_states.rds |= 1 << slot;
+            m_states.stereo |= 1 << slot;
+        }
+        m_signalLevels[slot] = 60;
+    }
+    m_savedConfig = m_config;
+
+    m_bootTimer->setInterval(kBootQueryInterval);
+    connect(m_bootTimer, &QTimer::timeout, this, [this] {
+        sendBootPack(tbBootQuery, m_page);
+    });
+    m_bootIdle->setSingleShot(true);
+    m_bootIdle->setInterval(static_cast<int>(m_options.bootWait.count()));
+    connect(m_bootIdle, &QTimer::timeout, this, &DeviceSimulator::startFirmware);
+
+    auto drift = new QTimer(this);
+    connect(drift, &QTimer::timeout, this, &DeviceSimulator::onDrift);
+    drift->start(kDriftInterval);
+
+    connect(&m_transport, &Transport::readyRead, this, &DeviceSimulator::onReadyRead);
+}
+
+void DeviceSimulator::injectFault(Protocol::Command cmd, Fault fault)
+{
+    m_faults[cmd] = fault;
+}
+
+void DeviceSimulator::setModuleErrors(int slot, bool lowLevel, bool fault, bool patf)
+{
+    Q_ASSERT(slot >= 0 && slot < kSlotCount);
+    auto update = [slot](uint16_t &bits, bool value) {
+        uint16_t mask = static_cast<uint16_t>(1 << slot);
+        bits = static_cast<uint16_t>(value ? bits | mask : bits & ~mask);
+    };
+    update(m_errors.current.lowLevel, lowLevel);
+    update(m_errors.current.fault, fault);
+    update(m_errors.current.patf, patf);
+    m_errors.log.lowLevel |= m_errors.current.lowLevel;
+    m_errors.log.fault    |= m_errors.current.fault;
+    m_errors.log.patf     |= m_errors.current.patf;
+    m_config.modules[slot].lowLevel = lowLevel;
+    m_config.modules[slot].fault = fault;
+    m_config.modules[slot].patf = patf;
+}
+
+quint64 DeviceSimulator::requestCount() const
+{
+    return m_requestCount;
+}
+
+void DeviceSimulator::onReadyRead()
+{
+    switch (m_mode) {
+    case Mode::Starting:
+        m_transport.readAll();
+        return;
+    case Mode::Bootloader:
+        m_bootInput.append(m_transport.readAll());
+        handleBoot();
+        return;
+    case Mode::Firmware:
+        break;
+    }
+    auto handler = [this](uint8_t cmd, const void *data, int size) {
+        handle(static_cast<Protocol::Command>(cmd), static_cast<const uint8_t *>(data), size);
+        return true;
+    };
+    do {
+        while (m_mode == Mode::Firmware && m_decoder.decode(handler)) {
+        }
+    }
+    while (m_decoder.fill(m_transport) > 0);
+}
+
+void DeviceSimulator::onDrift()
+{
+    if (m_mode != Mode::Firmware) {
+        return;
+    }
+    std::uniform_int_distribution<int> step(-2, 2);
+    for (int slot = 0; slot < kSlotCount; ++slot) {
+        if (!m_config.modules[slot].isModule) {
+            continue;
+        }
+        int level = m_signalLevels[slot] + step(m_random);
+        m_signalLevels[slot] = static_cast<int8_t>(std::max<int>(kMinSignalLevel,
+                                                   std::min<int>(kMaxSignalLevel, level)));
+        auto &&current = m_errors.current;
+        setModuleErrors(slot, m_signalLevels[slot] < m_thresholdLevels[slot],
+                        current[slot].fault, current[slot].patf);
+    }
+}
+
+void DeviceSimulator::handle(Protocol::Command cmd, const uint8_t *data, int size)
+{
+    using Command = Protocol::Command;
+    using Error = Protocol::Error;
+
+    ++m_requestCount;
+    auto fault = m_faults.find(cmd);
+    if ((fault != m_faults.end() && fault->second == Fault::NoReply) || chance(m_options.silence)) {
+        return;
+    }
+
+    const bool isMDM500 = m_options.type == DeviceType::MDM500;
+    switch (cmd) {
+    case Command::ReadInfo:
+        if (isMDM500) {
+            MDM500::DeviceInfo info { static_cast<uint16_t>(m_options.serialNumber) };
+            return reply(cmd, info);
+        } else {
+            MDM500M::DeviceInfo info;
+            info.serialNumber.value = m_options.serialNumber;
+            info.softwareVersion = SoftwareVersion(3, 1, 0, 0);
+            info.hardwareVersion = MDM500M::kHardwareVersion;
+            return reply(cmd, info);
+        }
+    case Command::ReadConfig:
+        if (isMDM500) {
+            return reply(cmd, MDM500::DeviceConfig::fromMDM500M(m_config));
+        }
+        return reply(cmd, m_config);
+    case Command::ReadSignalLevels:
+        return reply(cmd, m_signalLevels);
+    case Command::WriteConfig:
+        if (isMDM500) {
+            // МДМ-500 отвечает отдельными командами без данных
+            if (size != sizeof(MDM500::DeviceConfig) || writeError(cmd) != Error::Ok) {
+                return reply(Command::Error, nullptr, 0, m_options.eepromLatency);
+            }
+            MDM500::DeviceConfig config;
+            memcpy(&config, data, sizeof(config));
+            m_config = m_savedConfig = config.convertToMDM500M();
+            return reply(Command::Ok, nullptr, 0, m_options.eepromLatency);
+        }
+        if (size != sizeof(MDM500M::DeviceConfig)) {
+            return replyError(cmd, Error::WrongParam, m_options.eepromLatency);
+        }
+        if (writeError(cmd) == Error::Ok) {
+            memcpy(&m_config, data, sizeof(m_config));
+            m_savedConfig = m_config;
+        }
+        return replyError(cmd, writeError(cmd), m_options.eepromLatency);
+    default:
+        break;
+    }
+    if (isMDM500) {
+        return;
+    }
+
+    switch (cmd) {
+    case Command::WriteTempModuleConfig: {
+        MDM500M::ModuleConfigWithSlot config;
+        if (size != sizeof(config)) {
+            return replyError(cmd, Error::WrongParam);
+        }
+        memcpy(&config, data, sizeof(config));
+        if (config.slot >= kSlotCount) {
+            return replyError(cmd, Error::BadParamNumber);
+        }
+        if (writeError(cmd) == Error::Ok) {
+            m_config.modules[config.slot] = config.config;
+        }
+        return replyError(cmd, writeError(cmd));
+    }
+    case Command::WriteTempControlModule:
+        if (size != 1 || data[0] >= kSlotCount) {
+            return replyError(cmd, Error::BadParamNumber);
+        }
+        m_config.control = data[0];
+        return replyError(cmd, Error::Ok);
+    case Command::ReadErrors:
+        return reply(cmd, m_errors);
+    case Command::ReadThresholdLevels:
+        return reply(cmd, m_thresholdLevels);
+    case Command::WriteThresholdLevels:
+        if (size != sizeof(m_thresholdLevels)) {
+            return replyError(cmd, Error::WrongParam);
+        }
+        memcpy(&m_thresholdLevels, data, sizeof(m_thresholdLevels));
+        return replyError(cmd, Error::Ok);
+    case Command::Reboot:
+        replyError(cmd, Error::Ok);
+        return enterBootloader();
+    case Command::ResetErrors:
+        m_errors.log = m_errors.current;
+        return replyError(cmd, Error::Ok);
+    case Command::ReadModuleStates:
+        return reply(cmd, m_states);
+    default:
+        // Остальные команды устройство не поддерживает и не отвечает на них
+        return;
+    }
+}
+
+void DeviceSimulator::handleBoot()
+{
+    forever {
+        int start = m_bootInput.indexOf(static_cast<char>(kBootMarker));
+        if (start < 0) {
+            m_bootInput.clear();
+            return;
+        }
+        m_bootInput.remove(0, start);
+        if (m_bootInput.size() < static_cast<int>(sizeof(TBootHeader))) {
+            return;
+        }
+        TBootHeader header;
+        memcpy(&header, m_bootInput.constData(), sizeof(header));
+        if (header.type_boot != tbWritePage) {
+            m_bootInput.remove(0, 1);
+            continue;
+        }
+        const int pageSize = static_cast<int>(sizeof(TPageHeader)) + (1 << header.log_page_size);
+        const int total = static_cast<int>(sizeof(TBootHeader)) + pageSize + static_cast<int>(sizeof(uint16_t));
+        if (m_bootInput.size() < total) {
+            return;
+        }
+        auto bytes = reinterpret_cast<const uint8_t *>(m_bootInput.constData());
+        uint16_t crc = Crc16::update(0, bytes + 1, sizeof(TBootHeader) - 1);
+        crc = Crc16::update(crc, bytes + sizeof(TBootHeader), static_cast<uint16_t>(pageSize));
+        uint16_t received;
+        memcpy(&received, bytes + total - sizeof(uint16_t), sizeof(received));
+        m_bootInput.remove(0, total);
+
+        m_bootTimer->stop();
+        m_bootIdle->start();
+        if (crc != received || header.nmb_page != m_page) {
+            sendBootPack(tbBootQuery, m_page);
+            continue;
+        }
+        sendBootPack(tbAcknowledg, m_page);
+        m_page = (m_page + 1) & 0x0FFF;
+        sendBootPack(tbBootQuery, m_page);
+    }
+}
+
+void DeviceSimulator::reply(Protocol::Command cmd, const void *data, int size, milliseconds extraLatency)
+{
+    uint8_t frame[FrameDecoder::kMaxPackageSize];
+    int frameSize = Protocol::encode(cmd, data, size, frame);
+    transmit(QByteArray(reinterpret_cast<const char *>(frame), frameSize), frameSize - 1, extraLatency);
+}
+
+template <typename T>
+void DeviceSimulator::reply(Protocol::Command cmd, const T &data)
+{
+    reply(cmd, &data, sizeof(T));
+}
+
+void DeviceSimulator::replyError(Protocol::Command cmd, Protocol::Error error, milliseconds extraLatency)
+{
+    reply(cmd, &error, sizeof(error), extraLatency);
+}
+
+void DeviceSimulator::transmit(QByteArray bytes, int crcOffset, milliseconds extraLatency)
+{
+    if (chance(m_options.crcCorruption)) {
+        bytes[crcOffset] = static_cast<char>(bytes[crcOffset] ^ 0x5A);
+    }
+    if (m_options.byteLoss > 0) {
+        QByteArray kept;
+        kept.reserve(bytes.size());
+        for (char byte : bytes) {
+            if (!chance(m_options.byteLoss)) {
+                kept.append(byte);
+            }
+        }
+        bytes = kept;
+    }
+
+    auto delay = m_options.latency + extraLatency;
+    if (m_options.jitter > milliseconds::zero()) {
+        std::uniform_int_distribution<qint64> jitter(0, m_options.jitter.count());
+        delay += milliseconds(jitter(m_random));
+    }
+    // Ответы передаются строго по очереди, как на одном UART устройства
+    qint64 now = m_clock.elapsed();
+    m_busyUntil = std::max(now + delay.count(), m_busyUntil);
+    QTimer::singleShot(static_cast<int>(m_busyUntil - now), this, [this, bytes] {
+        m_transport.write(bytes);
+    });
+}
+
+void DeviceSimulator::sendBootPack(ETypeBoot type, int page)
+{
+    TBootPack pack;
+    memset(&pack, 0, sizeof(pack));
+    pack.start_byte = kBootMarker;
+    pack.type_boot = static_cast<unsigned char>(type);
+    pack.version_soft = SoftwareVersion(3, 1, 0, 0);
+    pack.version_hard = MDM500M::kHardwareVersion;
+    pack.nmb_page = static_cast<unsigned short>(page);
+    auto begin = reinterpret_cast<const char *>(&pack.type_boot);
+    auto end   = reinterpret_cast<const char *>(&pack.crc);
+    pack.crc = Crc16::update(0, begin, static_cast<uint16_t>(std::distance(begin, end)));
+    transmit(QByteArray(reinterpret_cast<const char *>(&pack), sizeof(pack)),
+             sizeof(pack) - 1, milliseconds::zero());
+}
+
+void DeviceSimulator::enterBootloader()
+{
+    m_mode = Mode::Bootloader;
+    m_page = 0;
+    m_bootInput.clear();
+    m_decoder.clear();
+    m_config = m_savedConfig;
+    sendBootPack(tbBootQuery, m_page);
+    m_bootTimer->start();
+    m_bootIdle->start();
+}
+
+void DeviceSimulator::startFirmware()
+{
+    m_mode = Mode::Starting;
+    m_bootTimer->stop();
+    QTimer::singleShot(static_cast<int>(m_options.bootTime.count()), this, [this] {
+        m_transport.readAll();
+        m_decoder.clear();
+        m_mode = Mode::Firmware;
+    });
+}
+
+bool DeviceSimulator::chance(double probability)
+{
+    if (probability <= 0) {
+        return false;
+    }
+    std::uniform_real_distribution<double> distribution(0, 1);
+    return distribution(m_random) < probability;
+}
+
+Protocol::Error DeviceSimulator::writeError(Protocol::Command cmd) const
+{
+    auto fault = m_faults.find(cmd);
+    if (fault == m_faults.end()) {
+        return Protocol::Error::Ok;
+    }
+    switch (fault->second) {
+    case Fault::CantWrite : return Protocol::Error::CantWrite;
+    case Fault::WrongParam: return Protocol::Error::WrongParam;
+    default               : return Protocol::Error::Ok;
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <random>
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+
+#include "BootLoad.h"
+#include "FrameDecoder.h"
+#include "Protocol.h"
+#include "Types.h"
+
+class QTimer;
+class Transport;
+
+/**
+ * @brief Имитатор демодулятора МДМ-500 или МДМ-500М
+ *
+ * Отвечает на команды Protocol по состоянию, хранящемуся в тех же
+ * структурах, что читает программа, а после команды Reboot ведет диалог
+ * загрузчика, как его ожидает UpdaterProtocol. Ответы задерживаются на
+ * заданное время, а байты ответа могут теряться или искажаться.
+ */
+class DeviceSimulator : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Параметры имитатора
+     */
+    struct Options
+    {
+        DeviceType type = DeviceType::MDM500M;
+        uint32_t serialNumber = 1;
+        std::chrono::milliseconds latency { 5 };         /**< Время от запроса до ответа      */
+        std::chrono::milliseconds jitter { 0 };          /**< Случайная добавка к latency     */
+        std::chrono::milliseconds eepromLatency { 150 }; /**< Добавка для записи в EEPROM     */
+        double byteLoss = 0;        /**< Вероятность потери каждого байта ответа     */
+        double crcCorruption = 0;   /**< Вероятность искажения контрольной суммы     */
+        double silence = 0;         /**< Вероятность оставить запрос без ответа      */
+        std::chrono::milliseconds bootWait { 2000 };  /**< Ожидание страниц загрузчиком */
+        std::chrono::milliseconds bootTime { 500 };   /**< Время запуска прошивки       */
+        quint32 seed = 0;
+    };
+
+    /**
+     * @brief Неисправность, имитируемая для отдельной команды
+     */
+    enum class Fault
+    {
+        None,
+        NoReply,    /**< Команда остается без ответа                 */
+        CantWrite,  /**< Запись отвечает Error::CantWrite            */
+        WrongParam  /**< Запись отвечает Error::WrongParam           */
+    };
+
+    DeviceSimulator(Transport &transport, Options options, QObject *parent = nullptr);
+
+    void injectFault(Protocol::Command cmd, Fault fault);
+    /**
+     * @brief Установить текущие ошибки модуля
+     */
+    void setModuleErrors(int slot, bool lowLevel, bool fault, bool patf);
+    /**
+     * @brief Этот метод возвращает количество полученных запросов.
+     */
+    quint64 requestCount() const;
+
+private:
+    enum class Mode { Firmware, Bootloader, Starting };
+
+    void onReadyRead();
+    void onDrift();
+    void handle(Protocol::Command cmd, const uint8_t *data, int size);
+    void handleBoot();
+    void reply(Protocol::Command cmd, const void *data, int size,
+               std::chrono::milliseconds extraLatency = std::chrono::milliseconds::zero());
+    template <typename T>
+    void reply(Protocol::Command cmd, const T &data);
+    void replyError(Protocol::Command cmd, Protocol::Error error,
+                    std::chrono::milliseconds extraLatency = std::chrono::milliseconds::zero());
+    void transmit(QByteArray bytes, int crcOffset, std::chrono::milliseconds extraLatency);
+    void sendBootPack(ETypeBoot type, int page);
+    void enterBootloader();
+    void startFirmware();
+    bool chance(double probability);
+    Protocol::Error writeError(Protocol::Command cmd) const;
+
+    Transport &m_transport;
+    Options m_options;
+    std::mt19937 m_random;
+    FrameDecoder m_decoder;
+    QByteArray m_bootInput;
+    Mode m_mode = Mode::Firmware;
+    std::map<Protocol::Command, Fault> m_faults;
+    QElapsedTimer m_clock;
+    qint64 m_busyUntil = 0;   /**< Момент, до которого занят передатчик, мс */
+    quint64 m_requestCount = 0;
+    int m_page = 0;
+    QTimer *m_bootTimer;      /**< Повтор запроса страницы загрузчиком      */
+    QTimer *m_bootIdle;       /**< Выход из загрузчика при отсутствии страниц */
+
+    MDM500M::DeviceConfig m_config;
+    MDM500M::DeviceConfig m_savedConfig;
+    MDM500M::ErrorsPackage m_errors;
+    MDM500M::SignalLevels m_signalLevels;
+    MDM500M::SignalLevels m_thresholdLevels;
+    MDM500M::ModuleStates m_states;
+};
@@ -0,0 +1,117 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <QSocketNotifier>
+
+#include "PtyMasterTransport.h"
+
+PtyMasterTransport::PtyMasterTransport(QObject *parent)
+    : Transport(parent)
+{}
+
+PtyMasterTransport::~PtyMasterTransport()
+{
+    close();
+}
+
+QString PtyMasterTransport::slavePath() const
+{
+    return m_slavePath;
+}
+
+QString PtyMasterTransport::address() const
+{
+    return "pty:" + m_slavePath;
+}
+
+bool PtyMasterTransport::configure(qint32)
+{
+    // Скорость псевдотерминала ни на что не влияет
+    return true;
+}
+
+void PtyMasterTransport::clear()
+{
+    tcflush(m_master, TCIOFLUSH);
+}
+
+bool PtyMasterTransport::open(OpenMode mode)
+{
+    m_master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (m_master < 0 || grantpt(m_master) != 0 || unlockpt(m_master) != 0) {
+        setErrorString(QString::fromLocal8Bit(strerror(errno)));
+        close();
+        return false;
+    }
+    m_slavePath = QString::fromLocal8Bit(ptsname(m_master));
+    m_slave = ::open(ptsname(m_master), O_RDWR | O_NOCTTY);
+
+    termios tio;
+    tcgetattr(m_master, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(m_master, TCSANOW, &tio);
+    fcntl(m_master, F_SETFL, fcntl(m_master, F_GETFL) | O_NONBLOCK);
+
+    m_notifier = new QSocketNotifier(m_master, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, [this] {
+        emit readyRead();
+    });
+    return Transport::open(mode | Unbuffered);
+}
+
+void PtyMasterTransport::close()
+{
+    if (isOpen()) {
+        Transport::close();
+    }
+    delete m_notifier;
+    m_notifier = nullptr;
+    if (m_slave >= 0) {
+        ::close(m_slave);
+        m_slave = -1;
+    }
+    if (m_master >= 0) {
+        ::close(m_master);
+        m_master = -1;
+    }
+}
+
+qint64 PtyMasterTransport::readData(char *data, qint64 maxSize)
+{
+    auto size = ::read(m_master, data, static_cast<size_t>(maxSize));
+    if (size < 0) {
+        return errno == EAGAIN ? 0 : -1;
+    }
+    return size;
+}
+
+qint64 PtyMasterTransport::writeData(const char *data, qint64 maxSize)
+{
+    qint64 written = 0;
+    while (written < maxSize) {
+        auto size = ::write(m_master, data + written, static_cast<size_t>(maxSize - written));
+        if (size < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                // Буфер псевдотерминала полон: ждем, пока сторона программы
+                // прочитает данные, но не дольше kWriteTimeout - непрочитанный
+                // остаток теряется, как на линии без приемника
+                pollfd fd { m_master, POLLOUT, 0 };
+                int ready = ::poll(&fd, 1, kWriteTimeout);
+                if (ready > 0 || (ready < 0 && errno == EINTR)) {
+                    continue;
+                }
+                return written;
+            }
+            return written > 0 ? written : -1;
+        }
+        written += size;
+    }
+    return written;
+}
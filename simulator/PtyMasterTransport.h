@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Transport.h"
+
+class QSocketNotifier;
+
+/**
+ * @brief Ведущая сторона псевдотерминала
+ *
+ * Программа открывает ведомую сторону (slavePath()) как обычный
+ * последовательный порт, а имитатор работает с ведущей.
+ */
+class PtyMasterTransport : public Transport
+{
+    Q_OBJECT
+
+public:
+    PtyMasterTransport(QObject *parent = nullptr);
+    ~PtyMasterTransport() override;
+
+    /**
+     * @brief Этот метод возвращает путь к ведомой стороне.
+     */
+    QString slavePath() const;
+
+    QString address() const override;
+    bool configure(qint32 baudRate) override;
+    void clear() override;
+
+    bool open(OpenMode mode) override;
+    void close() override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    static constexpr int kWriteTimeout = 1000; /**< мс */
+
+    int m_master = -1;
+    int m_slave = -1;          /**< Держим открытой, чтобы чтение не возвращало EIO */
+    QString m_slavePath;
+    QSocketNotifier *m_notifier = nullptr;
+};
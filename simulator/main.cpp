@@ -0,0 +1,85 @@
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+
+#include "DeviceSimulator.h"
+#include "PtyMasterTransport.h"
+
+/**
+ * Запускает заданное количество имитаторов, каждый на своем псевдотерминале,
+ * и печатает их адреса для ключа transports файла settings.ini.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("mdm500m-simulator");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QObject::tr("Имитатор демодуляторов МДМ-500 и МДМ-500М"));
+    parser.addHelpOption();
+    QCommandLineOption count("count", QObject::tr("Количество устройств"), "n", "1");
+    QCommandLineOption type("type", QObject::tr("Тип устройства: mdm500 или mdm500m"), "type", "mdm500m");
+    QCommandLineOption latency("latency", QObject::tr("Время ответа, мс"), "ms", "5");
+    QCommandLineOption jitter("jitter", QObject::tr("Разброс времени ответа, мс"), "ms", "0");
+    QCommandLineOption loss("loss", QObject::tr("Вероятность потери байта"), "p", "0");
+    QCommandLineOption corrupt("corrupt", QObject::tr("Вероятность искажения КС"), "p", "0");
+    QCommandLineOption silence("silence", QObject::tr("Вероятность не ответить"), "p", "0");
+    QCommandLineOption fault("fault", QObject::tr("Неисправность команды: <код команды>=noreply|cantwrite|wrongparam"), "spec");
+    QCommandLineOption seed("seed", QObject::tr("Начальное значение генератора"), "n", "1");
+    parser.addOptions({ count, type, latency, jitter, loss, corrupt, silence, fault, seed });
+    parser.process(app);
+
+    DeviceSimulator::Options options;
+    options.type = parser.value(type) == "mdm500" ? DeviceType::MDM500 : DeviceType::MDM500M;
+    options.latency = std::chrono::milliseconds(parser.value(latency).toInt());
+    options.jitter = std::chrono::milliseconds(parser.value(jitter).toInt());
+    options.byteLoss = parser.value(loss).toDouble();
+    options.crcCorruption = parser.value(corrupt).toDouble();
+    options.silence = parser.value(silence).toDouble();
+
+    std::vector<std::pair<Protocol::Command, DeviceSimulator::Fault>> faults;
+    for (auto &&spec : parser.values(fault)) {
+        auto parts = spec.split('=');
+        bool isCode = false;
+        int code = parts.size() == 2 ? parts[0].toInt(&isCode) : 0;
+        const std::map<QString, DeviceSimulator::Fault> kinds {
+            { "noreply",    DeviceSimulator::Fault::NoReply    },
+            { "cantwrite",  DeviceSimulator::Fault::CantWrite  },
+            { "wrongparam", DeviceSimulator::Fault::WrongParam },
+        };
+        auto kind = parts.size() == 2 ? kinds.find(parts[1]) : kinds.end();
+        if (!isCode || code < 0 || code > 0xFF || kind == kinds.end()) {
+            qWarning("Неверная неисправность: %s", qPrintable(spec));
+            return 1;
+        }
+        faults.emplace_back(static_cast<Protocol::Command>(code), kind->second);
+    }
+
+    const int deviceCount = parser.value(count).toInt();
+    const quint32 baseSeed = parser.value(seed).toUInt();
+    std::vector<std::unique_ptr<PtyMasterTransport>> transports;
+    std::vector<std::unique_ptr<DeviceSimulator>> devices;
+    for (int i = 0; i < deviceCount; ++i) {
+        auto transport = std::make_unique<PtyMasterTransport>();
+        if (!transport->open(QIODevice::ReadWrite)) {
+            qWarning("Не удалось создать псевдотерминал: %s", qPrintable(transport->errorString()));
+            return 1;
+        }
+        options.serialNumber = static_cast<uint32_t>(i + 1);
+        options.seed = baseSeed + static_cast<quint32>(i);
+        auto device = std::make_unique<DeviceSimulator>(*transport, options);
+        for (auto &&f : faults) {
+            device->injectFault(f.first, f.second);
+        }
+        printf("%s\n", qPrintable(transport->address()));
+        transports.push_back(std::move(transport));
+        devices.push_back(std::move(device));
+    }
+    fflush(stdout);
+
+    return app.exec();
+}
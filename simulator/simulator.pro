@@ -0,0 +1,47 @@
+QT -= gui
+QT += serialport network
+
+CONFIG += c++14 console
+CONFIG -= app_bundle
+
+TARGET = mdm500m-simulator
+
+SRC = $$PWD/../src
+INCLUDEPATH += $$SRC
+
+HEADERS += \
+    DeviceSimulator.h \
+    PtyMasterTransport.h \
+    $$SRC/Types.h \
+    $$SRC/Cancelation.h \
+    $$SRC/InterruptibleWait.h \
+    $$SRC/BootLoad.h \
+    $$SRC/Crc16.h \
+    $$SRC/Protocol.h \
+    $$SRC/FrameDecoder.h \
+    $$SRC/RttEstimator.h \
+    $$SRC/LatencyHistogram.h \
+    $$SRC/LinkStatistics.h \
+    $$SRC/Link.h \
+    $$SRC/Transport.h \
+    $$SRC/SerialTransport.h \
+    $$SRC/TcpTransport.h \
+    $$SRC/UpdaterProtocol.h
+
+SOURCES += \
+    main.cpp \
+    DeviceSimulator.cpp \
+    PtyMasterTransport.cpp \
+    $$SRC/Cancelation.cpp \
+    $$SRC/InterruptibleWait.cpp \
+    $$SRC/Protocol.cpp \
+    $$SRC/FrameDecoder.cpp \
+    $$SRC/RttEstimator.cpp \
+    $$SRC/LatencyHistogram.cpp \
+    $$SRC/LinkStatistics.cpp \
+    $$SRC/Link.cpp \
+    $$SRC/Transport.cpp \
+    $$SRC/SerialTransport.cpp \
+    $$SRC/TcpTransport.cpp \
+    $$SRC/Crc16.cpp \
+    $$SRC/UpdaterProtocol.cpp
@@ -0,0 +1,284 @@
+#include <QTimer>
+
+#include "AsyncProtocol.h"
+#include "Link.h"
+
+using namespace std::chrono;
+
+AsyncProtocol::AsyncProtocol(Link &link, QObject *parent)
+    : QObject(parent)
+    , m_link(link)
+    , m_deadline(new QTimer(this))
+{
+    m_clock.start();
+    m_deadline->setSingleShot(true);
+    m_deadline->setTimerType(Qt::PreciseTimer);
+    connect(m_deadline, &QTimer::timeout, this, &AsyncProtocol::onDeadline);
+    connect(&m_link.transport(), &Transport::readyRead, this, &AsyncProtocol::onReadyRead);
+    connect(&m_link.transport(), &Transport::bytesWritten, this, &AsyncProtocol::onBytesWritten);
+}
+
+AsyncProtocol::Request AsyncProtocol::set(Protocol::Command cmd, Protocol::Error &error)
+{
+    Request request;
+    request.cmd = cmd;
+    request.replySize = sizeof(Protocol::Error);
+    request.reader = [cmd, &error](Protocol::Command answer, const void *data, int size) {
+        if (answer != cmd || size != sizeof(Protocol::Error)) {
+            return false;
+        }
+        memcpy(&error, data, sizeof(Protocol::Error));
+        return true;
+    };
+    return request;
+}
+
+bool AsyncProtocol::configure()
+{
+    Protocol proto(m_link);
+    return proto.configure();
+}
+
+void AsyncProtocol::submit(Request request, Completion done)
+{
+    std::vector<Request> requests;
+    requests.push_back(std::move(request));
+    submit(std::move(requests), std::move(done), Mode::Sequential);
+}
+
+void AsyncProtocol::submit(std::vector<Request> requests, Completion done, Mode mode)
+{
+    Q_ASSERT(!requests.empty());
+    Q_ASSERT(mode == Mode::Sequential || requests.size() <= Protocol::kMaxPipelineDepth);
+
+    Batch batch;
+    batch.done = std::move(done);
+    batch.mode = mode;
+    batch.requests.reserve(requests.size());
+    for (auto &&request : requests) {
+        Pending pending;
+        pending.request = std::move(request);
+        batch.requests.push_back(std::move(pending));
+    }
+    m_queue.push_back(std::move(batch));
+    if (m_phase == Phase::Idle) {
+        startNext();
+    }
+}
+
+void AsyncProtocol::abort()
+{
+    m_deadline->stop();
+    m_queue.clear();
+    m_phase = Phase::Idle;
+    m_current = -1;
+}
+
+bool AsyncProtocol::isIdle() const
+{
+    return m_queue.empty();
+}
+
+void AsyncProtocol::startNext()
+{
+    if (m_queue.empty()) {
+        m_phase = Phase::Idle;
+        return;
+    }
+    auto &batch = m_queue.front();
+    m_current = batch.mode == Mode::Pipelined ? -1 : nextPending();
+    send();
+}
+
+void AsyncProtocol::send()
+{
+    auto &batch = m_queue.front();
+    auto &port = m_link.transport();
+    uint8_t frame[FrameDecoder::kMaxPackageSize];
+    int bytes = 0;
+    m_timeout = milliseconds::max();
+    for (int i = 0; i < static_cast<int>(batch.requests.size()); ++i) {
+        auto &pending = batch.requests[static_cast<size_t>(i)];
+        if (pending.received || (m_current != -1 && m_current != i)) {
+            continue;
+        }
+        auto &&request = pending.request;
+        int size = Protocol::encode(request.cmd, request.params.constData(),
+                                    request.params.size(), frame);
+        port.write(reinterpret_cast<const char *>(frame), size);
+        statistics().addBytesOut(size);
+        bytes += size + request.replySize + FrameDecoder::kMinPackageSize;
+        m_timeout = std::min(m_timeout, request.timeout);
+        if (pending.attempts++ == 0) {
+            statistics().addRequest(request.cmd);
+            pending.sentAt = m_clock.nsecsElapsed();
+        }
+        else {
+            statistics().addRetry(request.cmd);
+        }
+    }
+    m_transfer = Protocol::transferTime(bytes);
+    m_phase = Phase::Writing;
+    m_elapsed.start();
+    m_deadline->start(static_cast<int>((Protocol::kWriteTimeout + m_transfer).count()));
+}
+
+void AsyncProtocol::onBytesWritten()
+{
+    if (m_phase != Phase::Writing || m_link.transport().bytesToWrite() > 0) {
+        return;
+    }
+    m_phase = Phase::Waiting;
+    auto timeout = std::min(estimator().timeout() + m_transfer, m_timeout);
+    auto remaining = timeout - duration_cast<milliseconds>(nanoseconds(m_elapsed.nsecsElapsed()));
+    m_deadline->start(static_cast<int>(std::max(remaining, milliseconds::zero()).count()));
+}
+
+void AsyncProtocol::onReadyRead()
+{
+    auto handler = [this](uint8_t cmd, const void *data, int size) {
+        return dispatch(static_cast<Protocol::Command>(cmd), data, size);
+    };
+    for (;;) {
+        while (m_decoder.decode(handler)) {
+        }
+        int bytes = m_decoder.fill(m_link.transport());
+        if (bytes <= 0) {
+            break;
+        }
+        statistics().addBytesIn(bytes);
+    }
+    int rejected = m_decoder.rejectedCount();
+    statistics().addCrcErrors(rejected - m_rejected);
+    m_rejected = rejected;
+
+    if (m_phase == Phase::Idle) {
+        return;
+    }
+    auto &&requests = m_queue.front().requests;
+    bool single = true;
+    for (int i = 0; i < static_cast<int>(requests.size()); ++i) {
+        if (m_current != -1 && m_current != i) {
+            continue;
+        }
+        auto &&pending = requests[static_cast<size_t>(i)];
+        if (!pending.received) {
+            return;
+        }
+        single = single && pending.attempts == 1;
+    }
+    m_deadline->stop();
+
+    // Ответ на повторный запрос нельзя отнести к конкретной попытке,
+    // поэтому время замеряется только по запросам, переданным один раз
+    if (single) {
+        auto turnaround = nanoseconds(m_elapsed.nsecsElapsed()) - m_transfer;
+        estimator().addSample(duration_cast<microseconds>(turnaround));
+    }
+    if (isComplete()) {
+        finish(true);
+        return;
+    }
+    m_current = nextPending();
+    send();
+}
+
+void AsyncProtocol::onDeadline()
+{
+    if (m_phase == Phase::Idle) {
+        return;
+    }
+    if (m_phase == Phase::Writing) {
+        finish(false);
+        return;
+    }
+    estimator().backoff();
+    auto &batch = m_queue.front();
+    for (int i = 0; i < static_cast<int>(batch.requests.size()); ++i) {
+        auto &&pending = batch.requests[static_cast<size_t>(i)];
+        if (!pending.received && (m_current == -1 || m_current == i)) {
+            statistics().addTimeout(pending.request.cmd);
+        }
+    }
+    if (m_current == -1) {
+        // Ответы на часть запросов пропали - повторяем их по одному
+        m_current = nextPending();
+    }
+    auto &pending = batch.requests[static_cast<size_t>(m_current)];
+    if (pending.attempts >= Protocol::kMaxAttemptsCount) {
+        finish(false);
+        return;
+    }
+    send();
+}
+
+bool AsyncProtocol::dispatch(Protocol::Command cmd, const void *data, int size)
+{
+    if (m_phase == Phase::Idle) {
+        return false;
+    }
+    auto &batch = m_queue.front();
+    for (int i = 0; i < static_cast<int>(batch.requests.size()); ++i) {
+        auto &pending = batch.requests[static_cast<size_t>(i)];
+        if (pending.received || pending.attempts == 0) {
+            continue;
+        }
+        if (pending.request.reader(cmd, data, size)) {
+            pending.received = true;
+            auto latency = nanoseconds(m_clock.nsecsElapsed() - pending.sentAt);
+            statistics().addLatency(cmd, duration_cast<microseconds>(latency));
+            return true;
+        }
+    }
+    return false;
+}
+
+void AsyncProtocol::finish(bool received)
+{
+    m_deadline->stop();
+    if (!received) {
+        for (auto &&pending : m_queue.front().requests) {
+            if (!pending.received && pending.attempts > 0) {
+                statistics().addFailure(pending.request.cmd);
+            }
+        }
+    }
+    auto done = std::move(m_queue.front().done);
+    m_queue.pop_front();
+    m_phase = Phase::Idle;
+    m_current = -1;
+    if (done) {
+        done(received);
+    }
+    // Функция завершения могла поставить в очередь новые запросы
+    if (m_phase == Phase::Idle) {
+        startNext();
+    }
+}
+
+bool AsyncProtocol::isComplete() const
+{
+    return nextPending() == -1;
+}
+
+int AsyncProtocol::nextPending() const
+{
+    auto &&requests = m_queue.front().requests;
+    for (int i = 0; i < static_cast<int>(requests.size()); ++i) {
+        if (!requests[static_cast<size_t>(i)].received) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+RttEstimator &AsyncProtocol::estimator() const
+{
+    auto &&requests = m_queue.front().requests;
+    return m_link.rtt(Protocol::commandClass(requests.front().request.cmd));
+}
+
+LinkStatistics &AsyncProtocol::statistics() const
+{
+    return m_link.statistics();
+}
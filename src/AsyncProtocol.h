@@ -0,0 +1,155 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+
+#include "FrameDecoder.h"
+#include "Protocol.h"
+
+class Link;
+class LinkStatistics;
+class QTimer;
+
+/**
+ * @brief Неблокирующий протокол обмена с устройствами МДМ-500 и МДМ-500М
+ *
+ * Работает от уведомлений readyRead/bytesWritten порта и таймера ожидания,
+ * поэтому один цикл событий может обслуживать любое количество портов.
+ * Запросы объединяются в пакеты, которые выполняются по очереди; о результате
+ * сообщает функция обратного вызова. Повторы и таймауты - как в Protocol:
+ * по оценке времени ответа из Link.
+ */
+class AsyncProtocol : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Обработчик ответа: вернет истину, если пакет является ответом
+     */
+    typedef std::function<bool(Protocol::Command cmd, const void *data, int size)> Reader;
+    /**
+     * @brief Функция, вызываемая по завершении пакета запросов
+     */
+    typedef std::function<void(bool received)> Completion;
+
+    /**
+     * @brief Режим выполнения пакета запросов
+     */
+    enum class Mode
+    {
+        Sequential, /**< Следующий запрос передается после ответа на предыдущий */
+        Pipelined   /**< Все запросы передаются подряд, ответы разбираются по команде */
+    };
+
+    struct Request
+    {
+        Protocol::Command cmd;
+        QByteArray params;
+        Reader reader;
+        int replySize = 0;
+        std::chrono::milliseconds timeout = Protocol::kDefaultReadTimeout;
+    };
+
+    template <typename AnswerData>
+    static Request get(Protocol::Command cmd, AnswerData &data);
+
+    template <typename Params>
+    static Request set(Protocol::Command cmd, Protocol::Error &error, const Params &params);
+
+    static Request set(Protocol::Command cmd, Protocol::Error &error);
+
+    AsyncProtocol(Link &link, QObject *parent = nullptr);
+
+    bool configure();
+
+    /**
+     * @brief Поставить запрос в очередь
+     */
+    void submit(Request request, Completion done);
+    /**
+     * @brief Поставить пакет запросов в очередь
+     */
+    void submit(std::vector<Request> requests, Completion done,
+                Mode mode = Mode::Sequential);
+    /**
+     * @brief Отменить все запросы без вызова функций завершения
+     */
+    void abort();
+    /**
+     * @brief Этот метод возвращает истину, если очередь запросов пуста.
+     */
+    bool isIdle() const;
+
+private:
+    enum class Phase { Idle, Writing, Waiting };
+
+    struct Pending
+    {
+        Request request;
+        int attempts = 0;
+        bool received = false;
+        qint64 sentAt = 0; /**< Время первой передачи по m_clock, нс */
+    };
+
+    struct Batch
+    {
+        std::vector<Pending> requests;
+        Completion done;
+        Mode mode;
+    };
+
+    void startNext();
+    void send();
+    void onBytesWritten();
+    void onReadyRead();
+    void onDeadline();
+    bool dispatch(Protocol::Command cmd, const void *data, int size);
+    void finish(bool received);
+    bool isComplete() const;
+    int nextPending() const;
+    RttEstimator &estimator() const;
+    LinkStatistics &statistics() const;
+
+    Link &m_link;
+    QTimer *m_deadline;
+    FrameDecoder m_decoder;
+    QElapsedTimer m_elapsed;
+    QElapsedTimer m_clock;
+    int m_rejected = 0;
+    std::deque<Batch> m_queue;
+    std::chrono::milliseconds m_transfer { 0 };
+    std::chrono::milliseconds m_timeout { 0 };
+    Phase m_phase = Phase::Idle;
+    int m_current = -1; /**< Запрос, передаваемый по одному, -1 - весь пакет */
+};
+
+template <typename AnswerData>
+AsyncProtocol::Request AsyncProtocol::get(Protocol::Command cmd, AnswerData &data)
+{
+    Request request;
+    request.cmd = cmd;
+    request.replySize = sizeof(AnswerData);
+    request.reader = [cmd, &data](Protocol::Command answer, const void *buffer, int size) {
+        if (answer != cmd || size != sizeof(AnswerData)) {
+            return false;
+        }
+        memcpy(&data, buffer, sizeof(AnswerData));
+        return true;
+    };
+    return request;
+}
+
+template <typename Params>
+AsyncProtocol::Request AsyncProtocol::set(Protocol::Command cmd, Protocol::Error &error, const Params &params)
+{
+    Request request = set(cmd, error);
+    request.params = QByteArray(reinterpret_cast<const char *>(&params), sizeof(Params));
+    return request;
+}
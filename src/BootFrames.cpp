@@ -0,0 +1,27 @@
+#include "BootFrames.h"
+#include "Firmware.h"
+#include "UpdaterProtocol.h"
+
+BootFrames::BootFrames(const Firmware &firmware)
+    : m_frameSize(UpdaterProtocol::frameSize(firmware.pageSize()))
+    , m_count(firmware.pageCount())
+{
+    m_data.resize(m_frameSize * m_count);
+    char *frame = m_data.data();
+    for (int page = 0; page < m_count; ++page, frame += m_frameSize) {
+        auto data = firmware.page(page);
+        UpdaterProtocol::encodeFrame(frame, page, firmware.pageSizeLog2(),
+                                     data.constData(), data.size());
+    }
+}
+
+int BootFrames::count() const
+{
+    return m_count;
+}
+
+QByteArray BootFrames::frame(int page) const
+{
+    Q_ASSERT(page >= 0 && page < m_count);
+    return QByteArray::fromRawData(m_data.constData() + page * m_frameSize, m_frameSize);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QByteArray>
+
+class Firmware;
+
+/**
+ * @brief Кадры загрузчика для всех страниц прошивки
+ *
+ * Кадр записи страницы (заголовок TBootHeader, страница и CRC) не зависит
+ * от устройства, поэтому кадры кодируются один раз на образ прошивки в
+ * общий непрерывный буфер. Во время прошивки страница уходит одной
+ * записью без пересчета CRC, в том числе при повторах, а одни и те же
+ * кадры могут одновременно передаваться на несколько устройств.
+ *
+ * Экземпляр не изменяется после создания; см. Firmware::frames().
+ */
+class BootFrames
+{
+public:
+    explicit BootFrames(const Firmware &firmware);
+
+    int count() const;
+    /**
+     * @brief Кадр страницы
+     * @return Представление буфера без копирования; действительно, пока
+     * существует этот экземпляр.
+     */
+    QByteArray frame(int page) const;
+
+private:
+    QByteArray m_data;
+    int m_frameSize = 0;
+    int m_count = 0;
+};
@@ -85,5 +85,3 @@ public:
     unsigned short int  SCListLength;     // длина списка совместимости (количество совместимых)
 };
 #pragma pack(pop)
-
-uint16_t slow_crc16RAM(uint16_t sum, const void *p, uint16_t len);
@@ -1,7 +1,30 @@
+#include <algorithm>
+#include <map>
+#include <mutex>
+
 #include "Cancelation.h"
 
-CancelToken::CancelToken(std::shared_ptr<std::atomic_bool> state)
-    : m_isCanceled(state)
+struct CancelToken::State
+{
+    std::atomic_bool isCanceled { false };
+    std::shared_ptr<const State> parent;
+    Clock::time_point deadline = Clock::time_point::max();
+
+    mutable std::mutex mutex;
+    mutable std::map<uint64_t, std::function<void()>> callbacks;
+    mutable uint64_t nextId = 0;
+};
+
+CancelToken::Subscription::~Subscription()
+{
+    for (auto &&entry : m_entries) {
+        std::lock_guard<std::mutex> lock(entry.state->mutex);
+        entry.state->callbacks.erase(entry.id);
+    }
+}
+
+CancelToken::CancelToken(std::shared_ptr<const State> state)
+    : m_state(std::move(state))
 {}
 
 CancelToken::operator bool() const
@@ -11,7 +34,16 @@ CancelToken::operator bool() const
 
 bool CancelToken::isCancelled() const
 {
-    return m_isCanceled->load(std::memory_order_acquire);
+    const auto deadline = this->deadline();
+    if (deadline != Clock::time_point::max() && Clock::now() >= deadline) {
+        return true;
+    }
+    for (auto state = m_state.get(); state; state = state->parent.get()) {
+        if (state->isCanceled.load(std::memory_order_acquire)) {
+            return true;
+        }
+    }
+    return false;
 }
 
 void CancelToken::throwIfCanceled() const
@@ -21,14 +53,54 @@ void CancelToken::throwIfCanceled() const
     }
 }
 
+CancelToken::Clock::time_point CancelToken::deadline() const
+{
+    auto deadline = Clock::time_point::max();
+    for (auto state = m_state.get(); state; state = state->parent.get()) {
+        deadline = std::min(deadline, state->deadline);
+    }
+    return deadline;
+}
+
+CancelToken::Subscription CancelToken::subscribe(std::function<void()> callback) const
+{
+    // Отмена любого источника цепочки отменяет токен, поэтому подписываемся
+    // на каждый
+    Subscription subscription;
+    for (auto state = m_state; state; state = state->parent) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        auto id = state->nextId++;
+        state->callbacks.emplace(id, callback);
+        subscription.m_entries.push_back(Subscription::Entry { state, id });
+    }
+    return subscription;
+}
+
+CancellationSource::CancellationSource()
+    : m_state(std::make_shared<CancelToken::State>())
+{}
+
+CancellationSource::CancellationSource(CancelToken parent, Clock::time_point deadline)
+    : CancellationSource()
+{
+    m_state->parent = parent.m_state;
+    m_state->deadline = deadline;
+}
+
 CancelToken CancellationSource::token() const
 {
-    return CancelToken(m_isCanceled);
+    return CancelToken(m_state);
 }
 
 void CancellationSource::cancel()
 {
-    m_isCanceled->store(true, std::memory_order_release);
+    // Вызов под блокировкой гарантирует, что после уничтожения подписки
+    // ее callback уже не выполняется
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    m_state->isCanceled.store(true, std::memory_order_release);
+    for (auto &&item : m_state->callbacks) {
+        item.second();
+    }
 }
 
 CancelledException::CancelledException() noexcept
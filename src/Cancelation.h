@@ -1,29 +1,96 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <vector>
 
+/**
+ * @brief Признак отмены операции
+ *
+ * Токен считается отмененным, если отменен его источник или любой из
+ * родительских источников, либо истек срок выполнения (deadline) одного из
+ * них. Проверка потокобезопасна.
+ *
+ * Чтобы не опрашивать признак, на отмену можно подписаться: так ожидание
+ * ввода-вывода прерывается сразу (см. InterruptibleWait).
+ */
 class CancelToken
 {
 public:
-    CancelToken(std::shared_ptr<std::atomic_bool> state);
+    typedef std::chrono::steady_clock Clock;
+    struct State;
+
+    /**
+     * @brief Подписка на отмену, действует до своего уничтожения
+     */
+    class Subscription
+    {
+    public:
+        Subscription() = default;
+        Subscription(Subscription &&) = default;
+        Subscription &operator=(Subscription &&) = default;
+        ~Subscription();
+
+    private:
+        friend class CancelToken;
+
+        struct Entry
+        {
+            std::shared_ptr<const State> state;
+            uint64_t id;
+        };
+        std::vector<Entry> m_entries;
+    };
+
+    /**
+     * @brief Токен, который никогда не отменяется
+     */
+    CancelToken() = default;
+    CancelToken(std::shared_ptr<const State> state);
     operator bool() const;
     bool isCancelled() const;
     void throwIfCanceled() const;
+    /**
+     * @brief Этот метод возвращает ближайший срок выполнения в цепочке
+     * источников, Clock::time_point::max() - если срок не задан.
+     */
+    Clock::time_point deadline() const;
+    /**
+     * @brief Вызывать callback при отмене токена
+     *
+     * callback выполняется в потоке, вызвавшем CancellationSource::cancel(),
+     * и должен быть коротким. Истечение срока выполнения callback не
+     * вызывает. Отмену, случившуюся до подписки, нужно проверить отдельно.
+     */
+    Subscription subscribe(std::function<void()> callback) const;
 
 private:
-    std::shared_ptr<std::atomic_bool> m_isCanceled;
+    friend class CancellationSource;
+
+    std::shared_ptr<const State> m_state;
 };
 
 class CancellationSource
 {
 public:
+    typedef CancelToken::Clock Clock;
+
+    CancellationSource();
+    /**
+     * @param parent - токен, отмена которого отменяет и этот источник
+     * @param deadline - срок, по истечении которого токен считается отмененным
+     */
+    CancellationSource(CancelToken parent,
+                       Clock::time_point deadline = Clock::time_point::max());
+
     CancelToken token() const;
     void cancel();
 
 private:
-    std::shared_ptr<std::atomic_bool> m_isCanceled =
-            std::make_shared<std::atomic_bool>();
+    std::shared_ptr<CancelToken::State> m_state;
 };
 
 class CancelledException : public std::exception
@@ -0,0 +1,70 @@
+#include "Crc16.h"
+
+namespace {
+
+constexpr uint16_t kPolynomial = 0x1021;
+
+/**
+ * Таблица k содержит CRC байта, за которым следуют k нулевых байт, поэтому
+ * восемь байт сообщения обрабатываются восемью независимыми выборками.
+ */
+struct Tables
+{
+    Tables()
+    {
+        for (int byte = 0; byte < 256; ++byte) {
+            uint16_t crc = static_cast<uint16_t>(byte << 8);
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = static_cast<uint16_t>(crc & 0x8000 ? (crc << 1) ^ kPolynomial : crc << 1);
+            }
+            slice[0][byte] = crc;
+        }
+        for (int k = 1; k < 8; ++k) {
+            for (int byte = 0; byte < 256; ++byte) {
+                uint16_t prev = slice[k - 1][byte];
+                slice[k][byte] = static_cast<uint16_t>((prev << 8) ^ slice[0][prev >> 8]);
+            }
+        }
+    }
+
+    uint16_t slice[8][256];
+};
+
+const Tables &tables()
+{
+    static const Tables instance;
+    return instance;
+}
+
+} // namespace
+
+uint16_t Crc16::direct(uint16_t crc, const void *data, std::size_t size)
+{
+    auto &&t = tables().slice;
+    auto p = static_cast<const uint8_t *>(data);
+    for (; size >= 8; size -= 8, p += 8) {
+        crc = static_cast<uint16_t>(t[7][p[0] ^ (crc >> 8)] ^ t[6][p[1] ^ (crc & 0xFF)]
+                                  ^ t[5][p[2]] ^ t[4][p[3]] ^ t[3][p[4]]
+                                  ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]]);
+    }
+    for (; size > 0; --size, ++p) {
+        crc = static_cast<uint16_t>((crc << 8) ^ t[0][(crc >> 8) ^ *p]);
+    }
+    return crc;
+}
+
+uint16_t Crc16::update(uint16_t sum, const void *data, std::size_t size)
+{
+    auto p = static_cast<const uint8_t *>(data);
+    if (size == 0) {
+        return sum;
+    }
+    if (size == 1) {
+        // Старший байт регистра выдвигается, младший и новый байт остаются
+        return static_cast<uint16_t>(tables().slice[0][sum >> 8] ^ ((sum & 0xFF) << 8 | p[0]));
+    }
+    // Начальное значение вдвигающего алгоритма соответствует A·x^16 прямого
+    static const uint8_t zeros[2] = { 0, 0 };
+    auto crc = direct(direct(sum, zeros, sizeof(zeros)), p, size - 2);
+    return static_cast<uint16_t>(crc ^ (p[size - 2] << 8 | p[size - 1]));
+}
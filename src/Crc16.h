@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief CRC-CCITT (полином 0x1021) протокола загрузчика
+ *
+ * Загрузчик считает контрольную сумму «с вдвиганием»: каждый бит сообщения
+ * вдвигается в младший разряд регистра, а полином вычитается по
+ * выдвинутому старшему, то есть регистр равен остатку от деления
+ * A·x^8n + M на полином. Для сообщения длиной n >= 2 это дает тождество с
+ * прямым (табличным) CRC
+ *
+ *     update(A, M) = direct(A·x^16 mod P, M[0..n-2)) ^ (M[n-2] << 8 | M[n-1]),
+ *
+ * так как A·x^8n + M = (A·x^16·x^8(n-2) + M[0..n-2))·x^16 плюс последние
+ * 16 бит, уже меньшие полинома. Прямой CRC считается таблицами по 8 байт
+ * за шаг (slicing-by-8).
+ */
+class Crc16
+{
+public:
+    /**
+     * @brief Продолжить контрольную сумму загрузчика
+     *
+     * Результат совпадает с побитовым алгоритмом загрузчика, в том числе
+     * при разбиении сообщения на части.
+     */
+    static uint16_t update(uint16_t sum, const void *data, std::size_t size);
+    /**
+     * @brief Прямой CRC-CCITT без отражения и конечного XOR
+     */
+    static uint16_t direct(uint16_t crc, const void *data, std::size_t size);
+};
@@ -48,6 +48,11 @@ const DeviceData &Device::data() const
     return m_data;
 }
 
+const PollPlan &Device::pollPlan() const
+{
+    return m_pollPlan;
+}
+
 int Device::controlModule() const
 {
     return m_data.config.control;
@@ -105,10 +110,21 @@ void Device::setConfig(const MDM500M::DeviceConfig &config)
         }
         emit moduleReplaced(module);
     }
+    compilePollPlan();
     emit controlModuleChanged(m_data.config.control);
     updateErrorStatus();
 }
 
+void Device::compilePollPlan()
+{
+    m_pollPlan.signalLevels = false;
+    m_pollPlan.moduleStates = false;
+    for (auto &&module : m_modules) {
+        m_pollPlan.signalLevels = m_pollPlan.signalLevels || !module->isEmpty();
+        m_pollPlan.moduleStates = m_pollPlan.moduleStates || module->hasModuleStates();
+    }
+}
+
 void Device::setErrors(MDM500M::DeviceErrors errors)
 {
     for (int slot = 0; slot < moduleCount(); ++slot) {
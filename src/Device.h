@@ -43,6 +43,12 @@ public:
     Module *module(int slot) const;
     int moduleCount() const;
     const DeviceData &data() const;
+    /**
+     * @brief Набор команд опроса для текущей конфигурации
+     *
+     * Пересчитывается в setConfig() при замене модулей.
+     */
+    const PollPlan &pollPlan() const;
     int controlModule() const;
     QString name() const;
     QString serialNumber() const;
@@ -67,8 +73,10 @@ signals:
 private:
     void updateErrorStatus();
     void checkLowLevels();
+    void compilePollPlan();
 
     DeviceData m_data;
+    PollPlan m_pollPlan;
     std::array<Module *, MDM500M::kSlotCount> m_modules;
     std::shared_ptr<Interfaces::ModuleFabric> m_moduleFabric;
     QString m_name;
@@ -0,0 +1,134 @@
+#include <QSerialPortInfo>
+#include <QSettings>
+
+#ifdef Q_OS_LINUX
+#include <QDir>
+#include <QFileInfo>
+#endif
+
+#include "DeviceCache.h"
+
+namespace {
+
+// QSettings считает '/' разделителем групп, поэтому идентификатор кодируется
+QString toKey(const QString &portId)
+{
+    return QString::fromLatin1(portId.toUtf8().toHex());
+}
+
+QString fromKey(const QString &key)
+{
+    return QString::fromUtf8(QByteArray::fromHex(key.toLatin1()));
+}
+
+} // namespace
+
+DeviceCache::DeviceCache(const QString &fileName)
+    : m_fileName(fileName)
+{
+    load();
+}
+
+QString DeviceCache::portId(const QString &address)
+{
+    return portIds({ address }, QSerialPortInfo::availablePorts()).first();
+}
+
+QStringList DeviceCache::portIds(const QStringList &addresses, const QList<QSerialPortInfo> &ports)
+{
+#ifdef Q_OS_LINUX
+    // Ссылки by-id читаются один раз на весь список
+    QFileInfoList byId;
+    bool byIdListed = false;
+#endif
+    QStringList ids;
+    for (auto &&address : addresses) {
+        QString id = address;
+        for (auto &&info : ports) {
+            if (info.portName() != address && info.systemLocation() != address) {
+                continue;
+            }
+            id = info.systemLocation();
+            if (!info.serialNumber().isEmpty()) {
+                id = QString("usb:%1:%2:%3")
+                        .arg(info.vendorIdentifier(), 4, 16, QChar('0'))
+                        .arg(info.productIdentifier(), 4, 16, QChar('0'))
+                        .arg(info.serialNumber());
+                break;
+            }
+#ifdef Q_OS_LINUX
+            if (!byIdListed) {
+                byId = QDir("/dev/serial/by-id").entryInfoList(QDir::System | QDir::Files);
+                byIdListed = true;
+            }
+            const auto target = QFileInfo(info.systemLocation()).canonicalFilePath();
+            for (auto &&link : byId) {
+                if (link.canonicalFilePath() == target) {
+                    id = link.absoluteFilePath();
+                    break;
+                }
+            }
+#endif
+            break;
+        }
+        ids << id;
+    }
+    return ids;
+}
+
+bool DeviceCache::find(const QString &address, Entry &entry) const
+{
+    auto it = m_entries.find(portId(address));
+    if (it == m_entries.end()) {
+        return false;
+    }
+    entry = it->second;
+    return true;
+}
+
+void DeviceCache::store(const QString &address, Entry entry)
+{
+    entry.address = address;
+    m_entries[portId(address)] = std::move(entry);
+    save();
+}
+
+bool DeviceCache::contains(const QString &address) const
+{
+    return containsPortId(portId(address));
+}
+
+bool DeviceCache::containsPortId(const QString &portId) const
+{
+    return m_entries.count(portId) > 0;
+}
+
+void DeviceCache::load()
+{
+    QSettings settings(m_fileName, QSettings::Format::IniFormat);
+    for (auto &&key : settings.childGroups()) {
+        settings.beginGroup(key);
+        Entry entry;
+        entry.address = settings.value("address").toString();
+        entry.type = settings.value("type").toString();
+        entry.info = settings.value("info").toByteArray();
+        entry.thresholdLevels = settings.value("thresholdLevels").toByteArray();
+        m_entries[fromKey(key)] = entry;
+        settings.endGroup();
+    }
+}
+
+void DeviceCache::save() const
+{
+    QSettings settings(m_fileName, QSettings::Format::IniFormat);
+    settings.clear();
+    for (auto &&item : m_entries) {
+        auto &&entry = item.second;
+        settings.beginGroup(toKey(item.first));
+        settings.setValue("address", entry.address);
+        settings.setValue("type", entry.type);
+        settings.setValue("info", entry.info);
+        settings.setValue("thresholdLevels", entry.thresholdLevels);
+        settings.endGroup();
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <map>
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class QSerialPortInfo;
+
+/**
+ * @brief Кэш устройств по постоянным идентификаторам портов
+ *
+ * Запоминает, какое устройство было подключено к порту, и последние
+ * прочитанные с него DeviceInfo и пороговые уровни. При переподключении к
+ * тому же порту DeviceDiscovery проверяет его первым, а начальное чтение
+ * данных обходится без повторного чтения порогов.
+ *
+ * Порт определяется не по имени, которое меняется при переподключении
+ * USB-адаптера, а по серийному номеру адаптера или пути /dev/serial/by-id.
+ * Кэш хранится в INI-файле и сохраняется при каждом изменении.
+ */
+class DeviceCache
+{
+public:
+    struct Entry
+    {
+        QString address;            /**< Адрес порта при последнем подключении */
+        QString type;               /**< Тип устройства (Device::type())       */
+        QByteArray info;            /**< DeviceInfo                            */
+        QByteArray thresholdLevels; /**< SignalLevels пороговых уровней        */
+    };
+
+    DeviceCache(const QString &fileName);
+
+    /**
+     * @brief Этот метод возвращает постоянный идентификатор порта.
+     *
+     * Для сетевых и виртуальных транспортов идентификатором служит адрес.
+     */
+    static QString portId(const QString &address);
+    /**
+     * @brief Идентификаторы портов списка по одному снимку списка портов
+     * системы
+     *
+     * Для обхода многих портов: portId() перечисляет порты при каждом
+     * вызове.
+     */
+    static QStringList portIds(const QStringList &addresses,
+                               const QList<QSerialPortInfo> &ports);
+
+    bool find(const QString &address, Entry &entry) const;
+    void store(const QString &address, Entry entry);
+    /**
+     * @brief Этот метод возвращает истину, если к порту уже подключалось
+     * устройство.
+     */
+    bool contains(const QString &address) const;
+    bool containsPortId(const QString &portId) const;
+
+private:
+    void load();
+    void save() const;
+
+    QString m_fileName;
+    std::map<QString, Entry> m_entries;
+};
@@ -0,0 +1,281 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "DeviceCache.h"
+#include "DeviceController.h"
+#include "EventLog.h"
+#include "NameRepository.h"
+#include "TransactionInvoker.h"
+
+DeviceController::DeviceController(const DeviceControllerBuilder &builder)
+    : m_device(builder.moduleFabric, builder.type)
+    , m_address(builder.address)
+    , m_transactionFabric(builder.transactionFabric)
+    , m_nameRepo(builder.nameRepo)
+    , m_cache(builder.cache)
+    , m_invoker(builder.invoker)
+    , m_log(new EventLog(m_device, this))
+{
+    connect(m_log, &EventLog::openFailed, this, &DeviceController::logFailed);
+}
+
+Device &DeviceController::device()
+{
+    return m_device;
+}
+
+const QString &DeviceController::address() const
+{
+    return m_address;
+}
+
+bool DeviceController::isReady() const
+{
+    return m_ready;
+}
+
+Interfaces::TransactionFabric &DeviceController::transactions() const
+{
+    return *m_transactionFabric;
+}
+
+void DeviceController::exec(Interfaces::Transaction *transaction)
+{
+    m_invoker->exec(transaction);
+}
+
+Interfaces::UpdateFirmware *DeviceController::updateFirmware(const Firmware &firmware)
+{
+    using Interfaces::UpdateFirmware;
+
+    auto transaction = m_transactionFabric->updateFirmware(firmware);
+    if (!transaction) {
+        return nullptr;
+    }
+    const auto version = firmware.softwareVersion();
+    connect(transaction, &UpdateFirmware::timingsMeasured, m_log, [=](auto &&timings)
+    {
+        m_log->firmwareUpdateTimings(version, timings);
+    });
+    connect(transaction, &UpdateFirmware::success, m_log, [=]
+    {
+        m_log->firmwareUpdateFinished(true);
+    });
+    connect(transaction, &UpdateFirmware::failure, m_log, [=]
+    {
+        m_log->firmwareUpdateFinished(false);
+    });
+    return transaction;
+}
+
+void DeviceController::initModel()
+{
+    using Interfaces::GetAllDeviceInfo;
+
+    qDebug("начата инициализация модели");
+    m_ready = false;
+    m_suspended = false;
+    DeviceCache::Entry cached;
+    bool isCached = m_cache && m_cache->find(m_address, cached) && cached.type == m_device.type();
+    auto transaction = m_transactionFabric->getAllDeviceInfo(isCached ? &cached : nullptr);
+    connect(transaction, &GetAllDeviceInfo::success, this, [=](auto &&response)
+    {
+        qDebug("инициализация модели завершена");
+
+        // Заполняем модель данными
+        m_device.setInfo(response.info);
+        m_device.setName(m_nameRepo->getName(m_device.type(), m_device.serialNumber()));
+        m_device.setConfig(response.config);
+        m_device.setThresholdLevels(response.thresholdLevels);
+        m_device.setSignalLevels(response.signalLevels);
+        storeInCache();
+        m_log->initialMessage(response.log);
+        m_lastPoll.signalLevels = response.signalLevels;
+        m_ready = true;
+        emit ready();
+    });
+    connect(transaction, &GetAllDeviceInfo::failure, this, [=]
+    {
+        qDebug("произошло отключение во время инициализации модели");
+        markDisconnected();
+    });
+    m_invoker->exec(transaction);
+}
+
+void DeviceController::suspendPolling()
+{
+    m_suspended = true;
+}
+
+bool DeviceController::canPoll() const
+{
+    return m_ready && !m_suspended && !m_pollInFlight && !m_disconnected;
+}
+
+void DeviceController::poll()
+{
+    using Interfaces::UpdateDeviceInfo;
+    using namespace std::chrono_literals;
+
+    qDebug("начато обновление модели");
+    m_pollInFlight = true;
+    m_pollClock.start();
+    // Ответ применяется по плану, с которым был отправлен запрос: конфигурация
+    // может смениться, пока опрос в очереди
+    auto plan = m_device.pollPlan();
+    auto transaction = m_transactionFabric->updateDeviceInfo(plan);
+    // Опрос, не выполненный за это время, уже не актуален
+    transaction->setDeadline(CancelToken::Clock::now() + 3s);
+    connect(transaction, &UpdateDeviceInfo::success, this, [=](auto &&response)
+    {
+        qDebug("обновление завершено");
+        bool changed = isChanged(response, plan);
+        // Обновляем модель
+        m_lastPoll.errors = response.errors;
+        m_device.setErrors(response.errors);
+        if (plan.signalLevels) {
+            m_lastPoll.signalLevels = response.signalLevels;
+            m_device.setSignalLevels(response.signalLevels);
+        }
+        if (plan.moduleStates) {
+            m_lastPoll.states = response.states;
+            m_device.setModuleStates(response.states);
+        }
+
+        m_pollInFlight = false;
+        emit polled(changed, std::chrono::milliseconds(m_pollClock.elapsed()));
+    });
+    connect(transaction, &UpdateDeviceInfo::failure, this, [=]
+    {
+        qDebug("произошло отключение во время обновления модели");
+        m_pollInFlight = false;
+        markDisconnected();
+    });
+    connect(transaction, &UpdateDeviceInfo::abandoned, this, [=]
+    {
+        qDebug("обновление модели отменено");
+        m_pollInFlight = false;
+        emit polled(false, std::chrono::milliseconds(m_pollClock.elapsed()));
+    });
+    m_invoker->exec(transaction);
+}
+
+bool DeviceController::isChanged(const Interfaces::UpdateDeviceInfo::Response &response,
+                                 const PollPlan &plan) const
+{
+    if (memcmp(&response.errors, &m_lastPoll.errors, sizeof(response.errors)) != 0) {
+        return true;
+    }
+    if (plan.moduleStates
+            && memcmp(&response.states, &m_lastPoll.states, sizeof(response.states)) != 0) {
+        return true;
+    }
+    if (!plan.signalLevels) {
+        return false;
+    }
+    // Уровень сигнала постоянно колеблется на единицу
+    for (int slot = 0; slot < MDM500M::kSlotCount; ++slot) {
+        if (std::abs(response.signalLevels[slot] - m_lastPoll.signalLevels[slot]) >= kLevelHysteresis) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void DeviceController::setName(const QString &name)
+{
+    m_device.setName(name);
+    m_nameRepo->setName(m_device.type(), m_device.serialNumber(), name);
+}
+
+void DeviceController::setControlModule(int slot)
+{
+    using Interfaces::SetControlModule;
+
+    qDebug("запрошено переключение контрольного канала");
+    auto transaction = m_transactionFabric->setControlModule(slot);
+    m_device.setControlModule(slot);
+    connect(transaction, &SetControlModule::success, this, [=]
+    {
+        qDebug("контрольный канал переключён");
+    });
+    connect(transaction, &SetControlModule::failure, this, [=]
+    {
+        qDebug("произошло отключение во время переключения контрольного канала");
+        markDisconnected();
+    });
+    m_invoker->exec(transaction);
+}
+
+void DeviceController::setModuleConfig(int slot)
+{
+    using Interfaces::SetModuleConfig;
+
+    qDebug("запрошено сохранение новых настроек модуля");
+    auto config = m_device.data().config.modules[slot];
+    auto transaction = m_transactionFabric->setModuleConfig(slot, config);
+    connect(transaction, &SetModuleConfig::success, this, [=]
+    {
+        qDebug("параметры модуля применены");
+    });
+    connect(transaction, &SetModuleConfig::wrongParametersDetected, this, [=]
+    {
+        qDebug("устройство сообщило о неверных значениях параметров (1)");
+        emit wrongParametersDetected();
+    });
+    connect(transaction, &SetModuleConfig::failure, this, [=]
+    {
+        qDebug("произошло отключение во время применения параметров модуля");
+        markDisconnected();
+    });
+    m_invoker->exec(transaction);
+}
+
+void DeviceController::setThresholdLevels()
+{
+    using Interfaces::SetThresholdLevels;
+
+    qDebug("запрошено сохранение пороговых уровней");
+    auto lvls = m_device.data().thresholdLevels;
+    auto transaction = m_transactionFabric->setThresholdLevels(lvls);
+    connect(transaction, &SetThresholdLevels::success, this, [=]
+    {
+        qDebug("пороговые уровни установлены");
+        storeInCache();
+    });
+    connect(transaction, &SetThresholdLevels::failure, this, [=]
+    {
+        qDebug("произошло отключение во время применения пороговых уровней");
+        markDisconnected();
+    });
+    m_invoker->exec(transaction);
+}
+
+void DeviceController::markDisconnected()
+{
+    if (m_disconnected) {
+        return ;
+    }
+    m_disconnected = true;
+    m_ready = false;
+    emit disconnected();
+}
+
+void DeviceController::storeInCache()
+{
+    if (!m_cache) {
+        return ;
+    }
+    auto &&data = m_device.data();
+    DeviceCache::Entry entry;
+    entry.type = m_device.type();
+    entry.info = QByteArray(reinterpret_cast<const char *>(&data.info), sizeof(data.info));
+    entry.thresholdLevels = QByteArray(reinterpret_cast<const char *>(&data.thresholdLevels),
+                                       sizeof(data.thresholdLevels));
+    m_cache->store(m_address, std::move(entry));
+}
+
+DeviceController *DeviceControllerBuilder::build() const
+{
+    return new DeviceController(*this);
+}
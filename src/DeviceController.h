@@ -0,0 +1,120 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+
+#include <QElapsedTimer>
+#include <QObject>
+
+#include "Device.h"
+#include "Transactions.h"
+
+class DeviceCache;
+class DeviceController;
+class EventLog;
+class NameRepository;
+class TransactionInvoker;
+
+struct DeviceControllerBuilder
+{
+    std::shared_ptr<TransactionInvoker> invoker;
+    std::shared_ptr<Interfaces::ModuleFabric> moduleFabric;
+    std::shared_ptr<Interfaces::TransactionFabric> transactionFabric;
+    std::shared_ptr<NameRepository> nameRepo;
+    std::shared_ptr<DeviceCache> cache;
+    DeviceType type;
+    QString address; /**< Адрес порта устройства */
+
+    DeviceController *build() const;
+};
+
+/**
+ * @brief Модель, опрос и журнал одного устройства без пользовательского
+ * интерфейса
+ *
+ * Контроллер читает данные устройства при подключении, опрашивает его по
+ * команде PollScheduler, ведет EventLog и обновляет DeviceCache. Представления
+ * (SettingsView, MiniView) создаются поверх контроллера и могут появляться
+ * и исчезать, не прерывая опроса.
+ */
+class DeviceController : public QObject
+{
+    Q_OBJECT
+
+public:
+    DeviceController(const DeviceControllerBuilder &builder);
+
+    Device &device();
+    const QString &address() const;
+    bool isReady() const;
+    Interfaces::TransactionFabric &transactions() const;
+    void exec(Interfaces::Transaction *transaction);
+    /**
+     * @brief Создать транзакцию обновления прошивки
+     *
+     * Длительность этапов и итог обновления записываются в журнал
+     * устройства. Транзакцию запускает вызывающий методом exec().
+     * @return nullptr, если устройство не поддерживает обновление
+     */
+    Interfaces::UpdateFirmware *updateFirmware(const Firmware &firmware);
+
+    /**
+     * @brief Перечитать все данные устройства (после обновления прошивки)
+     */
+    void initModel();
+    /**
+     * @brief Остановить опрос до следующего initModel()
+     */
+    void suspendPolling();
+    /**
+     * @brief Истина, если устройство прочитано и опрос не выполняется
+     */
+    bool canPoll() const;
+    /**
+     * @brief Начать один опрос; по его завершении излучается polled()
+     */
+    void poll();
+    void setName(const QString &name);
+    void setControlModule(int slot);
+    void setModuleConfig(int slot);
+    void setThresholdLevels();
+    /**
+     * @brief Сообщить о потере связи с устройством
+     *
+     * Опрос останавливается, сигнал disconnected() излучается один раз.
+     */
+    void markDisconnected();
+
+signals:
+    void ready();
+    /**
+     * @param changed опрос заметил изменение ошибок, состояний или уровней
+     * сигнала больше чем на kLevelHysteresis
+     * @param elapsed время от начала до завершения опроса
+     */
+    void polled(bool changed, std::chrono::milliseconds elapsed);
+    void disconnected();
+    void wrongParametersDetected();
+    void logFailed(const QString &message);
+
+private:
+    static constexpr int kLevelHysteresis = 2; /**< дБмкВ */
+
+    bool isChanged(const Interfaces::UpdateDeviceInfo::Response &response,
+                   const PollPlan &plan) const;
+    void storeInCache();
+
+    Device m_device;
+    QString m_address;
+    std::shared_ptr<Interfaces::TransactionFabric> m_transactionFabric;
+    std::shared_ptr<NameRepository> m_nameRepo;
+    std::shared_ptr<DeviceCache> m_cache;
+    std::shared_ptr<TransactionInvoker> m_invoker;
+    EventLog *m_log;
+    Interfaces::UpdateDeviceInfo::Response m_lastPoll {};
+    QElapsedTimer m_pollClock;
+    bool m_ready = false;
+    bool m_suspended = false;
+    bool m_pollInFlight = false;
+    bool m_disconnected = false;
+};
@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <vector>
+
+#include <QSerialPortInfo>
+#include <QTimer>
+
+#include "DeviceCache.h"
+#include "DeviceDiscovery.h"
+#include "PortWatcher.h"
+#include "Transactions.h"
+#include "TransactionInvoker.h"
+
+void PortRegistry::claim(const QString &address)
+{
+    m_claimed.insert(address);
+}
+
+void PortRegistry::release(const QString &address)
+{
+    m_claimed.erase(address);
+}
+
+bool PortRegistry::isClaimed(const QString &address) const
+{
+    return m_claimed.count(address) > 0;
+}
+
+QStringList PortRegistry::claimed() const
+{
+    QStringList addresses;
+    for (auto &&address : m_claimed) {
+        addresses << address;
+    }
+    return addresses;
+}
+
+DeviceDiscovery::DeviceDiscovery(std::shared_ptr<LinkReactor> reactor, QStringList addresses,
+                                 std::shared_ptr<DeviceCache> cache, QObject *parent)
+    : QObject(parent)
+    , m_reactor(std::move(reactor))
+    , m_addresses(std::move(addresses))
+    , m_cache(std::move(cache))
+    , m_rescan(new QTimer(this))
+    , m_watcher(new PortWatcher(this))
+{
+    m_rescan->setInterval(m_watcher->isSupported() ? kIdleRescanInterval : kRescanInterval);
+    connect(m_rescan, &QTimer::timeout, this, &DeviceDiscovery::rescan);
+    connect(m_watcher, &PortWatcher::changed, this, &DeviceDiscovery::onPortsChanged);
+}
+
+DeviceDiscovery::~DeviceDiscovery()
+{
+    stop();
+}
+
+void DeviceDiscovery::start()
+{
+    if (m_rescan->isActive()) {
+        return ;
+    }
+    m_rescan->start();
+    const auto ports = QSerialPortInfo::availablePorts();
+    m_serialPorts = serialPorts(ports);
+    enqueue(ordered(m_serialPorts + m_addresses, ports));
+}
+
+void DeviceDiscovery::stop()
+{
+    m_rescan->stop();
+    // Удаление очереди отменяет проверку
+    m_probes.clear();
+    m_pending.clear();
+}
+
+bool DeviceDiscovery::isActive() const
+{
+    return m_rescan->isActive();
+}
+
+void DeviceDiscovery::release(const QString &address)
+{
+    m_registry.release(address);
+    // Устройство могло пропасть ненадолго (перезапуск питания), а порт
+    // остался: он проверяется при периодических обходах
+    if (m_serialPorts.contains(address)) {
+        m_released.insert(address);
+    }
+}
+
+void DeviceDiscovery::setSerialPortsScanned(bool scanned)
+{
+    m_serialPortsScanned = scanned;
+}
+
+const PortRegistry &DeviceDiscovery::registry() const
+{
+    return m_registry;
+}
+
+QStringList DeviceDiscovery::serialPorts(const QList<QSerialPortInfo> &ports) const
+{
+    QStringList addresses;
+    if (m_serialPortsScanned) {
+        for (auto &&info : ports) {
+            addresses << info.portName();
+        }
+    }
+    return addresses;
+}
+
+QStringList DeviceDiscovery::ordered(const QStringList &addresses, const QList<QSerialPortInfo> &ports) const
+{
+    if (!m_cache) {
+        return addresses;
+    }
+    const auto ids = DeviceCache::portIds(addresses, ports);
+    std::vector<std::pair<bool, QString>> ordered;
+    ordered.reserve(static_cast<size_t>(addresses.size()));
+    for (int i = 0; i < addresses.size(); ++i) {
+        ordered.emplace_back(m_cache->containsPortId(ids[i]), addresses[i]);
+    }
+    std::stable_partition(ordered.begin(), ordered.end(), [](const std::pair<bool, QString> &port) {
+        return port.first;
+    });
+    QStringList result;
+    for (auto &&port : ordered) {
+        result << port.second;
+    }
+    return result;
+}
+
+void DeviceDiscovery::enqueue(const QStringList &addresses)
+{
+    for (auto &&address : addresses) {
+        if (!m_pending.contains(address)) {
+            m_pending << address;
+        }
+    }
+    scanPending();
+}
+
+void DeviceDiscovery::rescan()
+{
+    if (!m_watcher->isSupported()) {
+        onPortsChanged();
+    }
+    // Порты без устройства повторно не опрашиваются
+    QStringList addresses = m_addresses;
+    for (auto &&address : m_released) {
+        addresses << address;
+    }
+    enqueue(addresses);
+}
+
+void DeviceDiscovery::scanPending()
+{
+    while (!m_pending.isEmpty() && m_probes.size() < kMaxConcurrentProbes) {
+        auto address = m_pending.takeFirst();
+        if (!m_registry.isClaimed(address) && m_probes.count(address) == 0) {
+            probe(address);
+        }
+    }
+}
+
+void DeviceDiscovery::onPortsChanged()
+{
+    // Порты перечисляются один раз на уведомление: это медленно при
+    // десятках адаптеров
+    const auto ports = QSerialPortInfo::availablePorts();
+    const auto present = serialPorts(ports);
+    auto isPresent = [&](const QString &address) {
+        return present.contains(address) || m_addresses.contains(address);
+    };
+    for (auto it = m_probes.begin(); it != m_probes.end();) {
+        if (isPresent(it->first)) {
+            ++it;
+        }
+        else {
+            it = m_probes.erase(it);
+        }
+    }
+    for (auto &&address : m_registry.claimed()) {
+        if (!isPresent(address)) {
+            m_registry.release(address);
+            emit lost(address);
+        }
+    }
+    for (auto it = m_released.begin(); it != m_released.end();) {
+        if (isPresent(*it)) {
+            ++it;
+        }
+        else {
+            it = m_released.erase(it);
+        }
+    }
+    QStringList added;
+    for (auto &&address : present) {
+        if (!m_serialPorts.contains(address)) {
+            added << address;
+        }
+    }
+    m_serialPorts = present;
+    if (isActive()) {
+        enqueue(ordered(added, ports));
+    }
+}
+
+void DeviceDiscovery::probe(const QString &address)
+{
+    auto invoker = std::make_unique<TransactionInvoker>(m_reactor);
+    auto probe = invoker.get();
+    auto transaction = new SearchDevice(address);
+    // Сигналы приходят из потока проверки; очередь можно удалять только
+    // после возврата из обработчика
+    connect(transaction, &SearchDevice::found, this, [=](auto type)
+    {
+        QMetaObject::invokeMethod(this, [=] {
+            onProbeFinished(address, probe, true, type);
+        }, Qt::QueuedConnection);
+    });
+    connect(transaction, &SearchDevice::failure, this, [=]
+    {
+        QMetaObject::invokeMethod(this, [=] {
+            onProbeFinished(address, probe, false, DeviceType());
+        }, Qt::QueuedConnection);
+    });
+    invoker->exec(transaction);
+    m_probes[address] = std::move(invoker);
+}
+
+void DeviceDiscovery::onProbeFinished(const QString &address, TransactionInvoker *probe,
+                                      bool found, DeviceType type)
+{
+    auto it = m_probes.find(address);
+    if (it == m_probes.end() || it->second.get() != probe) {
+        // Проверка отменена вызовом stop()
+        return ;
+    }
+    std::shared_ptr<TransactionInvoker> invoker = std::move(it->second);
+    m_probes.erase(it);
+    if (found) {
+        m_released.erase(address);
+        m_registry.claim(address);
+        emit this->found(type, address, std::move(invoker));
+    }
+    // Порты текущего обхода ждали свободного места
+    if (isActive()) {
+        scanPending();
+    }
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <set>
+
+#include <QList>
+#include <QObject>
+#include <QStringList>
+
+#include "Types.h"
+
+class DeviceCache;
+class LinkReactor;
+class PortWatcher;
+class QSerialPortInfo;
+class QTimer;
+class TransactionInvoker;
+
+/**
+ * @brief Реестр портов, занятых найденными устройствами
+ */
+class PortRegistry
+{
+public:
+    void claim(const QString &address);
+    void release(const QString &address);
+    bool isClaimed(const QString &address) const;
+    QStringList claimed() const;
+
+private:
+    std::set<QString> m_claimed;
+};
+
+/**
+ * @brief Поиск устройств на всех портах одновременно
+ *
+ * Каждый порт, не занятый устройством и еще не проверяемый, проверяется
+ * транзакцией SearchDevice в собственном канале LinkReactor, так что полный
+ * обход занимает время одной проверки, а не сумму по всем портам. О
+ * найденном устройстве сообщается сразу по завершении его проверки; канал
+ * с открытым портом передается получателю сигнала found().
+ *
+ * При запуске проверяются все порты. Дальше по уведомлению PortWatcher
+ * проверяются только появившиеся порты (список сравнивается с предыдущим),
+ * а об исчезновении порта занятого устройства сообщает сигнал lost().
+ * Порты без устройства и с чужим оборудованием больше не опрашиваются.
+ * Периодически, раз в kIdleRescanInterval, проверяются только адреса,
+ * переданные в конструктор (сетевые и псевдотерминалы, о которых система
+ * не уведомляет), и порты отключенных устройств, пока порт не исчезнет
+ * или устройство не найдется снова. Если платформа не сообщает об
+ * изменениях, список портов сравнивается с предыдущим каждые
+ * kRescanInterval.
+ *
+ * Порты, к которым уже подключалось устройство (см. DeviceCache),
+ * проверяются первыми. Проверка блокирует поток, поэтому одновременно
+ * выполняется не больше kMaxConcurrentProbes проверок; остальные порты
+ * ждут завершения предыдущих.
+ */
+class DeviceDiscovery : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param addresses адреса транспортов, проверяемых помимо
+     * последовательных портов (см. Transport::create)
+     */
+    DeviceDiscovery(std::shared_ptr<LinkReactor> reactor, QStringList addresses,
+                    std::shared_ptr<DeviceCache> cache = nullptr,
+                    QObject *parent = nullptr);
+    ~DeviceDiscovery() override;
+
+    /**
+     * @brief Начать поиск
+     */
+    void start();
+    /**
+     * @brief Прекратить поиск и отменить начатые проверки
+     */
+    void stop();
+    bool isActive() const;
+    /**
+     * @brief Освободить порт отключенного устройства
+     */
+    void release(const QString &address);
+    const PortRegistry &registry() const;
+    /**
+     * @brief Проверять ли все последовательные порты системы
+     *
+     * Если выключено, проверяются только адреса, переданные в конструктор.
+     */
+    void setSerialPortsScanned(bool scanned);
+
+signals:
+    /**
+     * @brief Найдено устройство
+     * @param invoker очередь транзакций канала с открытым портом устройства
+     */
+    void found(DeviceType type, const QString &address,
+               std::shared_ptr<TransactionInvoker> invoker);
+    /**
+     * @brief Порт занятого устройства исчез из системы, порт освобожден
+     */
+    void lost(const QString &address);
+
+private:
+    static constexpr int kRescanInterval     = 1000;
+    static constexpr int kIdleRescanInterval = 10000;
+    static constexpr std::size_t kMaxConcurrentProbes = 16;
+
+    QStringList serialPorts(const QList<QSerialPortInfo> &ports) const;
+    /**
+     * @brief Порты, к которым уже подключалось устройство, - вперед
+     */
+    QStringList ordered(const QStringList &addresses, const QList<QSerialPortInfo> &ports) const;
+    void enqueue(const QStringList &addresses);
+    void rescan();
+    void scanPending();
+    void onPortsChanged();
+    void probe(const QString &address);
+    void onProbeFinished(const QString &address, TransactionInvoker *probe,
+                         bool found, DeviceType type);
+
+    std::shared_ptr<LinkReactor> m_reactor;
+    QStringList m_addresses;
+    std::shared_ptr<DeviceCache> m_cache;
+    PortRegistry m_registry;
+    std::map<QString, std::unique_ptr<TransactionInvoker>> m_probes;
+    QStringList m_pending;     /**< Порты, ждущие проверки                   */
+    QStringList m_serialPorts; /**< Последовательные порты при прошлом обходе */
+    std::set<QString> m_released; /**< Порты отключенных устройств            */
+    bool m_serialPortsScanned = true;
+    QTimer *m_rescan;
+    PortWatcher *m_watcher;
+};
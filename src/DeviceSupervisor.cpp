@@ -0,0 +1,217 @@
+#include <QDateTime>
+#include <QFile>
+#include <QTextStream>
+#include <QTimer>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "DeviceDiscovery.h"
+#include "DeviceSupervisor.h"
+#include "LinkReactor.h"
+#include "PollScheduler.h"
+#include "TransactionInvoker.h"
+
+using namespace std::chrono;
+
+namespace {
+
+qint64 residentBytes()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters {};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return static_cast<qint64>(counters.WorkingSetSize);
+#elif defined(Q_OS_LINUX)
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    auto fields = statm.readAll().split(' ');
+    if (fields.size() < 2) {
+        return 0;
+    }
+    return fields[1].toLongLong() * sysconf(_SC_PAGESIZE);
+#else
+    // Без /proc доступен только пиковый размер
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<qint64>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+milliseconds cpuTime()
+{
+#ifdef Q_OS_WIN
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return milliseconds::zero();
+    }
+    auto ticks = [](const FILETIME &time) {
+        return (static_cast<qint64>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    // FILETIME измеряется в интервалах по 100 нс
+    return milliseconds((ticks(kernel) + ticks(user)) / 10000);
+#else
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    auto time = [](const timeval &value) {
+        return seconds(value.tv_sec) + microseconds(value.tv_usec);
+    };
+    return duration_cast<milliseconds>(time(usage.ru_utime) + time(usage.ru_stime));
+#endif
+}
+
+} // namespace
+
+DeviceSupervisor::DeviceSupervisor(std::shared_ptr<LinkReactor> reactor, QStringList addresses,
+                                   std::shared_ptr<DeviceCache> cache, QObject *parent)
+    : QObject(parent)
+    , m_discovery(std::make_unique<DeviceDiscovery>(std::move(reactor), std::move(addresses), cache))
+    , m_scheduler(new PollScheduler(this))
+    , m_cache(std::move(cache))
+    , m_baseResidentBytes(residentBytes())
+    , m_footprintTimer(new QTimer(this))
+{
+    connect(m_discovery.get(), &DeviceDiscovery::found, this, &DeviceSupervisor::onDeviceFound);
+    connect(m_discovery.get(), &DeviceDiscovery::lost, this, &DeviceSupervisor::remove);
+    m_footprintTimer->setInterval(static_cast<int>(milliseconds(kFootprintInterval).count()));
+    connect(m_footprintTimer, &QTimer::timeout, this, &DeviceSupervisor::writeFootprint);
+}
+
+DeviceSupervisor::~DeviceSupervisor()
+{
+    m_discovery->stop();
+    writeFootprint();
+}
+
+void DeviceSupervisor::setBuilder(DeviceType type, const DeviceControllerBuilder &builder)
+{
+    m_builders[type] = builder;
+    m_builders[type].cache = m_cache;
+}
+
+void DeviceSupervisor::start()
+{
+    m_discovery->start();
+}
+
+void DeviceSupervisor::stop()
+{
+    m_discovery->stop();
+}
+
+DeviceController *DeviceSupervisor::controller(const QString &address) const
+{
+    auto it = m_controllers.find(address);
+    return it == m_controllers.end() ? nullptr : it->second.get();
+}
+
+std::vector<DeviceController *> DeviceSupervisor::controllers() const
+{
+    std::vector<DeviceController *> controllers;
+    controllers.reserve(m_controllers.size());
+    for (auto &&item : m_controllers) {
+        controllers.push_back(item.second.get());
+    }
+    return controllers;
+}
+
+PollScheduler &DeviceSupervisor::scheduler() const
+{
+    return *m_scheduler;
+}
+
+DeviceDiscovery &DeviceSupervisor::discovery() const
+{
+    return *m_discovery;
+}
+
+int DeviceSupervisor::count() const
+{
+    return static_cast<int>(m_controllers.size());
+}
+
+DeviceSupervisor::Footprint DeviceSupervisor::footprint() const
+{
+    Footprint footprint;
+    footprint.devices = count();
+    footprint.residentBytes = residentBytes();
+    footprint.residentBytesPerDevice = footprint.devices > 0
+            ? (footprint.residentBytes - m_baseResidentBytes) / footprint.devices
+            : 0;
+    footprint.cpuTime = cpuTime();
+    return footprint;
+}
+
+void DeviceSupervisor::setFootprintLog(const QString &fileName)
+{
+    m_footprintLog = fileName;
+    if (fileName.isEmpty()) {
+        m_footprintTimer->stop();
+    }
+    else {
+        m_footprintTimer->start();
+    }
+}
+
+void DeviceSupervisor::onDeviceFound(DeviceType type, const QString &address,
+                                     std::shared_ptr<TransactionInvoker> invoker)
+{
+    // Строитель такого типа зарегистрирован
+    Q_ASSERT(m_builders.find(type) != m_builders.end());
+
+    auto builder = m_builders[type];
+    builder.invoker = std::move(invoker);
+    builder.address = address;
+    auto controller = builder.build();
+    m_controllers[address].reset(controller);
+    connect(controller, &DeviceController::disconnected, this, [=]
+    {
+        remove(address);
+    });
+    m_scheduler->add(controller);
+    emit added(controller);
+    controller->initModel();
+}
+
+void DeviceSupervisor::remove(const QString &address)
+{
+    auto it = m_controllers.find(address);
+    if (it == m_controllers.end()) {
+        return ;
+    }
+    // Контроллер может быть источником текущего сигнала
+    auto controller = it->second.release();
+    m_controllers.erase(it);
+    m_discovery->release(address);
+    m_scheduler->remove(controller);
+    emit removed(controller);
+    controller->deleteLater();
+}
+
+void DeviceSupervisor::writeFootprint() const
+{
+    if (m_footprintLog.isEmpty()) {
+        return ;
+    }
+    QFile file(m_footprintLog);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Append)) {
+        return ;
+    }
+    auto current = footprint();
+    QTextStream out(&file);
+    out << QDateTime::currentDateTime().toString("dd.MM.yyyy hh:mm:ss")
+        << " devices=" << current.devices
+        << " rss=" << current.residentBytes / 1024 << "KiB"
+        << " rss/device=" << current.residentBytesPerDevice / 1024 << "KiB"
+        << " cpu=" << current.cpuTime.count() << "ms"
+        << endl;
+}
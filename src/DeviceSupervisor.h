@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <QObject>
+#include <QStringList>
+
+#include "DeviceController.h"
+
+class DeviceCache;
+class DeviceDiscovery;
+class LinkReactor;
+class PollScheduler;
+class QTimer;
+
+/**
+ * @brief Все подключенные устройства одного процесса
+ *
+ * Супервизор получает найденные устройства от DeviceDiscovery, создает для
+ * каждого DeviceController и удаляет его при отключении. Ограничения на
+ * число устройств нет: все каналы разделяют поток LinkReactor, контроллер
+ * не содержит виджетов, а опрос всех устройств планирует один
+ * PollScheduler.
+ *
+ * Раз в kFootprintInterval в журнал footprintLog() записывается размер
+ * резидентной памяти и затраченное процессорное время, в том числе в
+ * пересчете на одно устройство.
+ */
+class DeviceSupervisor : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Footprint
+    {
+        int devices;
+        qint64 residentBytes;            /**< Резидентная память процесса     */
+        qint64 residentBytesPerDevice;   /**< Прирост от начала работы        */
+        std::chrono::milliseconds cpuTime; /**< Процессорное время процесса   */
+    };
+
+    DeviceSupervisor(std::shared_ptr<LinkReactor> reactor, QStringList addresses,
+                     std::shared_ptr<DeviceCache> cache, QObject *parent = nullptr);
+    ~DeviceSupervisor() override;
+
+    void setBuilder(DeviceType type, const DeviceControllerBuilder &builder);
+    void start();
+    void stop();
+    DeviceController *controller(const QString &address) const;
+    /**
+     * @brief Все контроллеры по возрастанию адреса
+     */
+    std::vector<DeviceController *> controllers() const;
+    PollScheduler &scheduler() const;
+    DeviceDiscovery &discovery() const;
+    int count() const;
+    Footprint footprint() const;
+    void setFootprintLog(const QString &fileName);
+
+signals:
+    void added(DeviceController *controller);
+    /**
+     * @brief Устройство отключено; контроллер будет удален после возврата
+     * в цикл событий
+     */
+    void removed(DeviceController *controller);
+
+private:
+    static constexpr std::chrono::minutes kFootprintInterval { 1 };
+
+    void onDeviceFound(DeviceType type, const QString &address,
+                       std::shared_ptr<TransactionInvoker> invoker);
+    void remove(const QString &address);
+    void writeFootprint() const;
+
+    std::unordered_map<DeviceType, DeviceControllerBuilder> m_builders;
+    std::map<QString, std::unique_ptr<DeviceController>> m_controllers;
+    std::unique_ptr<DeviceDiscovery> m_discovery;
+    PollScheduler *m_scheduler;
+    std::shared_ptr<DeviceCache> m_cache;
+    qint64 m_baseResidentBytes;
+    QString m_footprintLog;
+    QTimer *m_footprintTimer;
+};
@@ -2,7 +2,6 @@
 #include <QDateTime>
 #include <QDir>
 #include <QFile>
-#include <QMessageBox>
 
 #include "Device.h"
 #include "Modules.h"
@@ -22,6 +21,16 @@ private:
     QString m_what;
 };
 
+namespace {
+
+QString &baseDirectory()
+{
+    static QString path;
+    return path;
+}
+
+} // namespace
+
 EventLog::EventLog(Device &device, QObject *parent)
     : QObject(parent)
     , m_device(device)
@@ -53,6 +62,32 @@ void EventLog::initialMessage(MDM500M::DeviceErrors log)
     subscribe();
 }
 
+void EventLog::firmwareUpdateTimings(SoftwareVersion version,
+                                     const Interfaces::UpdateFirmware::Timings &timings)
+{
+    if (!open()) {
+        return ;
+    }
+    out() << tr("Обновление прошивки до версии %1: перезагрузка %2 мс, "
+                "передача %3 мс, запуск %4 мс, всего %5 мс")
+             .arg(version.toString())
+             .arg(timings.reboot.count())
+             .arg(timings.flash.count())
+             .arg(timings.boot.count())
+             .arg(timings.total.count())
+          << endl;
+}
+
+void EventLog::firmwareUpdateFinished(bool succeeded)
+{
+    if (!open()) {
+        return ;
+    }
+    out() << (succeeded ? tr("Прошивка устройства обновлена")
+                        : tr("Не удалось обновить прошивку устройства"))
+          << endl;
+}
+
 void EventLog::subscribe()
 {
     for (int slot = 0; slot < m_device.moduleCount(); ++slot) {
@@ -100,9 +135,16 @@ void EventLog::reportCurrentErrors()
     }
 }
 
+void EventLog::setBaseDirectory(const QString &path)
+{
+    baseDirectory() = path;
+}
+
 QDir EventLog::getLogPath() const
 {
-    QDir path { QFileInfo(QCoreApplication::applicationFilePath()).path() };
+    QDir path { baseDirectory().isEmpty()
+                ? QFileInfo(QCoreApplication::applicationFilePath()).path()
+                : baseDirectory() };
     if (!path.exists("logs")) {
         if (!path.mkdir("logs")) {
             throw CannotCreateLogsDir();
@@ -170,9 +212,6 @@ bool EventLog::open()
     catch (CannotOpenFile &e) {
         caption = errorMsgTemplate.arg(e.qWhat());
     }
-    QMessageBox::warning(
-                nullptr,
-                tr("Ошибка создания файла журнала"),
-                caption);
+    emit openFailed(caption);
     return false;
 }
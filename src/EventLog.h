@@ -4,6 +4,7 @@
 #include <QObject>
 #include <QTextStream>
 
+#include "Transactions.h"
 #include "Types.h"
 
 class Device;
@@ -17,6 +18,18 @@ class EventLog : public QObject
 public:
     EventLog(Device &device, QObject *parent = nullptr);
     void initialMessage(MDM500M::DeviceErrors log);
+    void firmwareUpdateTimings(SoftwareVersion version,
+                               const Interfaces::UpdateFirmware::Timings &timings);
+    void firmwareUpdateFinished(bool succeeded);
+    /**
+     * @brief Задать каталог, в котором создается каталог logs
+     *
+     * По умолчанию - каталог исполняемого файла.
+     */
+    static void setBaseDirectory(const QString &path);
+
+signals:
+    void openFailed(const QString &message);
 
 private slots:
     void onModuleErrorsChanged();
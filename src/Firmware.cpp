@@ -1,3 +1,5 @@
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include <QDir>
@@ -5,6 +7,7 @@
 #include <QFileInfo>
 #include <QObject>
 
+#include "BootFrames.h"
 #include "BootLoad.h"
 #include "Types.h"
 #include "Firmware.h"
@@ -26,6 +29,54 @@ inline int my_log2(int x)
     return res;
 }
 
+/**
+ * @brief Содержимое файла прошивки
+ *
+ * Файл отображается в память; если платформа или файловая система этого не
+ * позволяют, он читается целиком в один буфер. Страницы прошивки выдаются
+ * как представления этой памяти, поэтому образ живет, пока на него
+ * ссылается хотя бы одна копия Firmware.
+ */
+class FirmwareImage
+{
+public:
+    explicit FirmwareImage(const QString &filePath)
+        : file(filePath)
+    {}
+
+    ~FirmwareImage()
+    {
+        if (map) {
+            file.unmap(map);
+        }
+    }
+
+    bool open()
+    {
+        if (!file.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+        map = file.map(0, file.size());
+        if (map) {
+            data = reinterpret_cast<const char *>(map);
+        }
+        else {
+            buffer = file.readAll();
+            data = buffer.constData();
+        }
+        size = file.size();
+        return true;
+    }
+
+    QFile file;
+    uchar *map = nullptr;  /**< Отображение файла в память   */
+    QByteArray buffer;     /**< Содержимое, если отображения нет */
+    const char *data = nullptr;
+    qint64 size = 0;
+    mutable std::once_flag framesEncoded;
+    mutable std::shared_ptr<const BootFrames> frames; /**< Кадры загрузчика, см. Firmware::frames() */
+};
+
 class FirmwareData : public QSharedData
 {
 public:
@@ -34,7 +85,9 @@ public:
     int pageSize = 0;
     int pageSizeLog2 = 0;
     SoftwareVersion softVersion;
-    vector<QByteArray> pages;
+    std::shared_ptr<const FirmwareImage> image;
+    const char *pages = nullptr; /**< Первая страница внутри image */
+    int pageCount = 0;
     vector<HardwareVersion> hardCompList;
     vector<SoftwareVersion> softCompList;
 };
@@ -81,13 +134,7 @@ void Firmware::clearError()
 
 bool Firmware::checkFile(QString filePath, QString *errorString)
 {
-    QFileInfo fileInfo(filePath);
-    if (!fileInfo.exists()) {
-        setIfNotNull(errorString, QObject::tr("Файл не существует"));
-        return false;
-    }
-    if (fileInfo.suffix().toLower() != QLatin1String("bsk")) {
-        setIfNotNull(errorString, QObject::tr("Файл не является файлом прошивки"));
+    if (!checkFileName(filePath, errorString)) {
         return false;
     }
     QFile file(filePath);
@@ -95,15 +142,32 @@ bool Firmware::checkFile(QString filePath, QString *errorString)
         setIfNotNull(errorString, QObject::tr("Невозможно открыть файл: %1").arg(file.errorString()));
         return false;
     }
-    if (file.size() < qint64(sizeof(TFileHeader))) {
+    TFileHeader header;
+    if (file.read(reinterpret_cast<char *>(&header), sizeof(TFileHeader)) != qint64(sizeof(TFileHeader))) {
         qDebug("%s: File size less than size of TFileHeader", "Firmware");
         setIfNotNull(errorString, QObject::tr("Файл не является файлом прошивки"));
         return false;
     }
-    // Читаем заголовок
-    TFileHeader header;
-    file.read(reinterpret_cast<char *>(&header), sizeof(TFileHeader));
-    if (strcmp(header.ID, "BOOT_FILE") != 0) {
+    return checkHeader(header, file.size(), errorString);
+}
+
+bool Firmware::checkFileName(const QString &filePath, QString *errorString)
+{
+    QFileInfo fileInfo(filePath);
+    if (!fileInfo.exists()) {
+        setIfNotNull(errorString, QObject::tr("Файл не существует"));
+        return false;
+    }
+    if (fileInfo.suffix().toLower() != QLatin1String("bsk")) {
+        setIfNotNull(errorString, QObject::tr("Файл не является файлом прошивки"));
+        return false;
+    }
+    return true;
+}
+
+bool Firmware::checkHeader(const TFileHeader &header, qint64 fileSize, QString *errorString)
+{
+    if (qstrncmp(header.ID, "BOOT_FILE", sizeof(header.ID)) != 0) {
         qDebug("%s: TFileHeader::ID != BOOT_FILE", "Firmware");
         setIfNotNull(errorString, QObject::tr("Файл не является файлом прошивки"));
         return false;
@@ -113,8 +177,12 @@ bool Firmware::checkFile(QString filePath, QString *errorString)
         setIfNotNull(errorString, QObject::tr("Файл не является файлом прошивки"));
         return false;
     }
-    const auto theoreticalFileSize = fileSizeByHeader(header);
-    if (theoreticalFileSize != fileInfo.size()) {
+    if (header.PageSize <= sizeof(TPageHeader)) {
+        qDebug("%s: TFileHeader::PageSize too small", "Firmware");
+        setIfNotNull(errorString, QObject::tr("Файл не является файлом прошивки"));
+        return false;
+    }
+    if (fileSizeByHeader(header) != fileSize) {
         qDebug("%s: Wrong file size", "Firmware");
         setIfNotNull(errorString, QObject::tr("Файл не является файлом прошивки"));
         return false;
@@ -125,43 +193,53 @@ bool Firmware::checkFile(QString filePath, QString *errorString)
 bool Firmware::readFromFile(QString filePath)
 {
     clear();
-    if (!checkFile(filePath, &d->errorString)) {
-        // qWarning("%s: Wrong firmware file", "Firmware");
+    if (!checkFileName(filePath, &d->errorString)) {
         return false;
     }
-    // Считываем заголовок
-    QFile file(filePath);
-    file.open(QIODevice::ReadOnly);
+    // Файл открывается один раз; заголовок проверяется прямо в отображении
+    auto image = std::make_shared<FirmwareImage>(filePath);
+    if (!image->open()) {
+        d->errorString = QObject::tr("Невозможно открыть файл: %1").arg(image->file.errorString());
+        return false;
+    }
+    if (image->size < qint64(sizeof(TFileHeader))) {
+        qDebug("%s: File size less than size of TFileHeader", "Firmware");
+        d->errorString = QObject::tr("Файл не является файлом прошивки");
+        return false;
+    }
+    const char *pos = image->data;
     TFileHeader header;
-    file.read(reinterpret_cast<char *>(&header), sizeof(TFileHeader));
+    memcpy(&header, pos, sizeof(TFileHeader));
+    pos += sizeof(TFileHeader);
+    if (!checkHeader(header, image->size, &d->errorString)) {
+        return false;
+    }
     // d->softVersion = header.SoftwareVersion; // Не реализовано в упаковщике, всегда 0
     d->pageSize = header.PageSize;
     uint16_t temp;
-    // Считываем список совместимости железа
+    // Список совместимости железа
     d->hardCompList.reserve(header.CListLength);
     for (int i = 0; i < header.CListLength; ++i) {
-        file.read(reinterpret_cast<char *>(&temp), sizeof(temp));
+        memcpy(&temp, pos, sizeof(temp));
+        pos += sizeof(temp);
         header.HardwareVersion.modification = static_cast<uint8_t>(temp);
         d->hardCompList.push_back(header.HardwareVersion);
     }
-    // Считываем список совместимости софта
+    // Список совместимости софта
     d->softCompList.reserve(header.SCListLength);
     for (int i = 0; i < header.SCListLength; ++i) {
-        SoftwareVersion temp;
-        file.read(reinterpret_cast<char *>(&temp), sizeof(temp));
-        d->softVersion = std::max(d->softVersion, temp);
-        d->softCompList.push_back(temp);
-    }
-    // Считываем контрольную сумму, не проверятся (не реализованно в упаковщике)
-    file.read(reinterpret_cast<char *>(&temp), sizeof(temp));
-    // Считываем страницы
-    d->pages.reserve(header.NumPages);
-    QByteArray data;
-    for (uint page = 0; page < header.NumPages; ++page) {
-        data = file.read(header.PageSize);
-        Q_ASSERT(data.size() == header.PageSize);
-        d->pages.push_back(data);
+        memcpy(&temp, pos, sizeof(temp));
+        pos += sizeof(temp);
+        SoftwareVersion version(temp);
+        d->softVersion = std::max(d->softVersion, version);
+        d->softCompList.push_back(version);
     }
+    // Контрольная сумма не проверятся (не реализованно в упаковщике)
+    pos += sizeof(uint16_t);
+    // Страницы не копируются: page() выдает представления образа
+    d->pages = pos;
+    d->pageCount = header.NumPages;
+    d->image = std::move(image);
     d->filePath = QDir::toNativeSeparators(QFileInfo(filePath).absoluteFilePath());
     d->pageSizeLog2 = my_log2(header.PageSize - sizeof(TPageHeader));
     return true;
@@ -171,7 +249,9 @@ void Firmware::clear()
 {
     clearError();
     d->pageSize = 0;
-    d->pages.clear();
+    d->pages = nullptr;
+    d->pageCount = 0;
+    d->image.reset();
     d->filePath.clear();
     d->hardCompList.clear();
     d->softCompList.clear();
@@ -186,12 +266,24 @@ bool Firmware::isCompatible(HardwareVersion hv) const
 QByteArray Firmware::page(int id) const
 {
     Q_ASSERT(id >= 0 && id < pageCount());
-    return d->pages.at(static_cast<size_t>(id));
+    return QByteArray::fromRawData(d->pages + id * d->pageSize, d->pageSize);
+}
+
+std::shared_ptr<const BootFrames> Firmware::frames() const
+{
+    if (!d->image) {
+        return nullptr;
+    }
+    auto &&image = *d->image;
+    std::call_once(image.framesEncoded, [&] {
+        image.frames = std::make_shared<BootFrames>(*this);
+    });
+    return image.frames;
 }
 
 int Firmware::pageCount() const
 {
-    return static_cast<int>(d->pages.size());
+    return d->pageCount;
 }
 
 int Firmware::pageSize() const
@@ -211,7 +303,7 @@ QString Firmware::filePath() const
 
 bool Firmware::isNull() const
 {
-    return d->pages.empty();
+    return d->pageCount == 0;
 }
 
 int Firmware::pageSizeLog2() const
@@ -1,13 +1,20 @@
 #pragma once
 
+#include <memory>
+
 #include <QSharedDataPointer>
 
 #include "Types.h"
 
+class BootFrames;
 class FirmwareData;
 
 /**
  * @brief Прошивка
+ *
+ * Файл прошивки отображается в память и не копируется: страницы - это
+ * представления только для чтения внутри отображения. Копии Firmware
+ * разделяют одно отображение, оно освобождается вместе с последней копией.
  */
 class Firmware
 {
@@ -57,8 +64,18 @@ public:
     /**
      * @brief Этот метод возвращает страницу по её номеру.
      * @param[in] id - Номер страницы
+     * @return Представление страницы без копирования; действительно, пока
+     * существует хотя бы одна копия этой прошивки.
      */
     QByteArray page(int id) const;
+    /**
+     * @brief Кадры загрузчика для всех страниц
+     *
+     * Кодируются при первом обращении, один раз на загруженный файл, и
+     * разделяются всеми копиями прошивки; метод потокобезопасен.
+     * @return nullptr, если прошивка не загружена
+     */
+    std::shared_ptr<const BootFrames> frames() const;
     /**
      * @brief Этот метод возвращает количество страниц загруженного файла
      */
@@ -85,6 +102,9 @@ public:
     int pageSizeLog2() const;
 
 private:
+    static bool checkFileName(const QString &filePath, QString *errorString);
+    static bool checkHeader(const class TFileHeader &header, qint64 fileSize,
+                            QString *errorString);
     /**
      * @brief Этот метод возвращает теоретический размер файла, исходя из
      * заголовочной информации.
@@ -0,0 +1,243 @@
+#include <algorithm>
+
+#include "DeviceController.h"
+#include "FirmwareRollout.h"
+
+FirmwareRollout::FirmwareRollout(Firmware firmware, const std::vector<DeviceController *> &devices,
+                                 QObject *parent)
+    : QObject(parent)
+    , m_firmware(std::move(firmware))
+{
+    m_jobs.reserve(devices.size());
+    for (auto &&device : devices) {
+        Job job;
+        job.device = device;
+        job.key = device;
+        m_jobs.push_back(job);
+    }
+}
+
+void FirmwareRollout::setSettings(const Settings &settings)
+{
+    if (m_started) {
+        return ;
+    }
+    m_settings = settings;
+    m_settings.parallelism = std::max(m_settings.parallelism, 1);
+    m_settings.canaries = std::max(m_settings.canaries, 0);
+    m_settings.maxFailures = std::max(m_settings.maxFailures, 1);
+}
+
+const FirmwareRollout::Settings &FirmwareRollout::settings() const
+{
+    return m_settings;
+}
+
+void FirmwareRollout::start()
+{
+    if (m_started) {
+        return ;
+    }
+    m_started = true;
+    // Кадры кодируются до начала, а не в потоке первого устройства
+    m_firmware.frames();
+    emit progressMaxChanged(static_cast<int>(m_jobs.size()) * m_firmware.pageCount());
+    emit progressChanged(0);
+    launch();
+}
+
+void FirmwareRollout::halt()
+{
+    m_halted = true;
+    launch();
+}
+
+bool FirmwareRollout::isHalted() const
+{
+    return m_halted;
+}
+
+bool FirmwareRollout::isFinished() const
+{
+    return m_finished;
+}
+
+FirmwareRollout::State FirmwareRollout::state(const DeviceController *device) const
+{
+    for (auto &&job : m_jobs) {
+        if (job.key == device) {
+            return job.state;
+        }
+    }
+    return State::Skipped;
+}
+
+int FirmwareRollout::count(State state) const
+{
+    return static_cast<int>(std::count_if(m_jobs.begin(), m_jobs.end(), [=](const Job &job) {
+        return job.state == state;
+    }));
+}
+
+void FirmwareRollout::launch()
+{
+    if (!m_started || m_finished) {
+        return ;
+    }
+    for (std::size_t i = 0; i < m_jobs.size(); ++i) {
+        if (m_jobs[i].state != State::Pending) {
+            continue ;
+        }
+        if (m_halted) {
+            m_jobs[i].state = State::Skipped;
+            continue ;
+        }
+        // Остальные устройства ждут успеха всех контрольных
+        if (m_canaries >= m_settings.canaries && !canariesPassed()) {
+            break;
+        }
+        if (m_running >= m_settings.parallelism) {
+            break;
+        }
+        run(i);
+    }
+    updateProgress();
+    if (m_running == 0 && count(State::Pending) == 0) {
+        m_finished = true;
+        emit finished(!m_halted);
+    }
+}
+
+void FirmwareRollout::run(std::size_t index)
+{
+    using Interfaces::UpdateFirmware;
+
+    auto &&job = m_jobs[index];
+    auto device = job.device.data();
+    auto transaction = device ? device->updateFirmware(m_firmware) : nullptr;
+    if (!transaction) {
+        job.state = State::Skipped;
+        return ;
+    }
+    job.state = State::Running;
+    ++m_running;
+    // Контрольными становятся только начатые устройства
+    if (m_canaries < m_settings.canaries) {
+        job.canary = true;
+        ++m_canaries;
+    }
+
+    connect(transaction, &UpdateFirmware::statusChanged, this, [=](auto status)
+    {
+        onStatusChanged(index, status);
+    });
+    connect(transaction, &UpdateFirmware::progressChanged, this, [=](int progress)
+    {
+        onProgressChanged(index, progress);
+    });
+    connect(transaction, &UpdateFirmware::success, this, [=]
+    {
+        onFinished(index, true);
+    });
+    connect(transaction, &UpdateFirmware::failure, this, [=]
+    {
+        onFinished(index, false);
+    });
+    connect(transaction, &UpdateFirmware::abandoned, this, [=]
+    {
+        onFinished(index, false);
+    });
+    // Отмененная блокирующая транзакция удаляется, не излучив результата
+    connect(transaction, &QObject::destroyed, this, [=]
+    {
+        onFinished(index, false);
+    });
+
+    emit deviceStarted(device);
+    device->suspendPolling();
+    device->exec(transaction);
+}
+
+void FirmwareRollout::onStatusChanged(std::size_t index, Interfaces::UpdateFirmware::Status status)
+{
+    auto &&job = m_jobs[index];
+    if (job.state != State::Running) {
+        return ;
+    }
+    job.status = status;
+    emit deviceStatusChanged(job.key, status);
+    updateProgress();
+}
+
+void FirmwareRollout::onProgressChanged(std::size_t index, int progress)
+{
+    auto &&job = m_jobs[index];
+    // Во время ожидания загрузки ход неизвестен (-1)
+    if (job.state != State::Running || progress < 0) {
+        return ;
+    }
+    job.progress = progress;
+    updateProgress();
+}
+
+void FirmwareRollout::onFinished(std::size_t index, bool succeeded)
+{
+    auto &&job = m_jobs[index];
+    if (job.state != State::Running) {
+        return ;
+    }
+    job.state = succeeded ? State::Succeeded : State::Failed;
+    --m_running;
+    if (!succeeded) {
+        ++m_failures;
+        if (job.canary || m_failures >= m_settings.maxFailures) {
+            m_halted = true;
+        }
+    }
+    // Контроллер перечитывает устройство и возобновляет опрос
+    if (job.device) {
+        job.device->initModel();
+    }
+    emit deviceFinished(job.key, succeeded);
+    launch();
+}
+
+int FirmwareRollout::jobProgress(const Job &job) const
+{
+    using Interfaces::UpdateFirmware;
+
+    const int pages = m_firmware.pageCount();
+    switch (job.state) {
+    case State::Pending:
+        return 0;
+    case State::Running:
+        switch (job.status) {
+        case UpdateFirmware::Reboot:
+            return 0;
+        case UpdateFirmware::Flash:
+            return std::min(job.progress, pages);
+        case UpdateFirmware::WaitForBoot:
+            return std::max(pages - 1, 0);
+        }
+        return 0;
+    default:
+        // Завершенные и пропущенные устройства больше не изменятся
+        return pages;
+    }
+}
+
+void FirmwareRollout::updateProgress()
+{
+    int progress = 0;
+    for (auto &&job : m_jobs) {
+        progress += jobProgress(job);
+    }
+    emit progressChanged(progress);
+}
+
+bool FirmwareRollout::canariesPassed() const
+{
+    return std::all_of(m_jobs.begin(), m_jobs.end(), [](const Job &job) {
+        return !job.canary || job.state == State::Succeeded;
+    });
+}
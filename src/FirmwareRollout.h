@@ -0,0 +1,115 @@
+#pragma once
+
+#include <vector>
+
+#include <QObject>
+#include <QPointer>
+
+#include "Firmware.h"
+#include "Transactions.h"
+
+class DeviceController;
+
+/**
+ * @brief Обновление прошивки группы устройств
+ *
+ * Устройства прошиваются одновременно, но не больше Settings::parallelism
+ * за раз: каждое на своей линии, а кадры загрузчика (см. BootFrames)
+ * кодируются один раз и общие для всех.
+ *
+ * Первые Settings::canaries начатых устройств списка - контрольные:
+ * пропущенное устройство контрольным не считается, и его место занимает
+ * следующее. Остальные не начинаются, пока все контрольные не обновятся
+ * успешно, а отказ любого контрольного останавливает обновление. После них
+ * обновление останавливается, когда число отказов достигает
+ * Settings::maxFailures.
+ * Остановка не прерывает уже начатые прошивки - прерванная запись страниц
+ * оставила бы устройство без прошивки, - а только не начинает новые.
+ *
+ * Совместимость прошивки с устройствами проверяет вызывающий (см. Daemon);
+ * устройства, для которых фабрика транзакций не умеет обновлять прошивку,
+ * пропускаются.
+ */
+class FirmwareRollout : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Settings
+    {
+        int parallelism = 4;
+        int canaries    = 1;
+        int maxFailures = 1;
+    };
+
+    enum class State
+    {
+        Pending,
+        Running,
+        Succeeded,
+        Failed,
+        Skipped  /**< Не начиналось: не поддерживается или остановлено */
+    };
+
+    FirmwareRollout(Firmware firmware, const std::vector<DeviceController *> &devices,
+                    QObject *parent = nullptr);
+
+    /**
+     * @brief Задать параметры обновления; действует только до start()
+     */
+    void setSettings(const Settings &settings);
+    const Settings &settings() const;
+    void start();
+    /**
+     * @brief Не начинать новых прошивок; начатые завершаются
+     */
+    void halt();
+    bool isHalted() const;
+    bool isFinished() const;
+    State state(const DeviceController *device) const;
+    int count(State state) const;
+
+signals:
+    void deviceStarted(DeviceController *device);
+    void deviceStatusChanged(DeviceController *device, Interfaces::UpdateFirmware::Status status);
+    void deviceFinished(DeviceController *device, bool succeeded);
+    /**
+     * @brief Суммарный ход обновления в страницах по всем устройствам
+     */
+    void progressChanged(int progress);
+    void progressMaxChanged(int progressMax);
+    /**
+     * @param completed ложь, если обновление было остановлено
+     */
+    void finished(bool completed);
+
+private:
+    struct Job
+    {
+        QPointer<DeviceController> device;
+        DeviceController *key;  /**< Адрес для поиска, в том числе удаленного */
+        State state = State::Pending;
+        Interfaces::UpdateFirmware::Status status = Interfaces::UpdateFirmware::Reboot;
+        int progress = 0;
+        bool canary = false;
+    };
+
+    void launch();
+    void run(std::size_t index);
+    void onStatusChanged(std::size_t index, Interfaces::UpdateFirmware::Status status);
+    void onProgressChanged(std::size_t index, int progress);
+    void onFinished(std::size_t index, bool succeeded);
+    int jobProgress(const Job &job) const;
+    void updateProgress();
+    bool canariesPassed() const;
+
+    Firmware m_firmware;
+    Settings m_settings;
+    std::vector<Job> m_jobs;
+    int m_running = 0;
+    int m_failures = 0;
+    int m_canaries = 0;  /**< Начатых контрольных устройств */
+    bool m_started = false;
+    bool m_halted = false;
+    bool m_finished = false;
+};
@@ -0,0 +1,154 @@
+#include <algorithm>
+
+#include <QIODevice>
+
+#include "FrameDecoder.h"
+
+static_assert((FrameDecoder::kCapacity & (FrameDecoder::kCapacity - 1)) == 0,
+              "Размер буфера должен быть степенью двойки");
+static_assert(FrameDecoder::kCapacity >= 2 * FrameDecoder::kMaxPackageSize,
+              "В буфер должны помещаться хотя бы два пакета");
+
+constexpr uint8_t FrameDecoder::kPackageMarker;
+constexpr uint8_t FrameDecoder::kMinValueOfSizeField;
+constexpr int     FrameDecoder::kMinPackageSize;
+constexpr int     FrameDecoder::kMaxPackageSize;
+constexpr int     FrameDecoder::kCapacity;
+
+static constexpr int kMask = FrameDecoder::kCapacity - 1;
+
+FrameDecoder::FrameDecoder()
+{
+}
+
+int FrameDecoder::fill(QIODevice &device)
+{
+    int total = 0;
+    for (int segment = 0; segment < 2; ++segment) {
+        qint64 available = device.bytesAvailable();
+        if (available <= 0) {
+            break;
+        }
+        if (m_count == kCapacity) {
+            // Сюда попадаем, только если буфер забит мусором без маркеров
+            consume(kCapacity - kMaxPackageSize);
+        }
+        int tail = (m_head + m_count) & kMask;
+        int contiguous = std::min(kCapacity - m_count, kCapacity - tail);
+        qint64 received = device.read(reinterpret_cast<char *>(m_buffer + tail),
+                                      std::min<qint64>(contiguous, available));
+        if (received <= 0) {
+            break;
+        }
+        m_count += static_cast<int>(received);
+        total   += static_cast<int>(received);
+    }
+    return total;
+}
+
+int FrameDecoder::append(const void *data, int size)
+{
+    auto bytes = reinterpret_cast<const uint8_t *>(data);
+    size = std::min(size, kCapacity - m_count);
+    for (int i = 0; i < size; ++i) {
+        m_buffer[(m_head + m_count + i) & kMask] = bytes[i];
+    }
+    m_count += size;
+    return size;
+}
+
+void FrameDecoder::clear()
+{
+    m_head = 0;
+    m_count = 0;
+}
+
+int FrameDecoder::size() const
+{
+    return m_count;
+}
+
+int FrameDecoder::rejectedCount() const
+{
+    return m_rejected;
+}
+
+uint8_t FrameDecoder::at(int offset) const
+{
+    return m_buffer[(m_head + offset) & kMask];
+}
+
+void FrameDecoder::consume(int count)
+{
+    Q_ASSERT(count >= 0 && count <= m_count);
+    m_head   = (m_head + count) & kMask;
+    m_count -= count;
+    if (m_count == 0) {
+        m_head = 0;
+    }
+}
+
+bool FrameDecoder::seekMarker(int from, int &offset) const
+{
+    // Непрерывный участок до конца буфера, затем продолжение с его начала
+    while (from < m_count) {
+        int begin = (m_head + from) & kMask;
+        int length = std::min(m_count - from, kCapacity - begin);
+        auto found = static_cast<const uint8_t *>(
+                    memchr(m_buffer + begin, kPackageMarker, static_cast<size_t>(length)));
+        if (found) {
+            offset = from + static_cast<int>(found - (m_buffer + begin));
+            return true;
+        }
+        from += length;
+    }
+    return false;
+}
+
+FrameDecoder::Candidate FrameDecoder::check(int offset, const uint8_t *&frame)
+{
+    const int available = m_count - offset;
+    if (available < kMinPackageSize) {
+        return Candidate::Incomplete;
+    }
+    const uint8_t sizeField = at(offset + 1);
+    if (sizeField < kMinValueOfSizeField) {
+        return Candidate::Invalid;
+    }
+    const int total = sizeField + 2;
+    if (available < total) {
+        return Candidate::Incomplete;
+    }
+
+    int begin = (m_head + offset) & kMask;
+    if (begin + total <= kCapacity) {
+        frame = m_buffer + begin;
+    }
+    else {
+        int first = kCapacity - begin;
+        memcpy(m_scratch, m_buffer + begin, static_cast<size_t>(first));
+        memcpy(m_scratch + first, m_buffer, static_cast<size_t>(total - first));
+        frame = m_scratch;
+    }
+
+    // КС - сумма полей размера, команды и данных
+    uint8_t crc = 0;
+    for (int i = 1; i < total - 1; ++i) {
+        crc = static_cast<uint8_t>(crc + frame[i]);
+    }
+    return crc == frame[total - 1] ? Candidate::Valid : Candidate::Invalid;
+}
+
+bool FrameDecoder::resync()
+{
+    int offset = 0;
+    while (seekMarker(offset + 1, offset)) {
+        const uint8_t *frame;
+        if (check(offset, frame) == Candidate::Valid) {
+            ++m_rejected;
+            consume(offset);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+class QIODevice;
+
+/**
+ * @brief Декодер пакетов протокола МДМ-500(М)
+ *
+ * Принятые байты складываются в кольцевой буфер фиксированного размера.
+ * Начало пакета ищется по маркеру (memchr), размер и контрольная сумма
+ * проверяются на месте, а данные пакета передаются обработчику указателем
+ * в буфер, без выделения памяти. При ошибке контрольной суммы отбрасывается
+ * только байт маркера, поэтому синхронизация восстанавливается на ближайшем
+ * корректном пакете, а не по таймауту.
+ */
+class FrameDecoder
+{
+public:
+    static constexpr uint8_t kPackageMarker       = 0xA5;
+    static constexpr uint8_t kMinValueOfSizeField = 2;
+    static constexpr int     kMinPackageSize      = 4;   /**< Маркер, размер, команда и КС */
+    static constexpr int     kMaxPackageSize      = 257; /**< Пакет с полем размера 0xFF */
+    static constexpr int     kCapacity            = 1024;/**< Степень двойки */
+
+    FrameDecoder();
+
+    /**
+     * @brief Этот метод забирает из устройства все доступные байты.
+     * @return Количество прочитанных байт
+     */
+    int fill(QIODevice &device);
+
+    /**
+     * @brief Этот метод добавляет байты в буфер (для тестов и симуляторов).
+     * @return Количество добавленных байт
+     */
+    int append(const void *data, int size);
+
+    /**
+     * @brief Этот метод извлекает из буфера корректные пакеты и передает их
+     * обработчику, пока тот не примет один из них.
+     * @param[in] handler - bool(uint8_t cmd, const void *data, int size)
+     * @return Вернет истину, если обработчик принял пакет, ложь - если
+     * данных в буфере для этого недостаточно.
+     */
+    template <typename Handler>
+    bool decode(Handler &&handler);
+
+    /**
+     * @brief Очистить буфер
+     */
+    void clear();
+
+    /**
+     * @brief Этот метод возвращает количество байт в буфере
+     */
+    int size() const;
+
+    /**
+     * @brief Этот метод возвращает количество пакетов, отброшенных из-за
+     * ошибки контрольной суммы или размера
+     */
+    int rejectedCount() const;
+
+private:
+    enum class Candidate { Valid, Invalid, Incomplete };
+
+    uint8_t at(int offset) const;
+    void consume(int count);
+    bool seekMarker(int from, int &offset) const;
+    Candidate check(int offset, const uint8_t *&frame);
+    bool resync();
+
+    uint8_t m_buffer[kCapacity];        /**< Кольцевой буфер                         */
+    uint8_t m_scratch[kMaxPackageSize]; /**< Пакет, разорванный границей буфера      */
+    int m_head = 0;                     /**< Позиция первого байта                   */
+    int m_count = 0;                    /**< Количество байт в буфере                */
+    int m_rejected = 0;                 /**< Количество отброшенных пакетов          */
+};
+
+template <typename Handler>
+bool FrameDecoder::decode(Handler &&handler)
+{
+    for (;;) {
+        int offset;
+        if (!seekMarker(0, offset)) {
+            consume(m_count);
+            return false;
+        }
+        consume(offset);
+
+        const uint8_t *frame = nullptr;
+        switch (check(0, frame)) {
+        case Candidate::Incomplete:
+            // Маркер может оказаться случайным байтом, если за ним уже лежит
+            // целый корректный пакет - пропускаем мусор, иначе ждем данных
+            if (!resync()) {
+                return false;
+            }
+            continue;
+        case Candidate::Invalid:
+            ++m_rejected;
+            consume(1);
+            continue;
+        case Candidate::Valid:
+            break;
+        }
+
+        const int size = frame[1] - kMinValueOfSizeField;
+        const uint8_t cmd = frame[2];
+        const bool accepted = handler(cmd, static_cast<const void *>(frame + 3), size);
+        consume(size + kMinPackageSize);
+        if (accepted) {
+            return true;
+        }
+    }
+}
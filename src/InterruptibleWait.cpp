@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <limits>
+
+#include <QThread>
+
+#include "InterruptibleWait.h"
+#include "Transport.h"
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#ifdef Q_OS_LINUX
+#include <sys/eventfd.h>
+#endif
+#endif
+
+using namespace std::chrono;
+
+namespace {
+
+/**
+ * @brief Оставшееся время ожидания с учетом срока выполнения токена, мс
+ */
+qint64 remainingTime(const QDeadlineTimer &timer, const CancelToken &cancelled)
+{
+    auto remaining = timer.isForever() ? std::numeric_limits<qint64>::max()
+                                       : std::max<qint64>(timer.remainingTime(), 0);
+    auto deadline = cancelled.deadline();
+    if (deadline != CancelToken::Clock::time_point::max()) {
+        auto left = duration_cast<milliseconds>(deadline - CancelToken::Clock::now()).count();
+        remaining = std::min<qint64>(remaining, std::max<qint64>(left, 0));
+    }
+    return remaining;
+}
+
+#ifdef Q_OS_UNIX
+
+/**
+ * @brief Дескриптор, который можно сделать готовым к чтению из любого потока
+ *
+ * По одному на поток: ожидание в потоке всегда одно.
+ */
+class Waker
+{
+public:
+    Waker()
+    {
+#ifdef Q_OS_LINUX
+        m_read = m_write = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#else
+        int fds[2];
+        if (::pipe(fds) == 0) {
+            for (int fd : fds) {
+                ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+                ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+            }
+            m_read = fds[0];
+            m_write = fds[1];
+        }
+#endif
+    }
+
+    ~Waker()
+    {
+        if (m_write != m_read) {
+            ::close(m_write);
+        }
+        if (m_read != -1) {
+            ::close(m_read);
+        }
+    }
+
+    Waker(const Waker &) = delete;
+    Waker &operator=(const Waker &) = delete;
+
+    bool isValid() const
+    {
+        return m_read != -1;
+    }
+
+    int descriptor() const
+    {
+        return m_read;
+    }
+
+    void wake()
+    {
+        uint64_t value = 1;
+        // Переполнение или полный канал означают, что поток уже разбужен
+        auto written = ::write(m_write, &value, m_write == m_read ? sizeof(value) : 1);
+        Q_UNUSED(written);
+    }
+
+    void drain()
+    {
+        uint64_t buffer[8];
+        while (::read(m_read, buffer, sizeof(buffer)) > 0) {
+        }
+    }
+
+private:
+    int m_read = -1;
+    int m_write = -1;
+};
+
+Waker &threadWaker()
+{
+    static thread_local Waker waker;
+    return waker;
+}
+
+enum class Readiness { None, Readable, Closed };
+
+/**
+ * @brief Ждать готовности fd (-1 - только отмены) не дольше timeout
+ */
+Readiness poll(int fd, qint64 timeout, Waker &waker)
+{
+    pollfd fds[2] = {
+        { waker.descriptor(), POLLIN, 0 },
+        { fd, POLLIN, 0 }
+    };
+    auto count = fd == -1 ? 1 : 2;
+    auto msecs = static_cast<int>(std::min<qint64>(timeout, std::numeric_limits<int>::max()));
+    int result;
+    do {
+        result = ::poll(fds, static_cast<nfds_t>(count), msecs);
+    }
+    while (result < 0 && errno == EINTR);
+    if (result <= 0 || count == 1) {
+        return Readiness::None;
+    }
+    // Отключенный адаптер сообщает POLLIN вместе с POLLHUP: проверка
+    // POLLIN первой зациклила бы ожидание на дескрипторе без данных
+    if (fds[1].revents & (POLLHUP | POLLERR | POLLNVAL)) {
+        return Readiness::Closed;
+    }
+    return fds[1].revents & POLLIN ? Readiness::Readable : Readiness::None;
+}
+
+#endif
+
+} // namespace
+
+bool InterruptibleWait::readyRead(Transport &port, QDeadlineTimer timer, const CancelToken &cancelled)
+{
+    if (port.bytesAvailable() > 0) {
+        return true;
+    }
+#ifdef Q_OS_UNIX
+    auto fd = static_cast<int>(port.descriptor());
+    auto &&waker = threadWaker();
+    if (fd != -1 && waker.isValid()) {
+        waker.drain();
+        auto subscription = cancelled.subscribe([&waker] {
+            waker.wake();
+        });
+        for (;;) {
+            auto remaining = remainingTime(timer, cancelled);
+            if (cancelled || remaining == 0) {
+                return false;
+            }
+            switch (poll(fd, remaining, waker)) {
+            case Readiness::Readable:
+                // Данные забирает сам порт: он ведет собственный буфер.
+                // Готовый к чтению дескриптор без данных - конец потока,
+                // повторный poll() вернул бы его сразу же
+                return port.waitForReadyRead(0) || port.bytesAvailable() > 0;
+            case Readiness::Closed:
+                return false;
+            case Readiness::None:
+                break;
+            }
+        }
+    }
+#endif
+    for (;;) {
+        auto remaining = remainingTime(timer, cancelled);
+        if (cancelled || remaining == 0) {
+            return false;
+        }
+        auto slice = std::min<qint64>(remaining, kSlice.count());
+        if (port.waitForReadyRead(static_cast<int>(slice))) {
+            return true;
+        }
+    }
+}
+
+bool InterruptibleWait::sleep(milliseconds duration, const CancelToken &cancelled)
+{
+    QDeadlineTimer timer(duration);
+#ifdef Q_OS_UNIX
+    auto &&waker = threadWaker();
+    if (waker.isValid()) {
+        waker.drain();
+        auto subscription = cancelled.subscribe([&waker] {
+            waker.wake();
+        });
+        while (!cancelled && !timer.hasExpired()) {
+            poll(-1, remainingTime(timer, cancelled), waker);
+        }
+        return !cancelled;
+    }
+#endif
+    while (!cancelled && !timer.hasExpired()) {
+        auto slice = std::min<qint64>(remainingTime(timer, cancelled), kSlice.count());
+        QThread::msleep(static_cast<unsigned long>(slice));
+    }
+    return !cancelled;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+
+#include <QDeadlineTimer>
+
+#include "Cancelation.h"
+
+class Transport;
+
+/**
+ * @brief Ожидание, прерываемое отменой
+ *
+ * На Unix поток ждет в poll() одновременно дескриптор порта и eventfd
+ * (self-pipe там, где eventfd нет), в который пишет подписка на отмену
+ * токена, поэтому CancellationSource::cancel() будит поток сразу, а не по
+ * истечении таймаута. Срок выполнения токена ограничивает время ожидания.
+ * Для транспортов без дескриптора и на других платформах ожидание ведется
+ * отрезками по kSlice с проверкой отмены.
+ */
+class InterruptibleWait
+{
+public:
+    static constexpr std::chrono::milliseconds kSlice { 50 };
+
+    /**
+     * @brief Ждать поступления данных в порт
+     * @return ложь, если истек таймер или токен отменен
+     */
+    static bool readyRead(Transport &port, QDeadlineTimer timer, const CancelToken &cancelled);
+    /**
+     * @brief Ждать заданное время
+     * @return ложь, если ожидание прервано отменой
+     */
+    static bool sleep(std::chrono::milliseconds duration, const CancelToken &cancelled);
+};
@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <cmath>
+
+#include "LatencyHistogram.h"
+
+using namespace std::chrono;
+
+void LatencyHistogram::record(microseconds value)
+{
+    auto v = static_cast<uint64_t>(std::max<microseconds::rep>(value.count(), 0));
+    m_buckets[bucketIndex(v)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(v, std::memory_order_relaxed);
+    auto max = m_max.load(std::memory_order_relaxed);
+    while (v > max && !m_max.compare_exchange_weak(max, v, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t LatencyHistogram::count() const
+{
+    return m_count.load(std::memory_order_relaxed);
+}
+
+microseconds LatencyHistogram::mean() const
+{
+    auto n = count();
+    if (n == 0) {
+        return microseconds::zero();
+    }
+    return microseconds(static_cast<microseconds::rep>(m_sum.load(std::memory_order_relaxed) / n));
+}
+
+microseconds LatencyHistogram::max() const
+{
+    return microseconds(static_cast<microseconds::rep>(m_max.load(std::memory_order_relaxed)));
+}
+
+microseconds LatencyHistogram::percentile(double quantile) const
+{
+    // Счетчики корзин читаются не одновременно, поэтому порог считается
+    // по сумме корзин, а не по m_count
+    uint64_t total = 0;
+    for (auto &&bucket : m_buckets) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    if (total == 0) {
+        return microseconds::zero();
+    }
+    auto target = static_cast<uint64_t>(std::ceil(std::min(std::max(quantile, 0.0), 1.0) * total));
+    target = std::max<uint64_t>(target, 1);
+    uint64_t seen = 0;
+    for (int i = 0; i < kBucketCount; ++i) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            auto bound = std::min(bucketUpperBound(i), m_max.load(std::memory_order_relaxed));
+            return microseconds(static_cast<microseconds::rep>(bound));
+        }
+    }
+    return max();
+}
+
+int LatencyHistogram::bucketIndex(uint64_t value)
+{
+    if (value < 2 * kSubBucketCount) {
+        return static_cast<int>(value);
+    }
+    int msb = 0;
+    for (auto v = value; v > 1; v >>= 1) {
+        ++msb;
+    }
+    if (msb >= kMaxValueBits) {
+        return kBucketCount - 1;
+    }
+    // Старшие kSubBucketBits + 1 бит значения определяют корзину внутри октавы
+    int shift = msb - kSubBucketBits;
+    return shift * kSubBucketCount + static_cast<int>(value >> shift);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int index)
+{
+    if (index < 2 * kSubBucketCount) {
+        return static_cast<uint64_t>(index);
+    }
+    int shift = index / kSubBucketCount - 1;
+    uint64_t subBucket = static_cast<uint64_t>(index % kSubBucketCount + kSubBucketCount);
+    return ((subBucket + 1) << shift) - 1;
+}
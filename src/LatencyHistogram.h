@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief Гистограмма времени ответа
+ *
+ * Корзины устроены как в HdrHistogram: значения до 32 мкс хранятся точно,
+ * дальше на каждую октаву приходится 16 корзин, т.е. погрешность не больше
+ * 6.25%. Диапазон - до 2^27 мкс (134 с), большие значения попадают в
+ * последнюю корзину. Запись - несколько атомарных инкрементов без
+ * блокировок, поэтому читать гистограмму можно из любого потока во время
+ * записи.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr int kSubBucketBits  = 4;
+    static constexpr int kSubBucketCount = 1 << kSubBucketBits;
+    static constexpr int kMaxValueBits   = 27;
+    static constexpr int kBucketCount    = (kMaxValueBits - kSubBucketBits + 1) * kSubBucketCount;
+
+    /**
+     * @brief Этот метод учитывает одно значение.
+     */
+    void record(std::chrono::microseconds value);
+    /**
+     * @brief Этот метод возвращает количество учтенных значений.
+     */
+    uint64_t count() const;
+    std::chrono::microseconds mean() const;
+    std::chrono::microseconds max() const;
+    /**
+     * @brief Этот метод возвращает значение, которое не превышает заданная
+     * доля измерений.
+     * @param[in] quantile - доля от 0 до 1
+     */
+    std::chrono::microseconds percentile(double quantile) const;
+
+private:
+    static int bucketIndex(uint64_t value);
+    static uint64_t bucketUpperBound(int index);
+
+    std::atomic<uint64_t> m_buckets[kBucketCount] {};
+    std::atomic<uint64_t> m_count { 0 };
+    std::atomic<uint64_t> m_sum { 0 };
+    std::atomic<uint64_t> m_max { 0 };
+};
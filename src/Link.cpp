@@ -0,0 +1,54 @@
+#include "Link.h"
+#include "SerialTransport.h"
+
+using namespace std::chrono_literals;
+
+Link::Link()
+    : m_transport(std::make_unique<SerialTransport>(QString()))
+    , m_statistics(LinkStatistics::forAddress(m_transport->address()))
+    , m_cancelToken(CancellationSource().token())
+    , m_rtt {{
+        RttEstimator(1000ms, 20ms, 2000ms), // Query
+        RttEstimator(1000ms, 20ms, 2000ms), // Control
+        RttEstimator(2000ms, 50ms, 4000ms)  // Eeprom
+    }}
+{}
+
+Transport &Link::transport()
+{
+    return *m_transport;
+}
+
+void Link::setTransport(std::unique_ptr<Transport> transport)
+{
+    Q_ASSERT(transport);
+    m_transport = std::move(transport);
+    m_statistics = LinkStatistics::forAddress(m_transport->address());
+}
+
+RttEstimator &Link::rtt(Protocol::CommandClass commandClass)
+{
+    return m_rtt[static_cast<size_t>(commandClass)];
+}
+
+LinkStatistics &Link::statistics()
+{
+    return *m_statistics;
+}
+
+CancelToken Link::cancelToken() const
+{
+    return m_cancelToken;
+}
+
+void Link::setCancelToken(CancelToken token)
+{
+    m_cancelToken = std::move(token);
+}
+
+void Link::reset()
+{
+    for (auto &&rtt : m_rtt) {
+        rtt.reset();
+    }
+}
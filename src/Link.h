@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <memory>
+
+#include "Cancelation.h"
+#include "LinkStatistics.h"
+#include "Protocol.h"
+#include "RttEstimator.h"
+#include "Transport.h"
+
+/**
+ * @brief Канал связи с устройством
+ *
+ * Владеет транспортом и статистикой обмена, которая должна переживать
+ * отдельные транзакции: оценками времени ответа для каждого класса команд и
+ * счетчиками LinkStatistics.
+ */
+class Link
+{
+public:
+    Link();
+
+    Transport &transport();
+    /**
+     * @brief Заменить транспорт
+     *
+     * Вызывается только когда с транспортом не связан ни один AsyncProtocol.
+     */
+    void setTransport(std::unique_ptr<Transport> transport);
+    RttEstimator &rtt(Protocol::CommandClass commandClass);
+    LinkStatistics &statistics();
+    /**
+     * @brief Токен отмены выполняемой транзакции
+     *
+     * Проверяется блокирующим протоколом во время ожидания ответа.
+     */
+    CancelToken cancelToken() const;
+    void setCancelToken(CancelToken token);
+    /**
+     * @brief Сброс накопленной статистики, вызывается при смене устройства
+     */
+    void reset();
+
+private:
+    static constexpr int kCommandClassCount =
+            static_cast<int>(Protocol::CommandClass::Count);
+
+    std::unique_ptr<Transport> m_transport;
+    std::shared_ptr<LinkStatistics> m_statistics;
+    CancelToken m_cancelToken;
+    std::array<RttEstimator, kCommandClassCount> m_rtt;
+};
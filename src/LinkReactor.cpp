@@ -0,0 +1,34 @@
+#include <QThread>
+
+#include "LinkReactor.h"
+
+LinkReactor::LinkReactor()
+    : m_thread(new QThread)
+    , m_context(new QObject)
+{
+    m_thread->setObjectName("LinkReactor");
+    m_context->moveToThread(m_thread);
+    m_thread->start();
+}
+
+LinkReactor::~LinkReactor()
+{
+    m_thread->quit();
+    m_thread->wait();
+    delete m_context;
+    delete m_thread;
+}
+
+QThread *LinkReactor::thread() const
+{
+    return m_thread;
+}
+
+void LinkReactor::run(const std::function<void()> &function)
+{
+    if (QThread::currentThread() == m_thread) {
+        function();
+        return;
+    }
+    QMetaObject::invokeMethod(m_context, function, Qt::BlockingQueuedConnection);
+}
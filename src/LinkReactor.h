@@ -0,0 +1,33 @@
+#pragma once
+
+#include <functional>
+
+class QObject;
+class QThread;
+
+/**
+ * @brief Поток, обслуживающий каналы связи со всеми устройствами
+ *
+ * Порты открываются и обслуживаются в одном цикле событий: QSerialPort
+ * следит за дескрипторами через QSocketNotifier, поэтому ожидание ответа
+ * от любого количества устройств не занимает отдельных потоков.
+ */
+class LinkReactor
+{
+public:
+    LinkReactor();
+    ~LinkReactor();
+
+    /**
+     * @brief Этот метод возвращает поток цикла событий.
+     */
+    QThread *thread() const;
+    /**
+     * @brief Выполнить функцию в потоке цикла событий и дождаться завершения
+     */
+    void run(const std::function<void()> &function);
+
+private:
+    QThread *m_thread;
+    QObject *m_context;
+};
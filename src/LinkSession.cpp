@@ -0,0 +1,216 @@
+#include <algorithm>
+
+#include <QThread>
+#include <QTimer>
+
+#include "AsyncProtocol.h"
+#include "LinkSession.h"
+#include "Transactions.h"
+
+using namespace std::chrono;
+
+LinkSession::LinkSession(CancelToken cancelled)
+    : m_currentCancellation(cancelled)
+    , m_deadline(new QTimer(this))
+    , m_cancelled(cancelled)
+{
+    m_clock.start();
+    m_deadline->setSingleShot(true);
+    connect(m_deadline, &QTimer::timeout, this, [this] {
+        cancelCurrent();
+        startNext();
+    });
+}
+
+LinkSession::~LinkSession()
+{
+    if (m_worker) {
+        // Блокирующая транзакция проверяет признак отмены сама
+        m_worker->wait();
+        delete m_worker;
+    }
+    clear();
+}
+
+void LinkSession::enqueue(Interfaces::Transaction *transaction)
+{
+    using Priority = Interfaces::Transaction::Priority;
+
+    // Вытесненные транзакции удаляются, а новая встает в конец очереди:
+    // заняв место вытесненной, она обогнала бы поставленные после нее
+    // команды (например, сохранение в EEPROM записало бы старое значение).
+    // Время ожидания наследуется от самой ранней из вытесненных.
+    auto enqueuedAt = m_clock.elapsed();
+    for (auto it = m_queue.begin(); it != m_queue.end();) {
+        if (!transaction->supersedes(*it->transaction)) {
+            ++it;
+            continue;
+        }
+        enqueuedAt = std::min(enqueuedAt, it->enqueuedAt);
+        drop(it->transaction);
+        it = m_queue.erase(it);
+    }
+    m_queue.push_back(Entry { transaction, enqueuedAt });
+    // Результат опроса все равно устареет после команды оператора
+    if (m_current && !m_worker
+            && m_current->priority() == Priority::Poll
+            && transaction->priority() == Priority::Interactive) {
+        cancelCurrent();
+    }
+    startNext();
+}
+
+void LinkSession::cancel(Interfaces::Transaction *transaction)
+{
+    if (m_current.get() == transaction) {
+        cancelCurrent();
+        startNext();
+        return;
+    }
+    auto it = std::find_if(m_queue.begin(), m_queue.end(), [transaction](const Entry &entry) {
+        return entry.transaction == transaction;
+    });
+    if (it != m_queue.end()) {
+        drop(it->transaction);
+        m_queue.erase(it);
+    }
+}
+
+void LinkSession::clear()
+{
+    for (auto &&entry : m_queue) {
+        delete entry.transaction;
+    }
+    m_queue.clear();
+}
+
+void LinkSession::startNext()
+{
+    if (m_current || m_cancelled) {
+        return;
+    }
+    dropExpired();
+    if (m_queue.empty()) {
+        return;
+    }
+    // Очередь устройства короткая, поэтому достаточно линейного поиска;
+    // при равном приоритете выбирается транзакция, поставленная раньше
+    const auto now = m_clock.elapsed();
+    auto next = m_queue.begin();
+    for (auto it = m_queue.begin(); it != m_queue.end(); ++it) {
+        if (effectivePriority(*it, now) > effectivePriority(*next, now)) {
+            next = it;
+        }
+    }
+    m_current.reset(next->transaction);
+    m_queue.erase(next);
+
+    auto transaction = m_current.get();
+    auto deadline = transaction->deadline();
+    m_currentCancellation = CancellationSource(m_cancelled, deadline);
+    auto token = m_currentCancellation.token();
+    m_link.setCancelToken(token);
+    if (deadline != CancelToken::Clock::time_point::max()) {
+        auto remaining = duration_cast<milliseconds>(deadline - CancelToken::Clock::now());
+        m_deadline->start(static_cast<int>(std::max(remaining, milliseconds::zero()).count()));
+    }
+
+    if (!m_proto) {
+        m_proto = std::make_unique<AsyncProtocol>(m_link);
+    }
+    // Транзакция излучает finished() изнутри обработчика протокола, поэтому
+    // удалять ее можно только после возврата в цикл событий. Прерванная
+    // транзакция к этому времени уже может быть удалена.
+    connect(transaction, &Interfaces::Transaction::finished, this, [this, transaction] {
+        if (m_current.get() == transaction) {
+            onFinished();
+        }
+    }, Qt::QueuedConnection);
+    if (!transaction->start(*m_proto, token)) {
+        disconnect(transaction, nullptr, this, nullptr);
+        runBlocking(transaction);
+    }
+}
+
+int LinkSession::effectivePriority(const Entry &entry, qint64 now) const
+{
+    using Priority = Interfaces::Transaction::Priority;
+
+    auto base = static_cast<int>(entry.transaction->priority());
+    auto aged = base + static_cast<int>((now - entry.enqueuedAt) / kAgingInterval.count());
+    return std::max(base, std::min(aged, static_cast<int>(Priority::Firmware)));
+}
+
+void LinkSession::runBlocking(Interfaces::Transaction *transaction)
+{
+    // Обработчики AsyncProtocol не должны срабатывать на сигналы порта из
+    // чужого потока
+    m_proto.reset();
+
+    auto reactor = thread();
+    auto token = m_currentCancellation.token();
+    m_worker = QThread::create([this, transaction, reactor, token] {
+        try {
+            transaction->exec(m_link, token);
+        }
+        catch (CancelledException &) {
+        }
+        catch (...) {
+            std::terminate();
+        }
+        m_link.transport().moveToThread(reactor);
+    });
+    m_link.transport().moveToThread(m_worker);
+    connect(m_worker, &QThread::finished, this, [this] {
+        m_worker->deleteLater();
+        m_worker = nullptr;
+        m_deadline->stop();
+        m_current.reset();
+        startNext();
+    });
+    m_worker->start();
+}
+
+void LinkSession::onFinished()
+{
+    m_deadline->stop();
+    m_proto->abort();
+    m_current.reset();
+    startNext();
+}
+
+void LinkSession::cancelCurrent()
+{
+    if (!m_current) {
+        return;
+    }
+    m_currentCancellation.cancel();
+    if (m_worker) {
+        // Блокирующая транзакция увидит отмену в ожидании ответа
+        return;
+    }
+    m_deadline->stop();
+    m_proto->abort();
+    disconnect(m_current.get(), nullptr, this, nullptr);
+    drop(m_current.release());
+}
+
+void LinkSession::dropExpired()
+{
+    const auto now = CancelToken::Clock::now();
+    for (auto it = m_queue.begin(); it != m_queue.end();) {
+        if (it->transaction->deadline() <= now) {
+            drop(it->transaction);
+            it = m_queue.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+void LinkSession::drop(Interfaces::Transaction *transaction)
+{
+    emit transaction->abandoned();
+    delete transaction;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <memory>
+
+#include <QElapsedTimer>
+#include <QObject>
+
+#include "Cancelation.h"
+#include "Link.h"
+
+class AsyncProtocol;
+class QThread;
+class QTimer;
+
+namespace Interfaces {
+class Transaction;
+} // namespace Interfaces
+
+/**
+ * @brief Очередь транзакций одного устройства в потоке LinkReactor
+ *
+ * Транзакции, поддерживающие неблокирующий протокол, выполняются прямо в
+ * цикле событий. Блокирующие (поиск, обновление прошивки) выполняются в
+ * отдельном потоке, на время которого туда переносится транспорт.
+ *
+ * Очередь упорядочена по Transaction::priority(); каждые kAgingInterval
+ * ожидания повышают приоритет транзакции на один класс (не выше Firmware),
+ * так что фоновый опрос не голодает за потоком команд оператора. Среди
+ * транзакций одного приоритета порядок сохраняется.
+ *
+ * Новая транзакция удаляет ожидающие, которые она вытесняет
+ * (Transaction::supersedes), и встает в конец очереди: при перетаскивании
+ * регулятора на устройство уходит только последнее значение, а порядок
+ * относительно других команд оператора не нарушается.
+ *
+ * Каждая транзакция получает собственный токен отмены, связанный с токеном
+ * сессии и сроком Transaction::deadline(). Команда оператора прерывает
+ * выполняемый фоновый опрос, не дожидаясь его ответа.
+ */
+class LinkSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    LinkSession(CancelToken cancelled);
+    ~LinkSession() override;
+
+    void enqueue(Interfaces::Transaction *transaction);
+    /**
+     * @brief Отменить транзакцию, ожидающую в очереди или выполняемую
+     */
+    void cancel(Interfaces::Transaction *transaction);
+    void clear();
+
+private:
+    static constexpr std::chrono::milliseconds kAgingInterval { 2000 };
+
+    struct Entry
+    {
+        Interfaces::Transaction *transaction;
+        qint64 enqueuedAt; /**< Время постановки в очередь по m_clock, мс */
+    };
+
+    int effectivePriority(const Entry &entry, qint64 now) const;
+    void startNext();
+    void runBlocking(Interfaces::Transaction *transaction);
+    void onFinished();
+    void cancelCurrent();
+    void dropExpired();
+    static void drop(Interfaces::Transaction *transaction);
+
+    Link m_link;
+    std::unique_ptr<AsyncProtocol> m_proto;
+    std::deque<Entry> m_queue;
+    QElapsedTimer m_clock;
+    std::unique_ptr<Interfaces::Transaction> m_current;
+    CancellationSource m_currentCancellation;
+    QTimer *m_deadline;
+    QThread *m_worker = nullptr;
+    CancelToken m_cancelled;
+};
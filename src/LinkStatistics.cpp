@@ -0,0 +1,228 @@
+#include <map>
+#include <mutex>
+
+#include <QFile>
+#include <QTextStream>
+
+#include "LinkStatistics.h"
+
+using namespace std::chrono;
+
+namespace {
+
+const char *commandName(int cmd)
+{
+    static const char *const names[LinkStatistics::kCommandCount] = {
+        "Ok",
+        "ReadConfig",
+        "WriteConfig",
+        "ReadSignalLevels",
+        "ReadInfo",
+        "Error",
+        "WriteTempModuleConfig",
+        "WriteTempControlModule",
+        "ReadErrors",
+        "WriteTemplateConfig",
+        "ReadTemplateConfig",
+        "ReadThresholdLevels",
+        "WriteThresholdLevels",
+        "Reboot",
+        "ResetErrors",
+        "ReadModuleStates"
+    };
+    return names[cmd];
+}
+
+QString toMilliseconds(microseconds value)
+{
+    return QString::number(value.count() / 1000.0, 'f', 1);
+}
+
+struct Registry
+{
+    std::mutex mutex;
+    std::map<QString, std::shared_ptr<LinkStatistics>> items;
+};
+
+Registry &registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+} // namespace
+
+std::shared_ptr<LinkStatistics> LinkStatistics::forAddress(const QString &address)
+{
+    auto &&r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    auto &&statistics = r.items[address];
+    if (!statistics) {
+        statistics.reset(new LinkStatistics(address));
+    }
+    return statistics;
+}
+
+LinkStatistics::LinkStatistics(const QString &name)
+    : m_name(name)
+{}
+
+QString LinkStatistics::reportAll()
+{
+    auto &&r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    QString report;
+    for (auto &&item : r.items) {
+        if (item.second->isUsed()) {
+            report += item.second->report();
+        }
+    }
+    return report;
+}
+
+bool LinkStatistics::dumpAll(const QString &fileName)
+{
+    auto report = reportAll();
+    if (report.isEmpty()) {
+        return true;
+    }
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        qWarning("LinkStatistics::dumpAll(): %s", qPrintable(file.errorString()));
+        return false;
+    }
+    QTextStream stream(&file);
+    stream << report;
+    return true;
+}
+
+QString LinkStatistics::name() const
+{
+    return m_name;
+}
+
+void LinkStatistics::addRequest(Protocol::Command cmd)
+{
+    at(cmd).requests.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LinkStatistics::addRetry(Protocol::Command cmd)
+{
+    at(cmd).retries.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LinkStatistics::addTimeout(Protocol::Command cmd)
+{
+    at(cmd).timeouts.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LinkStatistics::addFailure(Protocol::Command cmd)
+{
+    at(cmd).failures.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LinkStatistics::addLatency(Protocol::Command cmd, microseconds latency)
+{
+    at(cmd).latency.record(latency);
+}
+
+void LinkStatistics::addCrcErrors(int count)
+{
+    if (count > 0) {
+        m_crcErrors.fetch_add(static_cast<uint64_t>(count), std::memory_order_relaxed);
+    }
+}
+
+void LinkStatistics::addBytesIn(qint64 count)
+{
+    if (count > 0) {
+        m_bytesIn.fetch_add(static_cast<uint64_t>(count), std::memory_order_relaxed);
+    }
+}
+
+void LinkStatistics::addBytesOut(qint64 count)
+{
+    if (count > 0) {
+        m_bytesOut.fetch_add(static_cast<uint64_t>(count), std::memory_order_relaxed);
+    }
+}
+
+LinkStatistics::Counters LinkStatistics::counters(Protocol::Command cmd) const
+{
+    auto &&command = at(cmd);
+    return Counters {
+        command.requests.load(std::memory_order_relaxed),
+        command.retries.load(std::memory_order_relaxed),
+        command.timeouts.load(std::memory_order_relaxed),
+        command.failures.load(std::memory_order_relaxed)
+    };
+}
+
+const LatencyHistogram &LinkStatistics::latency(Protocol::Command cmd) const
+{
+    return at(cmd).latency;
+}
+
+uint64_t LinkStatistics::crcErrors() const
+{
+    return m_crcErrors.load(std::memory_order_relaxed);
+}
+
+uint64_t LinkStatistics::bytesIn() const
+{
+    return m_bytesIn.load(std::memory_order_relaxed);
+}
+
+uint64_t LinkStatistics::bytesOut() const
+{
+    return m_bytesOut.load(std::memory_order_relaxed);
+}
+
+bool LinkStatistics::isUsed() const
+{
+    return bytesOut() > 0;
+}
+
+QString LinkStatistics::report() const
+{
+    QString report;
+    QTextStream stream(&report);
+    stream << name() << "\n";
+    stream << QString("  %1 %2 %3 %4 %5 %6 %7 %8 %9\n")
+              .arg("command", -24).arg("requests", 9).arg("retries", 8)
+              .arg("timeouts", 9).arg("failures", 9).arg("p50,ms", 8)
+              .arg("p90,ms", 8).arg("p99,ms", 8).arg("max,ms", 8);
+    for (int i = 0; i < kCommandCount; ++i) {
+        auto cmd = static_cast<Protocol::Command>(i);
+        auto c = counters(cmd);
+        if (c.requests == 0) {
+            continue;
+        }
+        auto &&histogram = latency(cmd);
+        stream << QString("  %1 %2 %3 %4 %5 %6 %7 %8 %9\n")
+                  .arg(commandName(i), -24)
+                  .arg(c.requests, 9).arg(c.retries, 8)
+                  .arg(c.timeouts, 9).arg(c.failures, 9)
+                  .arg(toMilliseconds(histogram.percentile(0.5)), 8)
+                  .arg(toMilliseconds(histogram.percentile(0.9)), 8)
+                  .arg(toMilliseconds(histogram.percentile(0.99)), 8)
+                  .arg(toMilliseconds(histogram.max()), 8);
+    }
+    stream << QString("  crc errors: %1, bytes in: %2, bytes out: %3\n")
+              .arg(crcErrors()).arg(bytesIn()).arg(bytesOut());
+    return report;
+}
+
+LinkStatistics::CommandStatistics &LinkStatistics::at(Protocol::Command cmd)
+{
+    auto index = static_cast<int>(cmd);
+    Q_ASSERT(index >= 0 && index < kCommandCount);
+    return m_commands[index];
+}
+
+const LinkStatistics::CommandStatistics &LinkStatistics::at(Protocol::Command cmd) const
+{
+    auto index = static_cast<int>(cmd);
+    Q_ASSERT(index >= 0 && index < kCommandCount);
+    return m_commands[index];
+}
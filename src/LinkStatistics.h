@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+#include <QString>
+
+#include "LatencyHistogram.h"
+#include "Protocol.h"
+
+/**
+ * @brief Статистика обмена по одному каналу связи
+ *
+ * Для каждой команды ведется гистограмма времени диалога (от первой
+ * передачи запроса до получения ответа, с учетом повторов) и счетчики
+ * запросов, повторов, таймаутов и отказов, для канала - количество пакетов
+ * с ошибкой контрольной суммы и переданных байт. Все счетчики атомарные и
+ * читаются из любого потока.
+ *
+ * Статистика регистрируется по адресу транспорта и переживает канал: при
+ * переподключении устройства к тому же порту счетчики продолжаются, а при
+ * завершении программы можно выгрузить данные по всем портам сразу.
+ */
+class LinkStatistics
+{
+public:
+    static constexpr int kCommandCount = static_cast<int>(Protocol::Command::ReadModuleStates) + 1;
+
+    /**
+     * @brief Счетчики одной команды
+     */
+    struct Counters
+    {
+        uint64_t requests; /**< Диалогов               */
+        uint64_t retries;  /**< Повторных передач      */
+        uint64_t timeouts; /**< Истекших ожиданий      */
+        uint64_t failures; /**< Диалогов без ответа    */
+    };
+
+    /**
+     * @brief Этот метод возвращает статистику транспорта с заданным адресом.
+     */
+    static std::shared_ptr<LinkStatistics> forAddress(const QString &address);
+    /**
+     * @brief Отчет по всем каналам, по которым был обмен
+     */
+    static QString reportAll();
+    /**
+     * @brief Записать отчет по всем каналам в файл
+     */
+    static bool dumpAll(const QString &fileName);
+
+    QString name() const;
+
+    void addRequest(Protocol::Command cmd);
+    void addRetry(Protocol::Command cmd);
+    void addTimeout(Protocol::Command cmd);
+    void addFailure(Protocol::Command cmd);
+    void addLatency(Protocol::Command cmd, std::chrono::microseconds latency);
+    void addCrcErrors(int count);
+    void addBytesIn(qint64 count);
+    void addBytesOut(qint64 count);
+
+    Counters counters(Protocol::Command cmd) const;
+    const LatencyHistogram &latency(Protocol::Command cmd) const;
+    uint64_t crcErrors() const;
+    uint64_t bytesIn() const;
+    uint64_t bytesOut() const;
+    /**
+     * @brief Этот метод возвращает истину, если по каналу был обмен.
+     */
+    bool isUsed() const;
+
+    QString report() const;
+
+private:
+    struct CommandStatistics
+    {
+        LatencyHistogram latency;
+        std::atomic<uint64_t> requests { 0 };
+        std::atomic<uint64_t> retries { 0 };
+        std::atomic<uint64_t> timeouts { 0 };
+        std::atomic<uint64_t> failures { 0 };
+    };
+
+    LinkStatistics(const QString &name);
+    CommandStatistics &at(Protocol::Command cmd);
+    const CommandStatistics &at(Protocol::Command cmd) const;
+
+    const QString m_name;
+    CommandStatistics m_commands[kCommandCount];
+    std::atomic<uint64_t> m_crcErrors { 0 };
+    std::atomic<uint64_t> m_bytesIn { 0 };
+    std::atomic<uint64_t> m_bytesOut { 0 };
+};
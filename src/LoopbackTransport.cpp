@@ -0,0 +1,122 @@
+#include <condition_variable>
+#include <mutex>
+
+#include "LoopbackTransport.h"
+
+struct LoopbackTransport::Pipe
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    QString name;
+    QByteArray buffers[2];            /**< Данные, ожидающие чтения каждым концом */
+    LoopbackTransport *ends[2] {};
+    bool notifyPending[2] {};         /**< readyRead уже поставлен в очередь */
+    qint32 baudRates[2] {};
+};
+
+LoopbackTransport::Pair LoopbackTransport::createPair(const QString &name)
+{
+    auto pipe = std::make_shared<Pipe>();
+    pipe->name = name;
+    Pair pair(std::unique_ptr<LoopbackTransport>(new LoopbackTransport(pipe, 0)),
+              std::unique_ptr<LoopbackTransport>(new LoopbackTransport(pipe, 1)));
+    pipe->ends[0] = pair.first.get();
+    pipe->ends[1] = pair.second.get();
+    return pair;
+}
+
+LoopbackTransport::LoopbackTransport(std::shared_ptr<Pipe> pipe, int side)
+    : m_pipe(std::move(pipe))
+    , m_side(side)
+{}
+
+LoopbackTransport::~LoopbackTransport()
+{
+    std::lock_guard<std::mutex> lock(m_pipe->mutex);
+    m_pipe->ends[m_side] = nullptr;
+}
+
+QString LoopbackTransport::address() const
+{
+    return "loop:" + m_pipe->name;
+}
+
+bool LoopbackTransport::configure(qint32 baudRate)
+{
+    std::lock_guard<std::mutex> lock(m_pipe->mutex);
+    m_pipe->baudRates[m_side] = baudRate;
+    return true;
+}
+
+void LoopbackTransport::clear()
+{
+    std::lock_guard<std::mutex> lock(m_pipe->mutex);
+    m_pipe->buffers[m_side].clear();
+}
+
+qint32 LoopbackTransport::baudRate() const
+{
+    std::lock_guard<std::mutex> lock(m_pipe->mutex);
+    return m_pipe->baudRates[m_side];
+}
+
+qint64 LoopbackTransport::bytesAvailable() const
+{
+    std::lock_guard<std::mutex> lock(m_pipe->mutex);
+    return m_pipe->buffers[m_side].size() + Transport::bytesAvailable();
+}
+
+bool LoopbackTransport::waitForReadyRead(int msecs)
+{
+    std::unique_lock<std::mutex> lock(m_pipe->mutex);
+    auto &&buffer = m_pipe->buffers[m_side];
+    return m_pipe->cv.wait_for(lock, std::chrono::milliseconds(msecs), [&buffer] {
+        return !buffer.isEmpty();
+    });
+}
+
+bool LoopbackTransport::waitForBytesWritten(int)
+{
+    // Запись в память завершается сразу
+    return true;
+}
+
+qint64 LoopbackTransport::readData(char *data, qint64 maxSize)
+{
+    std::lock_guard<std::mutex> lock(m_pipe->mutex);
+    auto &&buffer = m_pipe->buffers[m_side];
+    int size = static_cast<int>(std::min<qint64>(maxSize, buffer.size()));
+    memcpy(data, buffer.constData(), static_cast<size_t>(size));
+    buffer.remove(0, size);
+    return size;
+}
+
+qint64 LoopbackTransport::writeData(const char *data, qint64 maxSize)
+{
+    int peer = 1 - m_side;
+    {
+        std::lock_guard<std::mutex> lock(m_pipe->mutex);
+        auto other = m_pipe->ends[peer];
+        if (!other) {
+            return -1;
+        }
+        m_pipe->buffers[peer].append(data, static_cast<int>(maxSize));
+        // Пока уведомление не обработано, новые не ставятся в очередь
+        if (!m_pipe->notifyPending[peer]) {
+            m_pipe->notifyPending[peer] = true;
+            auto pipe = m_pipe;
+            QMetaObject::invokeMethod(other, [other, pipe, peer] {
+                {
+                    std::lock_guard<std::mutex> lock(pipe->mutex);
+                    pipe->notifyPending[peer] = false;
+                }
+                emit other->readyRead();
+            }, Qt::QueuedConnection);
+        }
+    }
+    m_pipe->cv.notify_all();
+    QMetaObject::invokeMethod(this, [this, maxSize] {
+        emit bytesWritten(maxSize);
+    }, Qt::QueuedConnection);
+    return maxSize;
+}
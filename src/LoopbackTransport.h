@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+
+#include "Transport.h"
+
+/**
+ * @brief Соединение в памяти
+ *
+ * Пара транспортов, байты, записанные в один, читаются из другого. Концы
+ * могут принадлежать разным потокам. Связывает протокол с имитатором
+ * устройства в тестах без оборудования (tests/asyncprotocol).
+ */
+class LoopbackTransport : public Transport
+{
+    Q_OBJECT
+
+public:
+    typedef std::pair<std::unique_ptr<LoopbackTransport>,
+                      std::unique_ptr<LoopbackTransport>> Pair;
+
+    /**
+     * @brief Создать пару соединенных транспортов
+     */
+    static Pair createPair(const QString &name);
+
+    ~LoopbackTransport() override;
+
+    QString address() const override;
+    bool configure(qint32 baudRate) override;
+    void clear() override;
+    /**
+     * @brief Этот метод возвращает скорость, установленную методом configure.
+     */
+    qint32 baudRate() const;
+
+    qint64 bytesAvailable() const override;
+    bool waitForReadyRead(int msecs) override;
+    bool waitForBytesWritten(int msecs) override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    struct Pipe;
+
+    LoopbackTransport(std::shared_ptr<Pipe> pipe, int side);
+
+    std::shared_ptr<Pipe> m_pipe;
+    int m_side;
+};
@@ -1,22 +1,30 @@
 #include <QFile>
+#include <QMessageBox>
 #include <QSettings>
+#include <QVBoxLayout>
 #include <QWindowStateChangeEvent>
 #include <QDesktopWidget>
 
 #include "Device.h"
+#include "DeviceCache.h"
+#include "DeviceController.h"
+#include "DeviceSupervisor.h"
+#include "LinkReactor.h"
 #include "Modules.h"
 #include "MainWindow.h"
 #include "MiniView.h"
 #include "SettingsSerializers.h"
 #include "ModuleViews.h"
 #include "NameRepository.h"
+#include "PollScheduler.h"
 #include "SettingsView.h"
 #include "Transactions.h"
-#include "TransactionInvoker.h"
 #include "ui_MainWindow.h"
 
 MainWindow::MainWindow()
     : ui(std::make_unique<Ui::MainWindow>())
+    , m_reactor(std::make_shared<LinkReactor>())
+    , m_cache(std::make_shared<DeviceCache>("devices.cache.ini"))
 {
     ui->setupUi(this);
     ui->tabs->hide();
@@ -25,8 +33,12 @@ MainWindow::MainWindow()
     onCurrentTabChanged(-1);
     connect(ui->tabs, &QTabWidget::currentChanged, this, &MainWindow::onCurrentTabChanged);
     readSettings();
+    m_supervisor = std::make_unique<DeviceSupervisor>(m_reactor, m_transports, m_cache);
+    m_supervisor->setFootprintLog("footprint.log");
     createBuilders();
-    searchDevice();
+    connect(m_supervisor.get(), &DeviceSupervisor::added, this, &MainWindow::addDevice);
+    connect(m_supervisor.get(), &DeviceSupervisor::removed, this, &MainWindow::removeDevice);
+    m_supervisor->start();
 }
 
 MainWindow::~MainWindow()
@@ -37,95 +49,118 @@ MainWindow::~MainWindow()
 
 void MainWindow::createBuilders()
 {
-    SettingsViewBuilder builder;
+    DeviceControllerBuilder controllerBuilder;
+    SettingsViewBuilder viewBuilder;
 
-    builder.type = DeviceType::MDM500M;
-    builder.moduleFabric = std::make_shared<ModuleFabric>();
-    builder.moduleViewFabric = std::make_shared<ModuleViewFabric>();
-    builder.nameRepo = std::make_shared<NameRepository>(new QFile("devices.xml"));
-    builder.settingsSerializer = std::make_shared<XmlSerializer>();
-    builder.transactionFabric = std::make_shared<MDM500M::TransactionFabric>();
-    m_builders[DeviceType::MDM500M] = builder;
+    controllerBuilder.type = DeviceType::MDM500M;
+    controllerBuilder.moduleFabric = std::make_shared<ModuleFabric>();
+    controllerBuilder.nameRepo = std::make_shared<NameRepository>(new QFile("devices.xml"));
+    controllerBuilder.transactionFabric = std::make_shared<MDM500M::TransactionFabric>();
+    m_supervisor->setBuilder(DeviceType::MDM500M, controllerBuilder);
+    viewBuilder.moduleViewFabric = std::make_shared<ModuleViewFabric>();
+    viewBuilder.settingsSerializer = std::make_shared<XmlSerializer>();
+    m_builders[DeviceType::MDM500M] = viewBuilder;
 
-    builder.type = DeviceType::MDM500;
-    builder.settingsSerializer = std::make_shared<CsvSerializer>();
-    builder.transactionFabric = std::make_shared<MDM500::TransactionFabric>();
-    m_builders[DeviceType::MDM500] = builder;
+    controllerBuilder.type = DeviceType::MDM500;
+    controllerBuilder.transactionFabric = std::make_shared<MDM500::TransactionFabric>();
+    m_supervisor->setBuilder(DeviceType::MDM500, controllerBuilder);
+    viewBuilder.settingsSerializer = std::make_shared<CsvSerializer>();
+    m_builders[DeviceType::MDM500] = viewBuilder;
 }
 
-void MainWindow::searchDevice()
+void MainWindow::addDevice(DeviceController *controller)
 {
-    m_invoker = std::make_unique<TransactionInvoker>();
-    auto transaction = new SearchDevice;
-    connect(transaction, &SearchDevice::found, this, [=](auto type)
+    // Представление настроек создается только для выбранной вкладки, а
+    // страница остается пустым контейнером
+    auto page = new QWidget();
+    auto layout = new QVBoxLayout(page);
+    layout->setContentsMargins(0, 0, 0, 0);
+    page->setProperty("address", controller->address());
+    auto miniView = new MiniView(&controller->device());
+    connect(miniView, &MiniView::controlModuleChanged,
+            controller, &DeviceController::setControlModule);
+    connect(controller, &DeviceController::logFailed, this, [=](const QString &message)
     {
-        // Строитель такого типа зарегистрирован
-        Q_ASSERT(m_builders.find(type) != m_builders.end());
-
-        // Создание новой вкладки
-        auto builder = m_builders[type];
-        builder.invoker = std::move(m_invoker);
-        auto settingsView = builder.build();
-        auto miniView = new MiniView(settingsView->device());
-        connect(miniView, &MiniView::controlModuleChanged,
-                settingsView, &SettingsView::setControlModule);
-        addTab(miniView, settingsView);
-
-        // При отключении устройства удалить вкладку
-        connect(settingsView, &SettingsView::disconnected, this, [=]
-        {
-            // Если приостанавливали поиск, потому что достигли ограничения, то
-            // возобновляем его
-            if (ui->tabs->count() == maxDeviceCount) {
-                searchDevice();
-            }
-            removeTab(settingsView);
-        });
-        // Если вкладок меньше максимального значения, то продолжаем поиск
-        if (ui->tabs->count() < maxDeviceCount) {
-            searchDevice();
-        }
+        QMessageBox::warning(this, tr("Ошибка создания файла журнала"), message);
     });
-    m_invoker->exec(transaction);
+    m_views[controller->address()] = page;
+    addTab(miniView, page);
 }
 
-void MainWindow::addTab(QWidget *miniView, QWidget *settingsView)
+void MainWindow::removeDevice(DeviceController *controller)
 {
-    int index = ui->tabs->addTab(settingsView, QString());
+    auto it = m_views.find(controller->address());
+    if (it == m_views.end()) {
+        return ;
+    }
+    auto page = it->second;
+    m_views.erase(it);
+    if (m_current == controller) {
+        m_current = nullptr;
+    }
+    removeTab(page);
+}
+
+void MainWindow::addTab(QWidget *miniView, QWidget *page)
+{
+    int index = ui->tabs->addTab(page, QString());
     ui->tabs->tabBar()->setTabButton(index, QTabBar::ButtonPosition::LeftSide, miniView);
     ui->tabs->show();
     ui->mainWindowEmptyLbl->hide();
 }
 
-void MainWindow::removeTab(QWidget *settingsView)
+void MainWindow::removeTab(QWidget *page)
 {
-    int index = ui->tabs->indexOf(settingsView);
+    int index = ui->tabs->indexOf(page);
     auto miniView = ui->tabs->tabBar()->tabButton(index, QTabBar::ButtonPosition::LeftSide);
+    if (m_settingsView && m_settingsView->parent() == page) {
+        m_settingsView = nullptr;
+    }
     ui->tabs->removeTab(index);
     miniView->deleteLater();
-    settingsView->deleteLater();
+    page->deleteLater();
     ui->tabs->setVisible(ui->tabs->count() > 0);
     ui->mainWindowEmptyLbl->setVisible(ui->tabs->count() == 0);
 }
 
 void MainWindow::onCurrentTabChanged(int index)
 {
-    if (index == -1) {
+    // Удаление откладывается: смена вкладки может произойти из обработчика
+    // сигнала самого представления
+    if (m_settingsView) {
+        m_settingsView->deleteLater();
+        m_settingsView = nullptr;
+    }
+    if (m_current) {
+        m_supervisor->scheduler().setVisible(m_current, false);
+    }
+    auto controller = index == -1
+            ? nullptr
+            : m_supervisor->controller(ui->tabs->widget(index)->property("address").toString());
+    m_current = controller;
+    if (!controller) {
         ui->title->setText(tr("Демодуляторы МДМ-500 и МДМ-500М"));
         return ;
     }
-    QString type = ui->tabs->widget(index)->property("type").toString();
-    ui->title->setText(tr("Демодулятор %1").arg(type));
+    // Показываемое устройство опрашивается часто
+    m_supervisor->scheduler().setVisible(controller, true);
+    auto &&device = controller->device();
+    m_settingsView = m_builders[device.data().type].build(controller);
+    ui->tabs->widget(index)->layout()->addWidget(m_settingsView);
+    ui->title->setText(tr("Демодулятор %1").arg(device.type()));
 }
 
 void MainWindow::clearTabs()
 {
+    m_views.clear();
+    m_settingsView = nullptr;
+    m_current = nullptr;
     while (ui->tabs->count() > 0) {
         auto miniView = ui->tabs->tabBar()->tabButton(0, QTabBar::ButtonPosition::LeftSide);
-        auto settingsView = ui->tabs->widget(0);
+        auto page = ui->tabs->widget(0);
         ui->tabs->removeTab(0);
         miniView->deleteLater();
-        settingsView->deleteLater();
+        page->deleteLater();
     }
     ui->tabs->hide();
     ui->mainWindowEmptyLbl->show();
@@ -134,6 +169,7 @@ void MainWindow::clearTabs()
 void MainWindow::readSettings()
 {
     QSettings settings("settings.ini", QSettings::Format::IniFormat);
+    m_transports = settings.value("transports").toStringList();
     auto geometry = settings.value("geometry");
     if (geometry.isValid()) {
         restoreGeometry(geometry.toByteArray());
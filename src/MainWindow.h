@@ -1,8 +1,10 @@
 #pragma once
 
+#include <map>
 #include <memory>
 #include <unordered_map>
 
+#include <QStringList>
 #include <QWidget>
 
 #include "SettingsView.h"
@@ -10,7 +12,10 @@
 namespace Ui {
 class MainWindow;
 }
-class TransactionInvoker;
+class DeviceCache;
+class DeviceController;
+class DeviceSupervisor;
+class LinkReactor;
 
 class MainWindow : public QWidget
 {
@@ -21,12 +26,11 @@ public:
     ~MainWindow();
 
 private:
-    static constexpr int maxDeviceCount = 4;
-
     void createBuilders();
-    void searchDevice();
-    void addTab(QWidget *miniView, QWidget *settingsView);
-    void removeTab(QWidget *settingsView);
+    void addDevice(DeviceController *controller);
+    void removeDevice(DeviceController *controller);
+    void addTab(QWidget *miniView, QWidget *page);
+    void removeTab(QWidget *page);
     void onCurrentTabChanged(int index);
     void clearTabs();
     void readSettings();
@@ -34,5 +38,11 @@ private:
 
     std::unordered_map<DeviceType, SettingsViewBuilder> m_builders;
     std::unique_ptr<Ui::MainWindow> ui;
-    std::unique_ptr<TransactionInvoker> m_invoker;
+    QStringList m_transports; /**< Адреса удаленных и виртуальных портов */
+    std::shared_ptr<LinkReactor> m_reactor;
+    std::shared_ptr<DeviceCache> m_cache;
+    std::unique_ptr<DeviceSupervisor> m_supervisor;
+    std::map<QString, QWidget *> m_views; /**< Вкладки по адресу порта устройства */
+    SettingsView *m_settingsView = nullptr; /**< Представление текущей вкладки */
+    DeviceController *m_current = nullptr;  /**< Устройство текущей вкладки   */
 };
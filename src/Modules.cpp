@@ -150,6 +150,11 @@ void Module::setModuleStates(MDM500M::ModuleStates::States states)
     Q_UNUSED(states);
 }
 
+bool Module::hasModuleStates() const
+{
+    return false;
+}
+
 EmptyModule::EmptyModule(int slot, DeviceData &data, std::shared_ptr<Interfaces::ChannelTable> chTable)
     : Module(slot, data, chTable)
 {
@@ -431,6 +436,11 @@ int8_t DM500FM::convertThresholdLevels(int lvl) const
     return ModuleInfo<DM500FM>::serializeThresholdLevel(lvl);
 }
 
+bool DM500FM::hasModuleStates() const
+{
+    return true;
+}
+
 void DM500FM::setModuleStates(MDM500M::ModuleStates::States states)
 {
     auto &config = m_data.config.modules[slot()];
@@ -97,6 +97,10 @@ public:
     ModuleError error() const;
     ScaleLevel scaleLevel() const;
     bool isSupportSignalLevel() const;
+    /**
+     * @brief Истина, если модуль отображает ModuleStates (RDS, стерео)
+     */
+    virtual bool hasModuleStates() const;
     int signalLevel() const;
     int thresholdLevel() const;
     virtual int convertScaleLevelToSignalLevel(int value) const = 0;
@@ -236,6 +240,7 @@ public:
     int volume() const;
     void setVolume(int volume);
     void accept(Interfaces::ModuleVisitor &visitor) override;
+    bool hasModuleStates() const override;
 
 signals:
     void rdsChanged(bool);
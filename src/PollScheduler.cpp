@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <limits>
+
+#include <QTimer>
+
+#include "Device.h"
+#include "DeviceController.h"
+#include "PollScheduler.h"
+
+using namespace std::chrono;
+
+namespace {
+
+constexpr qint64 kNever = std::numeric_limits<qint64>::max();
+
+} // namespace
+
+PollScheduler::PollScheduler(QObject *parent)
+    : QObject(parent)
+    , m_timer(new QTimer(this))
+{
+    m_clock.start();
+    m_timer->setSingleShot(true);
+    connect(m_timer, &QTimer::timeout, this, &PollScheduler::onTimeout);
+}
+
+PollScheduler::~PollScheduler() = default;
+
+void PollScheduler::add(DeviceController *controller)
+{
+    State state;
+    state.adaptiveInterval = m_intervals.fast.count();
+    state.due = m_clock.elapsed();
+    state.cost = kInitialCost.count();
+    m_states[controller] = state;
+    connect(controller, &DeviceController::ready, this, [=]
+    {
+        expedite(controller);
+    });
+    connect(controller, &DeviceController::polled, this, [=](bool changed, milliseconds elapsed)
+    {
+        onPolled(controller, changed, elapsed);
+    });
+    updateStretch();
+    arm();
+}
+
+void PollScheduler::remove(DeviceController *controller)
+{
+    if (m_states.erase(controller) == 0) {
+        return ;
+    }
+    disconnect(controller, nullptr, this, nullptr);
+    updateStretch();
+    arm();
+}
+
+void PollScheduler::setVisible(DeviceController *controller, bool visible)
+{
+    auto it = m_states.find(controller);
+    if (it == m_states.end() || it->second.visible == visible) {
+        return ;
+    }
+    it->second.visible = visible;
+    updateStretch();
+    if (visible) {
+        expedite(controller);
+    }
+}
+
+void PollScheduler::setBudget(double budget)
+{
+    m_budget = budget;
+    updateStretch();
+}
+
+double PollScheduler::budget() const
+{
+    return m_budget;
+}
+
+void PollScheduler::setIntervals(const Intervals &intervals)
+{
+    m_intervals = intervals;
+    for (auto &&item : m_states) {
+        auto &&interval = item.second.adaptiveInterval;
+        interval = qBound<qint64>(m_intervals.fast.count(), interval, m_intervals.slow.count());
+    }
+    updateStretch();
+}
+
+const PollScheduler::Intervals &PollScheduler::intervals() const
+{
+    return m_intervals;
+}
+
+milliseconds PollScheduler::interval(DeviceController *controller) const
+{
+    auto it = m_states.find(controller);
+    if (it == m_states.end()) {
+        return milliseconds::zero();
+    }
+    return milliseconds(effectiveInterval(controller, it->second));
+}
+
+bool PollScheduler::isPriority(DeviceController *controller, const State &state) const
+{
+    return state.visible || controller->device().isError();
+}
+
+qint64 PollScheduler::effectiveInterval(DeviceController *controller, const State &state) const
+{
+    if (isPriority(controller, state)) {
+        return m_intervals.fast.count();
+    }
+    auto stretched = static_cast<qint64>(state.adaptiveInterval * m_stretch);
+    return std::min<qint64>(stretched, m_intervals.max.count());
+}
+
+void PollScheduler::updateStretch()
+{
+    // Загрузка - доля времени, которую линия занята опросом
+    double priorityLoad = 0;
+    double backgroundLoad = 0;
+    for (auto &&item : m_states) {
+        auto &&state = item.second;
+        if (isPriority(item.first, state)) {
+            priorityLoad += state.cost / m_intervals.fast.count();
+        }
+        else {
+            backgroundLoad += state.cost / state.adaptiveInterval;
+        }
+    }
+    auto available = m_budget - priorityLoad;
+    if (backgroundLoad <= available) {
+        m_stretch = 1.0;
+    }
+    else if (available <= 0) {
+        m_stretch = static_cast<double>(m_intervals.max.count()) / m_intervals.fast.count();
+    }
+    else {
+        m_stretch = backgroundLoad / available;
+    }
+}
+
+void PollScheduler::onPolled(DeviceController *controller, bool changed, milliseconds elapsed)
+{
+    auto it = m_states.find(controller);
+    if (it == m_states.end()) {
+        return ;
+    }
+    auto &&state = it->second;
+    // Авария, обнаруженная этим опросом, учитывается уже в новом интервале
+    state.cost += (elapsed.count() - state.cost) / 8;
+    state.adaptiveInterval = changed
+            ? std::max<qint64>(state.adaptiveInterval / 2, m_intervals.fast.count())
+            : std::min<qint64>(state.adaptiveInterval * 3 / 2, m_intervals.slow.count());
+    updateStretch();
+    state.due = m_clock.elapsed() + effectiveInterval(controller, state);
+    arm();
+}
+
+void PollScheduler::expedite(DeviceController *controller)
+{
+    auto it = m_states.find(controller);
+    if (it == m_states.end()) {
+        return ;
+    }
+    auto &&state = it->second;
+    if (state.due == kNever) {
+        // Опрос уже выполняется
+        return ;
+    }
+    state.due = std::min(state.due, m_clock.elapsed());
+    arm();
+}
+
+void PollScheduler::arm()
+{
+    qint64 next = kNever;
+    for (auto &&item : m_states) {
+        next = std::min(next, item.second.due);
+    }
+    if (next == kNever) {
+        m_timer->stop();
+        return ;
+    }
+    auto delay = std::max<qint64>(next - m_clock.elapsed(), 0);
+    m_timer->start(static_cast<int>(delay));
+}
+
+void PollScheduler::onTimeout()
+{
+    const auto now = m_clock.elapsed();
+    for (auto &&item : m_states) {
+        auto controller = item.first;
+        auto &&state = item.second;
+        if (state.due > now) {
+            continue;
+        }
+        if (controller->canPoll()) {
+            state.due = kNever;
+            controller->poll();
+        }
+        else {
+            // Устройство еще не прочитано или занято обновлением прошивки;
+            // о готовности оно сообщит сигналом ready()
+            state.due = now + effectiveInterval(controller, state);
+        }
+    }
+    arm();
+}
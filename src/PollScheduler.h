@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+
+#include <QElapsedTimer>
+#include <QObject>
+
+class DeviceController;
+class QTimer;
+
+/**
+ * @brief Общий планировщик опроса устройств
+ *
+ * Интервал опроса каждого устройства выбирается по его состоянию:
+ * - выбранное на экране устройство и устройство с аварией опрашиваются
+ *   каждые Intervals::fast;
+ * - остальные - адаптивно: опрос, заметивший изменения, вдвое сокращает
+ *   интервал, опрос без изменений увеличивает его в полтора раза, в
+ *   пределах от Intervals::fast до Intervals::slow.
+ *
+ * Время занятости линий опросом ограничено бюджетом: сумма по устройствам
+ * отношений длительности опроса к интервалу не превышает budget(). Если
+ * бюджета не хватает, растягиваются интервалы только фоновых устройств (не
+ * дальше Intervals::max).
+ *
+ * Планировщик использует один таймер на все устройства, взводимый на
+ * ближайший срок.
+ */
+class PollScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Intervals
+    {
+        std::chrono::milliseconds fast { 800 };
+        std::chrono::milliseconds slow { 10000 };
+        std::chrono::milliseconds max  { 60000 };
+    };
+
+    PollScheduler(QObject *parent = nullptr);
+    ~PollScheduler() override;
+
+    void add(DeviceController *controller);
+    void remove(DeviceController *controller);
+    /**
+     * @brief Отметить устройство как показываемое пользователю
+     */
+    void setVisible(DeviceController *controller, bool visible);
+    /**
+     * @brief Бюджет занятости линий в долях одной постоянно занятой линии
+     */
+    void setBudget(double budget);
+    double budget() const;
+    void setIntervals(const Intervals &intervals);
+    const Intervals &intervals() const;
+    /**
+     * @brief Текущий интервал опроса устройства
+     */
+    std::chrono::milliseconds interval(DeviceController *controller) const;
+
+private:
+    static constexpr std::chrono::milliseconds kInitialCost { 100 };
+    static constexpr double kDefaultBudget = 8.0;
+
+    struct State
+    {
+        qint64 adaptiveInterval;  /**< Интервал фонового опроса, мс        */
+        qint64 due;               /**< Срок следующего опроса по m_clock  */
+        double cost;              /**< Сглаженная длительность опроса, мс */
+        bool visible = false;
+    };
+
+    bool isPriority(DeviceController *controller, const State &state) const;
+    qint64 effectiveInterval(DeviceController *controller, const State &state) const;
+    void updateStretch();
+    void onPolled(DeviceController *controller, bool changed, std::chrono::milliseconds elapsed);
+    /**
+     * @brief Опросить устройство при первой возможности
+     */
+    void expedite(DeviceController *controller);
+    void arm();
+    void onTimeout();
+
+    std::map<DeviceController *, State> m_states;
+    QElapsedTimer m_clock;
+    QTimer *m_timer;
+    Intervals m_intervals;
+    double m_budget = kDefaultBudget;
+    double m_stretch = 1.0; /**< Множитель интервалов фоновых устройств */
+};
@@ -0,0 +1,131 @@
+#include <QCoreApplication>
+#include <QTimer>
+
+#include "PortWatcher.h"
+
+#if defined(Q_OS_LINUX)
+#include <QDir>
+#include <QFileSystemWatcher>
+#elif defined(Q_OS_WIN)
+#include <QAbstractNativeEventFilter>
+#include <qt_windows.h>
+#include <dbt.h>
+#endif
+
+#if defined(Q_OS_LINUX)
+
+class PortWatcher::Backend
+{
+public:
+    Backend(PortWatcher *owner)
+        : m_watcher(owner)
+    {
+        QObject::connect(&m_watcher, &QFileSystemWatcher::directoryChanged, owner, [this, owner] {
+            // Каталог by-id создается вместе с первым USB-портом и удаляется
+            // с последним, поэтому наблюдение за ним восстанавливается
+            watch();
+            owner->notify();
+        });
+        watch();
+    }
+
+    bool isSupported() const
+    {
+        return !m_watcher.directories().isEmpty();
+    }
+
+private:
+    void watch()
+    {
+        for (auto &&path : QStringList { "/dev", "/dev/serial/by-id" }) {
+            if (!m_watcher.directories().contains(path) && QDir(path).exists()) {
+                m_watcher.addPath(path);
+            }
+        }
+    }
+
+    QFileSystemWatcher m_watcher;
+};
+
+#elif defined(Q_OS_WIN)
+
+class PortWatcher::Backend : public QAbstractNativeEventFilter
+{
+public:
+    Backend(PortWatcher *owner)
+        : m_owner(owner)
+    {
+        // О портах DBT_DEVTYP_PORT система сообщает всем окнам верхнего
+        // уровня без регистрации
+        QCoreApplication::instance()->installNativeEventFilter(this);
+    }
+
+    ~Backend() override
+    {
+        QCoreApplication::instance()->removeNativeEventFilter(this);
+    }
+
+    bool isSupported() const
+    {
+        return true;
+    }
+
+    bool nativeEventFilter(const QByteArray &eventType, void *message, long *) override
+    {
+        if (eventType != "windows_generic_MSG") {
+            return false;
+        }
+        auto msg = static_cast<const MSG *>(message);
+        if (msg->message == WM_DEVICECHANGE
+                && (msg->wParam == DBT_DEVICEARRIVAL || msg->wParam == DBT_DEVICEREMOVECOMPLETE)) {
+            auto header = reinterpret_cast<const DEV_BROADCAST_HDR *>(msg->lParam);
+            if (header && header->dbch_devicetype == DBT_DEVTYP_PORT) {
+                QMetaObject::invokeMethod(m_owner, [this] {
+                    m_owner->notify();
+                }, Qt::QueuedConnection);
+            }
+        }
+        return false;
+    }
+
+private:
+    PortWatcher *m_owner;
+};
+
+#else
+
+class PortWatcher::Backend
+{
+public:
+    Backend(PortWatcher *)
+    {}
+
+    bool isSupported() const
+    {
+        return false;
+    }
+};
+
+#endif
+
+PortWatcher::PortWatcher(QObject *parent)
+    : QObject(parent)
+    , m_settle(new QTimer(this))
+{
+    m_settle->setSingleShot(true);
+    m_settle->setInterval(kSettleInterval);
+    connect(m_settle, &QTimer::timeout, this, &PortWatcher::changed);
+    m_backend = std::make_unique<Backend>(this);
+}
+
+PortWatcher::~PortWatcher() = default;
+
+bool PortWatcher::isSupported() const
+{
+    return m_backend->isSupported();
+}
+
+void PortWatcher::notify()
+{
+    m_settle->start();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <memory>
+
+#include <QObject>
+
+class QTimer;
+
+/**
+ * @brief Уведомления о подключении и отключении последовательных портов
+ *
+ * На Linux следит через inotify (QFileSystemWatcher) за каталогами /dev и
+ * /dev/serial/by-id, на Windows - за сообщением WM_DEVICECHANGE. Пачка
+ * изменений (создание узла, смена прав, символические ссылки) сводится в
+ * один сигнал changed() после kSettleInterval, чтобы QSerialPortInfo успел
+ * увидеть новый порт.
+ */
+class PortWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    PortWatcher(QObject *parent = nullptr);
+    ~PortWatcher() override;
+
+    /**
+     * @brief Этот метод возвращает истину, если платформа сообщает об
+     * изменениях; иначе порты нужно опрашивать периодически.
+     */
+    bool isSupported() const;
+
+signals:
+    void changed();
+
+private:
+    static constexpr int kSettleInterval = 300;
+
+    class Backend;
+
+    void notify();
+
+    QTimer *m_settle;
+    std::unique_ptr<Backend> m_backend;
+};
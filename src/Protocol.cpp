@@ -1,17 +1,36 @@
+#include "InterruptibleWait.h"
+#include "Link.h"
 #include "Protocol.h"
 
-Protocol::Protocol(QSerialPort &port)
-    : m_port(port)
+Protocol::Protocol(Link &link)
+    : m_link(link)
+    , m_port(link.transport())
 {}
 
+Protocol::~Protocol()
+{
+    countRejected();
+}
+
+Protocol::CommandClass Protocol::commandClass(Command cmd)
+{
+    switch (cmd) {
+    case Command::WriteConfig:
+    case Command::WriteTemplateConfig:
+        return CommandClass::Eeprom;
+    case Command::WriteTempModuleConfig:
+    case Command::WriteTempControlModule:
+    case Command::WriteThresholdLevels:
+    case Command::ResetErrors:
+        return CommandClass::Control;
+    default:
+        return CommandClass::Query;
+    }
+}
+
 bool Protocol::configure()
 {
-    return m_port.setBaudRate(QSerialPort::Baud19200)
-        && m_port.setDataBits(QSerialPort::Data8)
-        && m_port.setFlowControl(QSerialPort::NoFlowControl)
-        && m_port.setParity(QSerialPort::NoParity)
-        && m_port.setRequestToSend(true)
-        && m_port.setDataTerminalReady(true);
+    return m_port.configure(kBaudRate);
 }
 
 uint8_t Protocol::calcCrc(Protocol::Command cmd, const void *data, int size)
@@ -33,27 +52,128 @@ bool Protocol::set(Command cmd, Error &error, const void *cmdParams, int cmdPara
     return performDefaultDialog(cmd, cmdParams, cmdParamsSize, &error, sizeof(error), timeout);
 }
 
+bool Protocol::setOnce(Command cmd, Error &error, std::chrono::milliseconds timeout)
+{
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    using std::chrono::nanoseconds;
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    countAttempt(cmd, 0);
+    if (!write(cmd, nullptr, 0)) {
+        countFailure(cmd);
+        return false;
+    }
+    if (read(DefaultReader(cmd, &error, sizeof(error)), timeout)) {
+        countReply(cmd, duration_cast<microseconds>(nanoseconds(elapsed.nsecsElapsed())));
+        return true;
+    }
+    if (!isCancelled()) {
+        countTimeout(cmd);
+        countFailure(cmd);
+    }
+    return false;
+}
+
+bool Protocol::probe(Command cmd, std::chrono::milliseconds listen)
+{
+    if (!write(cmd, nullptr, 0)) {
+        return false;
+    }
+    return read(LivenessReader(), listen);
+}
+
+int Protocol::encode(Command cmd, const void *data, int size, uint8_t *frame)
+{
+    Q_ASSERT(size >= 0 && size + FrameDecoder::kMinPackageSize <= FrameDecoder::kMaxPackageSize);
+    frame[0] = kPackageMarker;
+    frame[1] = static_cast<uint8_t>(size + kMinValueOfSizeField);
+    frame[2] = static_cast<uint8_t>(cmd);
+    if (size > 0) {
+        memcpy(frame + 3, data, static_cast<size_t>(size));
+    }
+    frame[3 + size] = calcCrc(cmd, data, size);
+    return size + FrameDecoder::kMinPackageSize;
+}
+
 bool Protocol::write(Command cmd, const void *data, int size)
 {
-    m_port.putChar(static_cast<char>(kPackageMarker             ));
-    m_port.putChar(static_cast<char>(size + kMinValueOfSizeField));
-    m_port.putChar(static_cast<char>(cmd                        ));
-    m_port.write(reinterpret_cast<const char *>(data), size);
-    m_port.putChar(static_cast<char>(calcCrc(cmd, data, size)));
+    uint8_t frame[FrameDecoder::kMaxPackageSize];
+    int frameSize = encode(cmd, data, size, frame);
+    m_port.write(reinterpret_cast<const char *>(frame), frameSize);
+    m_link.statistics().addBytesOut(frameSize);
     return m_port.waitForBytesWritten(kWriteTimeout.count());
 }
 
-bool Protocol::performDefaultDialog(Command cmd, const void *writeBuffer, int writeBufferSize, void *readBuffer, int readBufferSize, std::chrono::milliseconds timeout)
+int Protocol::receive()
+{
+    countRejected();
+    int bytes = m_decoder.fill(m_port);
+    m_link.statistics().addBytesIn(bytes);
+    return bytes;
+}
+
+void Protocol::countAttempt(Command cmd, int attempt)
 {
-    for (int attempt = 0; attempt < kMaxAttemptsCount; ++attempt) {
-        if (!write(cmd, writeBuffer, writeBufferSize)) {
-            return false;
-        }
-        if (read(DefaultReader(cmd, readBuffer, readBufferSize), timeout)) {
-            return true;
-        }
+    auto &&statistics = m_link.statistics();
+    if (attempt == 0) {
+        statistics.addRequest(cmd);
     }
-    return false;
+    else {
+        statistics.addRetry(cmd);
+    }
+}
+
+void Protocol::countTimeout(Command cmd)
+{
+    m_link.statistics().addTimeout(cmd);
+}
+
+void Protocol::countReply(Command cmd, std::chrono::microseconds latency)
+{
+    m_link.statistics().addLatency(cmd, latency);
+}
+
+void Protocol::countFailure(Command cmd)
+{
+    m_link.statistics().addFailure(cmd);
+}
+
+void Protocol::countRejected()
+{
+    int rejected = m_decoder.rejectedCount();
+    m_link.statistics().addCrcErrors(rejected - m_rejected);
+    m_rejected = rejected;
+}
+
+bool Protocol::wait(QDeadlineTimer timer)
+{
+    return InterruptibleWait::readyRead(m_port, timer, m_link.cancelToken());
+}
+
+bool Protocol::isCancelled() const
+{
+    return m_link.cancelToken().isCancelled();
+}
+
+bool Protocol::performDefaultDialog(Command cmd, const void *writeBuffer, int writeBufferSize, void *readBuffer, int readBufferSize, std::chrono::milliseconds timeout)
+{
+    return dialog(cmd, writeBuffer, writeBufferSize,
+                  DefaultReader(cmd, readBuffer, readBufferSize),
+                  readBufferSize, kMaxAttemptsCount, timeout);
+}
+
+RttEstimator &Protocol::estimator(Command cmd)
+{
+    return m_link.rtt(commandClass(cmd));
+}
+
+std::chrono::milliseconds Protocol::transferTime(int bytes)
+{
+    // 19200 бод, 10 бит на байт (старт, 8 бит данных, стоп)
+    constexpr int kBitsPerByte = 10;
+    return std::chrono::milliseconds((bytes * kBitsPerByte * 1000 + kBaudRate - 1) / kBaudRate);
 }
 
 DefaultReader::DefaultReader(Protocol::Command cmd, void *buffer, int size)
@@ -62,11 +182,6 @@ DefaultReader::DefaultReader(Protocol::Command cmd, void *buffer, int size)
     , m_cmd(cmd)
 {}
 
-bool DefaultReader::isDataEnough(int size) const
-{
-    return size >= m_size;
-}
-
 bool DefaultReader::checkPackage(Protocol::Command cmd, const void *data, int size)
 {
     if (m_cmd != cmd || m_size != size) {
@@ -76,3 +191,10 @@ bool DefaultReader::checkPackage(Protocol::Command cmd, const void *data, int si
     return true;
 }
 
+bool LivenessReader::checkPackage(Protocol::Command cmd, const void *, int)
+{
+    // Случайные байты на линии (например, остатки диалога с загрузчиком на
+    // другой скорости) изредка проходят проверку суммы, но почти никогда не
+    // несут известной команды
+    return cmd <= Protocol::Command::ReadModuleStates;
+}
@@ -1,7 +1,13 @@
 #pragma once
 
 #include <QDeadlineTimer>
-#include <QSerialPort>
+#include <QElapsedTimer>
+
+#include "FrameDecoder.h"
+#include "RttEstimator.h"
+#include "Transport.h"
+
+class Link;
 
 class Protocol
 {
@@ -47,18 +53,46 @@ public:
         CantWrite = 5,      /**< WriteConfig - не записалось, WriteTempModuleConfig - не загрузился модуль    */
     };
 
+    /**
+     * @brief Классы команд с разным временем ответа устройства.
+     *
+     * Для каждого класса канал ведет собственную оценку времени ответа.
+     */
+    enum class CommandClass
+    {
+        Query,   /**< Чтение данных                         */
+        Control, /**< Временная установка параметров         */
+        Eeprom,  /**< Запись конфигурации в постоянную память */
+        Count
+    };
+
+    static CommandClass commandClass(Command cmd);
+
     struct ReaderTag {};
 
+    /**
+     * @brief Максимальное количество запросов в одном конвейерном диалоге
+     * (см. AsyncProtocol::Mode::Pipelined)
+     */
+    static constexpr int kMaxPipelineDepth = 8;
+
     // struct Reader
     // {
     //     typedef Protocol::ReaderTag ReaderTag;
-    //     bool isDataEnough(int size);
     //     bool checkPackage(Protocol::Command cmd, const void *data, int size);
     // };
 
-    Protocol(QSerialPort &port);
+    Protocol(Link &link);
+    ~Protocol();
     bool configure();
 
+    /**
+     * @brief Этот метод формирует пакет запроса.
+     * @param[out] frame - Буфер размером не меньше FrameDecoder::kMaxPackageSize
+     * @return Размер пакета
+     */
+    static int encode(Command cmd, const void *data, int size, uint8_t *frame);
+
     template <typename AnswerData>
     bool get(Command cmd, AnswerData &data);
 
@@ -100,21 +134,63 @@ public:
              int cmdParamsSize = 0,
              std::chrono::milliseconds timeout = kDefaultReadTimeout);
 
+    /**
+     * @brief Команда, которую нельзя повторять (Reboot)
+     *
+     * Запрос передается один раз, ответ ожидается ровно timeout: поздний
+     * ответ не должен вызвать повторную команду, которая попала бы уже в
+     * загрузчик или в только что запущенную прошивку. Оценка времени ответа
+     * не используется и не обновляется.
+     * @return Вернет истину, если получен ответ, ложь - иначе.
+     */
+    bool setOnce(Command cmd, Error &error, std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Проверка, что устройство на связи
+     *
+     * Команда cmd передается один раз, после чего в течение listen
+     * ожидается любой пакет с верной контрольной суммой, не обязательно
+     * ответ на эту команду: поздний ответ на предыдущую проверку тоже
+     * означает, что устройство работает. Промахи ожидаемы (устройство еще
+     * загружается), поэтому они не влияют на оценку времени ответа и
+     * статистику канала.
+     * @return Вернет истину, если пакет получен, ложь - иначе.
+     */
+    bool probe(Command cmd, std::chrono::milliseconds listen);
+
 private:
-    static constexpr int     kMaxAttemptsCount    = 2;
-    static constexpr int     kMinPackageSize      = 4;
-    static constexpr uint8_t kMinValueOfSizeField = 2;
-    static constexpr uint8_t kPackageMarker       = 0xA5;
+    friend class AsyncProtocol;
+
+    static constexpr int     kMaxAttemptsCount    = 3;
+    static constexpr qint32  kBaudRate            = 19200;
+    static constexpr uint8_t kMinValueOfSizeField = FrameDecoder::kMinValueOfSizeField;
+    static constexpr uint8_t kPackageMarker       = FrameDecoder::kPackageMarker;
     static constexpr std::chrono::milliseconds kWriteTimeout { 500 };
+    // Верхняя граница ожидания ответа, фактический таймаут задает RttEstimator
     static constexpr std::chrono::milliseconds kDefaultReadTimeout { 2000 };
 
     bool performDefaultDialog(Command cmd, const void *writeBuffer, int writeBufferSize,
                               void *readBuffer, int readBufferSize, std::chrono::milliseconds timeout);
 
     template <typename Reader>
-    bool wait(Reader &&reader, QDeadlineTimer timer);
+    bool dialog(Command cmd, const void *data, int size, Reader &&reader,
+                int replySize, int attempts, std::chrono::milliseconds timeout);
+
+    RttEstimator &estimator(Command cmd);
+    static std::chrono::milliseconds transferTime(int bytes);
+
+    bool wait(QDeadlineTimer timer);
+    bool isCancelled() const;
 
     bool write(Command cmd, const void *data, int size);
+    int receive();
+
+    // Учет диалогов в статистике канала (LinkStatistics)
+    void countAttempt(Command cmd, int attempt);
+    void countTimeout(Command cmd);
+    void countReply(Command cmd, std::chrono::microseconds latency);
+    void countFailure(Command cmd);
+    void countRejected();
 
     template <typename Reader>
     bool read(Reader &&reader, std::chrono::milliseconds timeout);
@@ -122,16 +198,18 @@ private:
     template <typename Reader>
     bool readPackage(Reader &&reader);
 
-    uint8_t calcCrc(Command cmd, const void *data, int size);
+    static uint8_t calcCrc(Command cmd, const void *data, int size);
 
-    QSerialPort &m_port;
+    Link &m_link;
+    Transport &m_port;
+    FrameDecoder m_decoder;
+    int m_rejected = 0; /**< Отброшенные пакеты, уже учтенные в статистике */
 };
 
 class DefaultReader
 {
 public:
     DefaultReader(Protocol::Command cmd, void *buffer, int size);
-    bool isDataEnough(int size) const;
     bool checkPackage(Protocol::Command cmd, const void *data, int size);
 
 private:
@@ -140,26 +218,53 @@ private:
     Protocol::Command m_cmd;
 };
 
-inline uint8_t getch(QIODevice &device)
+/**
+ * @brief Принимает любой пакет с известной командой (см. Protocol::probe)
+ */
+class LivenessReader
 {
-    uint8_t retval;
-    device.getChar(reinterpret_cast<char *>(&retval));
-    return retval;
-}
+public:
+    bool checkPackage(Protocol::Command cmd, const void *data, int size);
+};
 
 template <typename Reader>
-bool Protocol::wait(Reader &&reader, QDeadlineTimer timer)
+bool Protocol::dialog(Command cmd, const void *data, int size, Reader &&reader,
+                      int replySize, int attempts, std::chrono::milliseconds timeout)
 {
-    do {
-        auto bytesAvailable = m_port.bytesAvailable();
-        if (bytesAvailable >= kMinPackageSize) {
-            if (reader.isDataEnough(bytesAvailable - kMinPackageSize)) {
-                return true;
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    using std::chrono::nanoseconds;
+
+    auto &rtt = estimator(cmd);
+    const auto transfer = transferTime(size + replySize + 2 * FrameDecoder::kMinPackageSize);
+    QElapsedTimer total;
+    total.start();
+    for (int attempt = 0; attempt < attempts; ++attempt) {
+        QElapsedTimer elapsed;
+        elapsed.start();
+        countAttempt(cmd, attempt);
+        if (!write(cmd, data, size)) {
+            countFailure(cmd);
+            return false;
+        }
+        if (read(reader, std::min(rtt.timeout() + transfer, timeout))) {
+            // Ответ на повторный запрос нельзя отнести к конкретной попытке,
+            // поэтому время замеряется только по первой (алгоритм Карна)
+            if (attempt == 0) {
+                auto turnaround = nanoseconds(elapsed.nsecsElapsed()) - transfer;
+                rtt.addSample(duration_cast<microseconds>(turnaround));
             }
+            countReply(cmd, duration_cast<microseconds>(nanoseconds(total.nsecsElapsed())));
+            return true;
+        }
+        if (isCancelled()) {
+            // Ответ не дождались из-за отмены, а не из-за устройства
+            return false;
         }
-        m_port.waitForReadyRead(static_cast<int>(timer.remainingTime()));
+        countTimeout(cmd);
+        rtt.backoff();
     }
-    while (!timer.hasExpired());
+    countFailure(cmd);
     return false;
 }
 
@@ -167,33 +272,27 @@ template <typename Reader>
 bool Protocol::read(Reader &&reader, std::chrono::milliseconds timeout)
 {
     QDeadlineTimer timer(timeout);
-    do {
-        if (!wait(reader, timer)) {
+    while (!readPackage(reader)) {
+        if (!wait(timer)) {
             return false;
         }
     }
-    while (!readPackage(reader));
     return true;
 }
 
 template <typename Reader>
 bool Protocol::readPackage(Reader &&reader)
 {
-    if (getch(m_port) != kPackageMarker) {
-        return false;
-    }
-    auto sizeField   = getch(m_port);
-    if (sizeField < kMinValueOfSizeField) {
-        return false;
-    }
-    auto cmdField    = static_cast<Command>(getch(m_port));
-    auto dataField   = m_port.read(sizeField - kMinValueOfSizeField);
-    auto expectedCrc = getch(m_port);
-    auto actualCrc   = calcCrc(cmdField, dataField.data(), dataField.size());
-    if (expectedCrc != actualCrc) {
-        return false;
+    auto handler = [&reader](uint8_t cmd, const void *data, int size) {
+        return reader.checkPackage(static_cast<Command>(cmd), data, size);
+    };
+    do {
+        if (m_decoder.decode(handler)) {
+            return true;
+        }
     }
-    return reader.checkPackage(cmdField, dataField.data(), dataField.size());
+    while (receive() > 0);
+    return false;
 }
 
 template <typename Data>
@@ -237,8 +336,7 @@ bool Protocol::get(Command request, Reader &&reader, std::chrono::duration<T, Q>
 {
     using std::chrono::duration_cast;
     using std::chrono::milliseconds;
-    return write(request, nullptr, 0)
-        && read(std::forward<Reader>(reader), duration_cast<milliseconds>(timeout));
+    return dialog(request, nullptr, 0, reader, 0, 1, duration_cast<milliseconds>(timeout));
 }
 
 template <typename Params, typename Reader>
@@ -265,6 +363,5 @@ bool Protocol::set(Command cmd, const void *data, int size, Reader &&reader,
 {
     using std::chrono::duration_cast;
     using std::chrono::milliseconds;
-    return write(cmd, data, size)
-        && read(std::forward<Reader>(reader), duration_cast<milliseconds>(timeout));
+    return dialog(cmd, data, size, reader, 0, 1, duration_cast<milliseconds>(timeout));
 }
@@ -0,0 +1,68 @@
+#include <algorithm>
+
+#include "RttEstimator.h"
+
+using namespace std::chrono;
+
+RttEstimator::RttEstimator(milliseconds initial, milliseconds min, milliseconds max)
+    : m_initial(initial)
+    , m_min(min)
+    , m_max(max)
+    , m_timeout(initial)
+{}
+
+void RttEstimator::addSample(microseconds rtt)
+{
+    rtt = std::max(rtt, microseconds::zero());
+    if (!m_hasSamples) {
+        m_srtt = rtt;
+        m_rttvar = rtt / 2;
+        m_hasSamples = true;
+    }
+    else {
+        // rttvar = 3/4 rttvar + 1/4 |srtt - rtt|, srtt = 7/8 srtt + 1/8 rtt
+        auto delta = m_srtt > rtt ? m_srtt - rtt : rtt - m_srtt;
+        m_rttvar = (m_rttvar * 3 + delta) / 4;
+        m_srtt = (m_srtt * 7 + rtt) / 8;
+    }
+    updateTimeout();
+}
+
+void RttEstimator::backoff()
+{
+    m_timeout = std::min(m_timeout * 2, m_max);
+}
+
+void RttEstimator::reset()
+{
+    m_srtt = microseconds::zero();
+    m_rttvar = microseconds::zero();
+    m_timeout = m_initial;
+    m_hasSamples = false;
+}
+
+milliseconds RttEstimator::timeout() const
+{
+    return m_timeout;
+}
+
+microseconds RttEstimator::smoothedRtt() const
+{
+    return m_srtt;
+}
+
+microseconds RttEstimator::rttVariance() const
+{
+    return m_rttvar;
+}
+
+bool RttEstimator::hasSamples() const
+{
+    return m_hasSamples;
+}
+
+void RttEstimator::updateTimeout()
+{
+    auto rto = duration_cast<milliseconds>(m_srtt + m_rttvar * 4) + milliseconds(1);
+    m_timeout = std::max(m_min, std::min(rto, m_max));
+}
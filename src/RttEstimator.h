@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+
+/**
+ * @brief Оценка времени ответа устройства
+ *
+ * Сглаженное время ответа и его разброс считаются так же, как RTO в TCP
+ * (RFC 6298): timeout = srtt + 4 * rttvar с ограничением снизу и сверху.
+ * При потере ответа таймаут удваивается до первого успешного замера.
+ */
+class RttEstimator
+{
+public:
+    RttEstimator(std::chrono::milliseconds initial,
+                 std::chrono::milliseconds min,
+                 std::chrono::milliseconds max);
+
+    /**
+     * @brief Этот метод учитывает очередной замер времени ответа.
+     */
+    void addSample(std::chrono::microseconds rtt);
+    /**
+     * @brief Этот метод удваивает таймаут после потери ответа.
+     */
+    void backoff();
+    /**
+     * @brief Сброс накопленной статистики (например, при смене порта)
+     */
+    void reset();
+    /**
+     * @brief Этот метод возвращает текущий таймаут ожидания ответа.
+     */
+    std::chrono::milliseconds timeout() const;
+    /**
+     * @brief Этот метод возвращает сглаженное время ответа.
+     */
+    std::chrono::microseconds smoothedRtt() const;
+    /**
+     * @brief Этот метод возвращает сглаженный разброс времени ответа.
+     */
+    std::chrono::microseconds rttVariance() const;
+    /**
+     * @brief Этот метод возвращает истину, если был хотя бы один замер.
+     */
+    bool hasSamples() const;
+
+private:
+    void updateTimeout();
+
+    std::chrono::milliseconds m_initial;
+    std::chrono::milliseconds m_min;
+    std::chrono::milliseconds m_max;
+    std::chrono::microseconds m_srtt { 0 };
+    std::chrono::microseconds m_rttvar { 0 };
+    std::chrono::milliseconds m_timeout;
+    bool m_hasSamples = false;
+};
@@ -0,0 +1,109 @@
+#include <QSerialPort>
+
+#include "SerialTransport.h"
+
+SerialTransport::SerialTransport(const QString &portName, QObject *parent)
+    : Transport(parent)
+    , m_port(new QSerialPort(portName, this))
+{
+    connect(m_port, &QSerialPort::readyRead, this, &SerialTransport::readyRead);
+    connect(m_port, &QSerialPort::bytesWritten, this, &SerialTransport::bytesWritten);
+}
+
+QString SerialTransport::address() const
+{
+    return m_port->portName();
+}
+
+bool SerialTransport::configure(qint32 baudRate)
+{
+    return configureLine(baudRate) && configureModemLines();
+}
+
+void SerialTransport::clear()
+{
+    m_port->clear();
+}
+
+qintptr SerialTransport::descriptor() const
+{
+#ifdef Q_OS_UNIX
+    return m_port->isOpen() ? m_port->handle() : -1;
+#else
+    return -1;
+#endif
+}
+
+bool SerialTransport::open(OpenMode mode)
+{
+    if (!m_port->open(mode)) {
+        setErrorString(m_port->errorString());
+        return false;
+    }
+    // Буферизацию выполняет QSerialPort, второй буфер не нужен
+    return Transport::open(mode | Unbuffered);
+}
+
+void SerialTransport::close()
+{
+    Transport::close();
+    m_port->close();
+}
+
+qint64 SerialTransport::bytesAvailable() const
+{
+    return m_port->bytesAvailable() + Transport::bytesAvailable();
+}
+
+qint64 SerialTransport::bytesToWrite() const
+{
+    return m_port->bytesToWrite();
+}
+
+bool SerialTransport::waitForReadyRead(int msecs)
+{
+    return m_port->waitForReadyRead(msecs);
+}
+
+bool SerialTransport::waitForBytesWritten(int msecs)
+{
+    return m_port->waitForBytesWritten(msecs);
+}
+
+qint64 SerialTransport::readData(char *data, qint64 maxSize)
+{
+    return m_port->read(data, maxSize);
+}
+
+qint64 SerialTransport::writeData(const char *data, qint64 maxSize)
+{
+    return m_port->write(data, maxSize);
+}
+
+bool SerialTransport::configureLine(qint32 baudRate)
+{
+    return m_port->setBaudRate(baudRate)
+        && m_port->setDataBits(QSerialPort::Data8)
+        && m_port->setFlowControl(QSerialPort::NoFlowControl)
+        && m_port->setParity(QSerialPort::NoParity);
+}
+
+bool SerialTransport::configureModemLines()
+{
+    return m_port->setRequestToSend(true)
+        && m_port->setDataTerminalReady(true);
+}
+
+QString PtyTransport::address() const
+{
+    return "pty:" + SerialTransport::address();
+}
+
+bool PtyTransport::configure(qint32 baudRate)
+{
+    if (!configureLine(baudRate)) {
+        return false;
+    }
+    configureModemLines();
+    return true;
+}
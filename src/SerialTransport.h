@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Transport.h"
+
+class QSerialPort;
+
+/**
+ * @brief Локальный последовательный порт
+ */
+class SerialTransport : public Transport
+{
+    Q_OBJECT
+
+public:
+    SerialTransport(const QString &portName, QObject *parent = nullptr);
+
+    QString address() const override;
+    bool configure(qint32 baudRate) override;
+    void clear() override;
+    qintptr descriptor() const override;
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    qint64 bytesAvailable() const override;
+    qint64 bytesToWrite() const override;
+    bool waitForReadyRead(int msecs) override;
+    bool waitForBytesWritten(int msecs) override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+    bool configureLine(qint32 baudRate);
+    bool configureModemLines();
+
+    QSerialPort *m_port;
+};
+
+/**
+ * @brief Псевдотерминал
+ *
+ * Настраивается как последовательный порт, но не имеет линий RTS и DTR,
+ * поэтому ошибка их установки не считается ошибкой настройки.
+ */
+class PtyTransport : public SerialTransport
+{
+    Q_OBJECT
+
+public:
+    using SerialTransport::SerialTransport;
+
+    QString address() const override;
+    bool configure(qint32 baudRate) override;
+};
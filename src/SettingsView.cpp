@@ -5,35 +5,24 @@
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QProgressDialog>
-#include <QTimer>
 
 #include "ChannelTable.h"
-#include "EventLog.h"
+#include "DeviceController.h"
 #include "Firmware.h"
 #include "ModuleViews.h"
 #include "Modules.h"
-#include "NameRepository.h"
 #include "SettingsView.h"
 #include "Transactions.h"
-#include "TransactionInvoker.h"
 #include "SettingsSerializers.h"
 #include "ui_SettingsView.h"
 
-SettingsView::SettingsView(const SettingsViewBuilder &builder)
-    : m_device(builder.moduleFabric, builder.type)
+SettingsView::SettingsView(const SettingsViewBuilder &builder, DeviceController *controller)
+    : m_controller(controller)
+    , m_device(controller->device())
     , m_moduleViewFabric(builder.moduleViewFabric)
-    , m_transactionFabric(builder.transactionFabric)
-    , m_nameRepo(builder.nameRepo)
-    , m_invoker(builder.invoker)
     , m_settingsSerializer(builder.settingsSerializer)
     , ui(std::make_unique<Ui::SettingsView>())
-    , m_log(new EventLog(m_device, this))
-    , m_updateTimer(new QTimer(this))
 {
-    m_updateTimer->setInterval(800);
-    m_updateTimer->setSingleShot(true);
-    connect(m_updateTimer, &QTimer::timeout, this, &SettingsView::updateModel);
-
     // UI setup
     ui->setupUi(this);
     setInterfaceEnabled(false);
@@ -43,12 +32,22 @@ SettingsView::SettingsView(const SettingsViewBuilder &builder)
     ui->configTable->verticalHeader()->setSectionResizeMode(QHeaderView::Stretch);
 
     // Настраиваем вид в зависимости от типа устройства
-    bool show = builder.type == DeviceType::MDM500M;
+    bool show = !m_device.isMDM500();
     model->showSignalLevelColumn(show);
     ui->deviceSoftwareVersionLabel->setVisible(show);
     ui->softVerWrapper->setVisible(show);
 
-    initModel();
+    connect(m_controller, &DeviceController::ready, this, [=]
+    {
+        setInterfaceEnabled(true);
+        updateMainInfo();
+    });
+    connect(m_controller, &DeviceController::wrongParametersDetected,
+            this, &SettingsView::onWrongParametersDetected);
+    if (m_controller->isReady()) {
+        setInterfaceEnabled(true);
+        updateMainInfo();
+    }
 }
 
 QString SettingsView::type() const
@@ -67,7 +66,7 @@ void SettingsView::mousePressEvent(QMouseEvent *event)
 
 Device *SettingsView::device() const
 {
-    return const_cast<Device *>(&m_device);
+    return &m_device;
 }
 
 void SettingsView::setInterfaceEnabled(bool enabled)
@@ -113,70 +112,11 @@ void SettingsView::onDeviceCorruptionDetected()
                    "пользователя данной программы."));
 }
 
-void SettingsView::initModel()
-{
-    using Interfaces::GetAllDeviceInfo;
-
-    qDebug("начата инициализация модели");
-    auto transaction = m_transactionFabric->getAllDeviceInfo();
-    connect(transaction, &GetAllDeviceInfo::success, this, [=](auto &&response)
-    {
-        qDebug("инициализация модели завершена");
-
-        // Заполняем модель данными
-        m_device.setInfo(response.info);
-        m_device.setName(m_nameRepo->getName(m_device.type(), m_device.serialNumber()));
-        m_device.setConfig(response.config);
-        m_device.setThresholdLevels(response.thresholdLevels);
-        m_device.setSignalLevels(response.signalLevels);
-
-        // Обновляем интерфейс пользователя
-        m_log->initialMessage(response.log);
-        setInterfaceEnabled(true);
-        updateMainInfo();
-
-        // Запускаем цикл обновления данных
-        m_updateTimer->start();
-    });
-    connect(transaction, &GetAllDeviceInfo::failure, this, [=]
-    {
-        qDebug("произошло отключение во время инициализации модели");
-
-        emit disconnected();
-    });
-    m_invoker->exec(transaction);
-}
-
-void SettingsView::updateModel()
-{
-    using Interfaces::UpdateDeviceInfo;
-
-    qDebug("начато обновление модели");
-    auto transaction = m_transactionFabric->updateDeviceInfo();
-    connect(transaction, &UpdateDeviceInfo::success, this, [=](auto &&response)
-    {
-        qDebug("обновление завершено");
-        // Обновляем модель
-        m_device.setErrors(response.errors);
-        m_device.setSignalLevels(response.signalLevels);
-        m_device.setModuleStates(response.states);
-
-        // Запускаем таймер по новой
-        m_updateTimer->start();
-    });
-    connect(transaction, &UpdateDeviceInfo::failure, this, [=]
-    {
-        qDebug("произошло отключение во время обновления модели");
-        emit disconnected();
-    });
-    m_invoker->exec(transaction);
-}
-
 void SettingsView::updateFirmware(const Firmware &firmware)
 {
     using Interfaces::UpdateFirmware;
 
-    auto transaction = m_transactionFabric->updateFirmware(firmware);
+    auto transaction = m_controller->updateFirmware(firmware);
     auto dialog = new QProgressDialog(
                 this,
                 Qt::Window | Qt::WindowTitleHint); // Убераем кноки из заголовка
@@ -197,12 +137,17 @@ void SettingsView::updateFirmware(const Firmware &firmware)
                                  tr("Обновление программного обеспечения"),
                                  tr("Программное обеспечение устройства "
                                     "успешно обновлено."));
-        initModel();
     });
-    connect(transaction, &UpdateFirmware::failure, this, [=]
+    connect(transaction, &UpdateFirmware::failure, dialog, &QObject::deleteLater);
+    // Контроллер перечитывает устройство, даже если представление уже закрыто
+    auto controller = m_controller;
+    connect(transaction, &UpdateFirmware::success, controller, [=]
     {
-        dialog->deleteLater();
-        initModel();
+        controller->initModel();
+    });
+    connect(transaction, &UpdateFirmware::failure, controller, [=]
+    {
+        controller->initModel();
     });
     connect(transaction, &UpdateFirmware::error, this, [=](auto whileDoing)
     {
@@ -254,72 +199,8 @@ void SettingsView::updateFirmware(const Firmware &firmware)
     connect(transaction, &UpdateFirmware::progressMaxChanged, dialog, &QProgressDialog::setMaximum);
 
     // Останавливаем цикл обновлений модели
-    if (m_updateTimer->isActive()) {
-        m_updateTimer->stop();
-    }
-    m_invoker->exec(transaction);
-}
-
-void SettingsView::setControlModule(int slot)
-{
-    using Interfaces::SetControlModule;
-
-    qDebug("запрошено переключение контрольного канала");
-    auto transaction = m_transactionFabric->setControlModule(slot);
-    m_device.setControlModule(slot);
-    connect(transaction, &SetControlModule::success, this, [=]
-    {
-        qDebug("контрольный канал переключён");
-    });
-    connect(transaction, &SetControlModule::failure, this, [=]
-    {
-        qDebug("произошло отключение во время переключения контрольного канала");
-        emit disconnected();
-    });
-    m_invoker->exec(transaction);
-}
-
-void SettingsView::setModuleConfig(int slot)
-{
-    using Interfaces::SetModuleConfig;
-
-    qDebug("запрошено сохранение новых настроек модуля");
-    auto config = m_device.data().config.modules[slot];
-    auto transaction = m_transactionFabric->setModuleConfig(slot, config);
-    connect(transaction, &SetModuleConfig::success, this, [=]
-    {
-        qDebug("параметры модуля применены");
-    });
-    connect(transaction, &SetModuleConfig::wrongParametersDetected, this, [=]
-    {
-        qDebug("устройство сообщило о неверных значениях параметров (1)");
-        onWrongParametersDetected();
-    });
-    connect(transaction, &SetModuleConfig::failure, this, [=]
-    {
-        qDebug("произошло отключение во время применения параметров модуля");
-        emit disconnected();
-    });
-    m_invoker->exec(transaction);
-}
-
-void SettingsView::setThresholdLevels()
-{
-    using Interfaces::SetThresholdLevels;
-
-    qDebug("запрошено сохранение пороговых уровней");
-    auto lvls = m_device.data().thresholdLevels;
-    auto transaction = m_transactionFabric->setThresholdLevels(lvls);
-    connect(transaction, &SetThresholdLevels::success, this, [=]
-    {
-        qDebug("пороговые уровни установлены");
-    });
-    connect(transaction, &SetThresholdLevels::failure, this, [=]
-    {
-        qDebug("произошло отключение во время применения пороговых уровней");
-        emit disconnected();
-    });
-    m_invoker->exec(transaction);
+    m_controller->suspendPolling();
+    m_controller->exec(transaction);
 }
 
 void SettingsView::on_saveChangesBtn_clicked()
@@ -328,7 +209,7 @@ void SettingsView::on_saveChangesBtn_clicked()
 
     qDebug("запрошено сохранение параметров в постоянную память");
     ui->saveChangesBtn->setEnabled(false);
-    auto transaction = m_transactionFabric->saveConfigToEprom(m_device.data().config);
+    auto transaction = m_controller->transactions().saveConfigToEprom(m_device.data().config);
     connect(transaction, &SaveConfigToEprom::success, this, [=]
     {
         qDebug("параметры сохранены в постоянную память");
@@ -349,9 +230,9 @@ void SettingsView::on_saveChangesBtn_clicked()
     connect(transaction, &SaveConfigToEprom::failure, this, [=]
     {
         qDebug("произошло отключение во время сохранения параметров в постоянную память");
-        emit disconnected();
+        m_controller->markDisconnected();
     });
-    m_invoker->exec(transaction);
+    m_controller->exec(transaction);
 }
 
 void SettingsView::on_updateFirmwareBtn_clicked()
@@ -501,11 +382,11 @@ void SettingsView::on_configTable_clicked(const QModelIndex &index)
     if (!m_device.isMDM500()) {
         connect(page, &ModuleView::thresholdLevelChanged, this, [=]
         {
-            setThresholdLevels();
+            m_controller->setThresholdLevels();
         });
         connect(page, &ModuleView::settingsChanged, this, [=]
         {
-            setModuleConfig(slot);
+            m_controller->setModuleConfig(slot);
         });
     }
     ui->stackedWidget->addWidget(page);
@@ -514,9 +395,7 @@ void SettingsView::on_configTable_clicked(const QModelIndex &index)
 
 void SettingsView::on_name_editingFinished()
 {
-    auto name = ui->name->text();
-    m_device.setName(name);
-    m_nameRepo->setName(m_device.type(), m_device.serialNumber(), name);
+    m_controller->setName(ui->name->text());
 }
 
 ConfigViewModel::ConfigViewModel(Device &device, QObject *parent)
@@ -525,6 +404,10 @@ ConfigViewModel::ConfigViewModel(Device &device, QObject *parent)
 {
     connect(&m_device, &Device::moduleReplaced,
             this, &ConfigViewModel::onModuleReplaced);
+    // Представление может создаваться для уже прочитанного устройства
+    for (int slot = 0; slot < m_device.moduleCount(); ++slot) {
+        onModuleReplaced(m_device.module(slot));
+    }
 }
 
 int ConfigViewModel::rowCount(const QModelIndex &parent) const
@@ -697,7 +580,7 @@ void ConfigViewModel::onModuleReplaced(Module *module)
                      QVector<int>() << Qt::BackgroundRole);
 }
 
-SettingsView *SettingsViewBuilder::build() const
+SettingsView *SettingsViewBuilder::build(DeviceController *controller) const
 {
-    return new SettingsView(*this);
+    return new SettingsView(*this, controller);
 }
@@ -7,17 +7,14 @@
 
 #include "Device.h"
 
-class EventLog;
+class DeviceController;
 class Firmware;
 class ModuleView;
-class NameRepository;
 class SettingsView;
-class TransactionInvoker;
 
 namespace Interfaces {
 
 class SettingsSerializer;
-class TransactionFabric;
 
 class ModuleViewFabric
 {
@@ -34,31 +31,29 @@ class SettingsView;
 
 struct SettingsViewBuilder
 {
-    std::shared_ptr<TransactionInvoker> invoker;
     std::shared_ptr<Interfaces::SettingsSerializer> settingsSerializer;
-    std::shared_ptr<Interfaces::ModuleFabric> moduleFabric;
     std::shared_ptr<Interfaces::ModuleViewFabric> moduleViewFabric;
-    std::shared_ptr<Interfaces::TransactionFabric> transactionFabric;
-    std::shared_ptr<NameRepository> nameRepo;
-    DeviceType type;
 
-    SettingsView *build() const;
+    SettingsView *build(DeviceController *controller) const;
 };
 
+/**
+ * @brief Представление настроек одного устройства
+ *
+ * Модель и опрос принадлежат DeviceController и живут дольше
+ * представления, поэтому оно может создаваться только для выбранного
+ * устройства.
+ */
 class SettingsView : public QWidget
 {
     Q_OBJECT
     Q_PROPERTY(QString type READ type CONSTANT)
 
 public:
-    SettingsView(const SettingsViewBuilder &builder);
+    SettingsView(const SettingsViewBuilder &builder, DeviceController *controller);
 
     QString type() const;
     Device *device() const;
-    void setControlModule(int slot);
-
-signals:
-    void disconnected();
 
 protected:
     void mousePressEvent(QMouseEvent *event) override;
@@ -72,25 +67,17 @@ private slots:
     void on_name_editingFinished();
 
 private:
-    void initModel();
-    void updateModel();
     void updateFirmware(const Firmware &firmware);
-    void setThresholdLevels();
-    void setModuleConfig(int slot);
     void setInterfaceEnabled(bool enabled);
     void updateMainInfo();
     void onWrongParametersDetected();
     void onDeviceCorruptionDetected();
 
-    Device m_device;
+    DeviceController *m_controller;
+    Device &m_device;
     std::shared_ptr<Interfaces::ModuleViewFabric> m_moduleViewFabric;
-    std::shared_ptr<Interfaces::TransactionFabric> m_transactionFabric;
-    std::shared_ptr<NameRepository> m_nameRepo;
-    std::shared_ptr<TransactionInvoker> m_invoker;
     std::shared_ptr<Interfaces::SettingsSerializer> m_settingsSerializer;
     std::unique_ptr<Ui::SettingsView> ui;
-    EventLog *m_log;
-    QTimer *m_updateTimer;
 };
 
 class ConfigViewModel : public QAbstractTableModel
@@ -0,0 +1,271 @@
+#include <QDeadlineTimer>
+#include <QTcpSocket>
+
+#include "TcpTransport.h"
+
+namespace {
+
+// Команды Telnet (RFC 854)
+constexpr uint8_t kIac  = 255;
+constexpr uint8_t kDont = 254;
+constexpr uint8_t kDo   = 253;
+constexpr uint8_t kWont = 252;
+constexpr uint8_t kWill = 251;
+constexpr uint8_t kSb   = 250;
+constexpr uint8_t kSe   = 240;
+
+// Опции Telnet
+constexpr uint8_t kBinary            = 0;
+constexpr uint8_t kSuppressGoAhead   = 3;
+constexpr uint8_t kComPortOption     = 44;
+
+// Команды COM-PORT-OPTION (RFC 2217) и их значения
+constexpr uint8_t kSetBaudRate       = 1;
+constexpr uint8_t kSetDataSize       = 2;
+constexpr uint8_t kSetParity         = 3;
+constexpr uint8_t kSetStopSize       = 4;
+constexpr uint8_t kSetControl        = 5;
+constexpr uint8_t kPurgeData         = 12;
+
+constexpr uint8_t kParityNone        = 1;
+constexpr uint8_t kStopSizeOne       = 1;
+constexpr uint8_t kNoFlowControl     = 1;
+constexpr uint8_t kDtrOn             = 8;
+constexpr uint8_t kRtsOn             = 11;
+constexpr uint8_t kPurgeBoth         = 3;
+
+QByteArray escape(const char *data, qint64 size)
+{
+    QByteArray escaped;
+    escaped.reserve(static_cast<int>(size));
+    for (qint64 i = 0; i < size; ++i) {
+        escaped.append(data[i]);
+        if (static_cast<uint8_t>(data[i]) == kIac) {
+            escaped.append(static_cast<char>(kIac));
+        }
+    }
+    return escaped;
+}
+
+} // namespace
+
+TcpTransport::TcpTransport(const QString &host, quint16 port, Mode mode, QObject *parent)
+    : Transport(parent)
+    , m_socket(new QTcpSocket(this))
+    , m_host(host)
+    , m_port(port)
+    , m_mode(mode)
+{
+    connect(m_socket, &QTcpSocket::readyRead, this, &TcpTransport::onSocketReadyRead);
+    connect(m_socket, &QTcpSocket::bytesWritten, this, &TcpTransport::bytesWritten);
+}
+
+QString TcpTransport::address() const
+{
+    return QString("%1://%2:%3")
+            .arg(m_mode == Mode::Raw ? "tcp" : "rfc2217")
+            .arg(m_host)
+            .arg(m_port);
+}
+
+bool TcpTransport::configure(qint32 baudRate)
+{
+    if (m_mode == Mode::Raw) {
+        return true;
+    }
+    QByteArray baud(4, 0);
+    baud[0] = static_cast<char>((baudRate >> 24) & 0xFF);
+    baud[1] = static_cast<char>((baudRate >> 16) & 0xFF);
+    baud[2] = static_cast<char>((baudRate >> 8) & 0xFF);
+    baud[3] = static_cast<char>(baudRate & 0xFF);
+    sendComPortCommand(kSetBaudRate, baud);
+    sendComPortCommand(kSetDataSize, QByteArray(1, 8));
+    sendComPortCommand(kSetParity, QByteArray(1, kParityNone));
+    sendComPortCommand(kSetStopSize, QByteArray(1, kStopSizeOne));
+    sendComPortCommand(kSetControl, QByteArray(1, kNoFlowControl));
+    sendComPortCommand(kSetControl, QByteArray(1, kDtrOn));
+    sendComPortCommand(kSetControl, QByteArray(1, kRtsOn));
+    return m_socket->state() == QTcpSocket::ConnectedState;
+}
+
+void TcpTransport::clear()
+{
+    receive();
+    m_input.clear();
+    if (m_mode == Mode::Rfc2217) {
+        sendComPortCommand(kPurgeData, QByteArray(1, kPurgeBoth));
+    }
+}
+
+qintptr TcpTransport::descriptor() const
+{
+    return m_socket->socketDescriptor();
+}
+
+bool TcpTransport::open(OpenMode mode)
+{
+    m_socket->connectToHost(m_host, m_port);
+    if (!m_socket->waitForConnected(kConnectTimeout)) {
+        setErrorString(m_socket->errorString());
+        m_socket->abort();
+        return false;
+    }
+    m_input.clear();
+    m_state = TelnetState::Data;
+    if (m_mode == Mode::Rfc2217) {
+        sendCommand(kWill, kComPortOption);
+        sendCommand(kWill, kBinary);
+        sendCommand(kDo, kBinary);
+        sendCommand(kDo, kSuppressGoAhead);
+    }
+    return Transport::open(mode | Unbuffered);
+}
+
+void TcpTransport::close()
+{
+    Transport::close();
+    m_socket->disconnectFromHost();
+    m_socket->abort();
+}
+
+qint64 TcpTransport::bytesAvailable() const
+{
+    return m_input.size() + Transport::bytesAvailable();
+}
+
+qint64 TcpTransport::bytesToWrite() const
+{
+    return m_socket->bytesToWrite();
+}
+
+bool TcpTransport::waitForReadyRead(int msecs)
+{
+    QDeadlineTimer timer(msecs);
+    while (m_input.isEmpty()) {
+        // Пакет может содержать только команды Telnet
+        if (!m_socket->waitForReadyRead(static_cast<int>(timer.remainingTime()))) {
+            return false;
+        }
+        receive();
+    }
+    return true;
+}
+
+bool TcpTransport::waitForBytesWritten(int msecs)
+{
+    return m_socket->waitForBytesWritten(msecs);
+}
+
+qint64 TcpTransport::readData(char *data, qint64 maxSize)
+{
+    receive();
+    int size = static_cast<int>(std::min<qint64>(maxSize, m_input.size()));
+    memcpy(data, m_input.constData(), static_cast<size_t>(size));
+    m_input.remove(0, size);
+    return size;
+}
+
+qint64 TcpTransport::writeData(const char *data, qint64 maxSize)
+{
+    if (m_mode == Mode::Raw) {
+        return m_socket->write(data, maxSize);
+    }
+    if (m_socket->write(escape(data, maxSize)) < 0) {
+        return -1;
+    }
+    return maxSize;
+}
+
+void TcpTransport::onSocketReadyRead()
+{
+    if (receive()) {
+        emit readyRead();
+    }
+}
+
+bool TcpTransport::receive()
+{
+    int before = m_input.size();
+    auto raw = m_socket->readAll();
+    if (m_mode == Mode::Raw) {
+        m_input.append(raw);
+    } else {
+        decode(raw);
+    }
+    return m_input.size() > before;
+}
+
+void TcpTransport::decode(const QByteArray &raw)
+{
+    for (char ch : raw) {
+        auto byte = static_cast<uint8_t>(ch);
+        switch (m_state) {
+        case TelnetState::Data:
+            if (byte == kIac) {
+                m_state = TelnetState::Iac;
+            } else {
+                m_input.append(ch);
+            }
+            break;
+        case TelnetState::Iac:
+            if (byte == kIac) {
+                m_input.append(ch);
+                m_state = TelnetState::Data;
+            } else if (byte == kSb) {
+                m_state = TelnetState::Subnegotiation;
+            } else if (byte >= kWill && byte <= kDont) {
+                m_command = byte;
+                m_state = TelnetState::Option;
+            } else {
+                m_state = TelnetState::Data;
+            }
+            break;
+        case TelnetState::Option:
+            negotiate(m_command, byte);
+            m_state = TelnetState::Data;
+            break;
+        case TelnetState::Subnegotiation:
+            // Ответы сервера на команды COM-PORT-OPTION не используются
+            if (byte == kIac) {
+                m_state = TelnetState::SubnegotiationIac;
+            }
+            break;
+        case TelnetState::SubnegotiationIac:
+            m_state = byte == kSe ? TelnetState::Data : TelnetState::Subnegotiation;
+            break;
+        }
+    }
+}
+
+void TcpTransport::negotiate(uint8_t command, uint8_t option)
+{
+    // Согласие на запрошенные нами опции подтверждения не требует,
+    // от остальных отказываемся
+    if (command == kDo && option != kComPortOption && option != kBinary) {
+        sendCommand(kWont, option);
+    }
+    if (command == kWill && option != kBinary && option != kSuppressGoAhead) {
+        sendCommand(kDont, option);
+    }
+}
+
+void TcpTransport::sendCommand(uint8_t command, uint8_t option)
+{
+    const char packet[] = {
+        static_cast<char>(kIac), static_cast<char>(command), static_cast<char>(option)
+    };
+    m_socket->write(packet, sizeof(packet));
+}
+
+void TcpTransport::sendComPortCommand(uint8_t command, const QByteArray &value)
+{
+    QByteArray packet;
+    packet.append(static_cast<char>(kIac));
+    packet.append(static_cast<char>(kSb));
+    packet.append(static_cast<char>(kComPortOption));
+    packet.append(static_cast<char>(command));
+    packet.append(escape(value.constData(), value.size()));
+    packet.append(static_cast<char>(kIac));
+    packet.append(static_cast<char>(kSe));
+    m_socket->write(packet);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QByteArray>
+
+#include "Transport.h"
+
+class QTcpSocket;
+
+/**
+ * @brief Сервер последовательных портов, доступный по TCP
+ *
+ * В режиме Raw байты передаются без изменений, а скорость линии задается
+ * в настройках сервера. В режиме Rfc2217 поток идет по протоколу Telnet:
+ * байт 0xFF удваивается, а скорость, формат кадра и линии RTS/DTR
+ * устанавливаются командами COM-PORT-OPTION (RFC 2217).
+ */
+class TcpTransport : public Transport
+{
+    Q_OBJECT
+
+public:
+    enum class Mode
+    {
+        Raw,
+        Rfc2217
+    };
+
+    TcpTransport(const QString &host, quint16 port, Mode mode, QObject *parent = nullptr);
+
+    QString address() const override;
+    bool configure(qint32 baudRate) override;
+    void clear() override;
+    qintptr descriptor() const override;
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    qint64 bytesAvailable() const override;
+    qint64 bytesToWrite() const override;
+    bool waitForReadyRead(int msecs) override;
+    bool waitForBytesWritten(int msecs) override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    enum class TelnetState { Data, Iac, Option, Subnegotiation, SubnegotiationIac };
+
+    static constexpr int kConnectTimeout = 3000;
+
+    void onSocketReadyRead();
+    bool receive();
+    void decode(const QByteArray &raw);
+    void negotiate(uint8_t command, uint8_t option);
+    void sendCommand(uint8_t command, uint8_t option);
+    void sendComPortCommand(uint8_t command, const QByteArray &value);
+
+    QTcpSocket *m_socket;
+    QString m_host;
+    quint16 m_port;
+    Mode m_mode;
+    QByteArray m_input;        /**< Принятые данные без команд Telnet */
+    TelnetState m_state = TelnetState::Data;
+    uint8_t m_command = 0;
+};
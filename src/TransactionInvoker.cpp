@@ -1,72 +1,50 @@
 #include <QThread>
 
+#include "LinkReactor.h"
+#include "LinkSession.h"
 #include "Transactions.h"
 #include "TransactionInvoker.h"
 
-TransactionInvoker::TransactionInvoker()
+TransactionInvoker::TransactionInvoker(std::shared_ptr<LinkReactor> reactor)
+    : m_reactor(std::move(reactor))
 {
-    m_exit = false;
-    m_thread = QThread::create([this] { loop(); });
-    m_thread->start();
+    // Порт должен принадлежать потоку, в котором он обслуживается
+    m_reactor->run([this] {
+        m_session = new LinkSession(m_cancellationSource.token());
+    });
 }
 
 TransactionInvoker::~TransactionInvoker()
 {
-    m_exit.store(true, std::memory_order_release);
     m_cancellationSource.cancel();
-    m_cv.notify_all();
-    m_thread->wait();
-    clear();
+    auto session = m_session;
+    m_reactor->run([session] {
+        delete session;
+    });
 }
 
 void TransactionInvoker::exec(Interfaces::Transaction *transaction)
 {
     if (!transaction) return;
-    std::unique_lock<std::mutex> lock(m_mutex);
-    transaction->moveToThread(m_thread);
-    m_queue.push(transaction);
-    m_cv.notify_all();
+    transaction->moveToThread(m_reactor->thread());
+    auto session = m_session;
+    QMetaObject::invokeMethod(session, [session, transaction] {
+        session->enqueue(transaction);
+    }, Qt::QueuedConnection);
 }
 
-void TransactionInvoker::clear()
+void TransactionInvoker::cancel(Interfaces::Transaction *transaction)
 {
-    std::unique_lock<std::mutex> lock(m_mutex);
-    while (!m_queue.empty()) {
-        delete m_queue.front();
-        m_queue.pop();
-    }
+    auto session = m_session;
+    QMetaObject::invokeMethod(session, [session, transaction] {
+        session->cancel(transaction);
+    }, Qt::QueuedConnection);
 }
 
-std::unique_ptr<Interfaces::Transaction> TransactionInvoker::nextTransaction()
-{
-    if (m_exit.load(std::memory_order_acquire)) {
-        return nullptr;
-    }
-    std::unique_lock<std::mutex> lock(m_mutex);
-    if (m_queue.empty()) {
-        m_cv.wait(lock, [this] {
-            return m_exit.load(std::memory_order_acquire) || !m_queue.empty();
-        });
-        if (m_exit.load(std::memory_order_acquire)) {
-            return nullptr;
-        }
-    }
-    auto cmd = m_queue.front();
-    m_queue.pop();
-    return std::unique_ptr<Interfaces::Transaction>(cmd);
-}
-
-void TransactionInvoker::loop()
+void TransactionInvoker::clear()
 {
-    QSerialPort port;
-    while (auto cmd = nextTransaction()) {
-        try {
-            cmd->exec(port, m_cancellationSource.token());
-        }
-        catch (CancelledException &) {
-        }
-        catch (...) {
-            std::terminate();
-        }
-    }
+    auto session = m_session;
+    QMetaObject::invokeMethod(session, [session] {
+        session->clear();
+    }, Qt::QueuedConnection);
 }
@@ -1,35 +1,39 @@
 #pragma once
 
-#include <atomic>
-#include <condition_variable>
-#include <mutex>
-#include <queue>
-
-#include <QSerialPort>
+#include <memory>
 
 #include "Cancelation.h"
 
+class LinkReactor;
+class LinkSession;
+
 namespace Interfaces {
 class Transaction;
 } // namespace Interfaces
 
+/**
+ * @brief Исполнитель транзакций одного устройства
+ *
+ * Транзакции выполняются по очереди в общем для всех устройств потоке
+ * LinkReactor.
+ */
 class TransactionInvoker
 {
 public:
-
-    TransactionInvoker();
+    TransactionInvoker(std::shared_ptr<LinkReactor> reactor);
     ~TransactionInvoker();
     void exec(Interfaces::Transaction *transaction);
+    /**
+     * @brief Отменить одну транзакцию, переданную в exec()
+     *
+     * Отменяются только транзакции этого устройства; транзакция излучит
+     * abandoned(), если еще не завершилась.
+     */
+    void cancel(Interfaces::Transaction *transaction);
     void clear();
 
 private:
-    std::unique_ptr<Interfaces::Transaction> nextTransaction();
-    void loop();
-
-    std::atomic_bool m_exit;
-    std::mutex m_mutex;
-    std::condition_variable m_cv;
-    std::queue<Interfaces::Transaction *> m_queue;
+    std::shared_ptr<LinkReactor> m_reactor;
     CancellationSource m_cancellationSource;
-    QThread *m_thread;
+    LinkSession *m_session = nullptr;
 };
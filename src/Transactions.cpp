@@ -1,63 +1,146 @@
-#include <QSerialPortInfo>
+#include <cstring>
+
+#include <QElapsedTimer>
 #include <QThread>
 
+#include "AsyncProtocol.h"
+#include "BootFrames.h"
+#include "InterruptibleWait.h"
+#include "Link.h"
 #include "Transactions.h"
 #include "Protocol.h"
 #include "Firmware.h"
 #include "UpdaterProtocol.h"
 
+// Отмена проверяется первой: ответ мог не прийти именно из-за нее
 #define CHECK(received)        \
     do {                       \
+        if (cancelled) {       \
+            emit abandoned();  \
+            emit finished();   \
+            return;            \
+        }                      \
         if (!(received)) {     \
             emit failure();    \
+            emit finished();   \
             return;            \
         }                      \
-        if (cancelled) return; \
     } while(false)
 
-SearchDevice::SearchDevice()
+namespace Interfaces {
+
+void Transaction::exec(Link &, CancelToken)
+{
+    // LinkSession вызывает exec() только если start() вернул ложь, а такие
+    // транзакции переопределяют оба метода
+    Q_ASSERT(false);
+    emit failure();
+}
+
+bool Transaction::start(AsyncProtocol &, CancelToken)
+{
+    return false;
+}
+
+Transaction::Priority Transaction::priority() const
+{
+    return Priority::Poll;
+}
+
+bool Transaction::supersedes(const Transaction &) const
+{
+    return false;
+}
+
+void Transaction::setDeadline(CancelToken::Clock::time_point deadline)
+{
+    m_deadline = deadline;
+}
+
+CancelToken::Clock::time_point Transaction::deadline() const
+{
+    return m_deadline;
+}
+
+Transaction::Priority GetAllDeviceInfo::priority() const
+{
+    return Priority::InitialLoad;
+}
+
+Transaction::Priority UpdateDeviceInfo::priority() const
+{
+    return Priority::Poll;
+}
+
+Transaction::Priority SetControlModule::priority() const
+{
+    return Priority::Interactive;
+}
+
+Transaction::Priority SetModuleConfig::priority() const
+{
+    return Priority::Interactive;
+}
+
+Transaction::Priority SetThresholdLevels::priority() const
+{
+    return Priority::Interactive;
+}
+
+Transaction::Priority SaveConfigToEprom::priority() const
+{
+    return Priority::Interactive;
+}
+
+Transaction::Priority UpdateFirmware::priority() const
+{
+    return Priority::Firmware;
+}
+
+} // namespace Interfaces
+
+constexpr std::chrono::milliseconds SearchDevice::kProbeTimeout;
+
+SearchDevice::SearchDevice(QString address)
+    : m_address(std::move(address))
 {
     qRegisterMetaType<SearchDevice::DeviceType>();
 }
 
-void SearchDevice::exec(QSerialPort &port, CancelToken cancelled)
+SearchDevice::Priority SearchDevice::priority() const
 {
-    while (!cancelled) {
-        for (auto &&info : QSerialPortInfo::availablePorts()) {
-            if (cancelled) {
-                return ;
-            }
-            port.setPort(info);
-            if (port.open(QIODevice::ReadWrite)) {
-                port.clear();
-                if (tryGetDeviceInfo(port)) {
-                    return ;
-                }
-                port.close();
-            }
+    return Priority::InitialLoad;
+}
+
+void SearchDevice::exec(Link &link, CancelToken cancelled)
+{
+    if (cancelled) {
+        return ;
+    }
+    auto transport = Transport::create(m_address);
+    if (transport && transport->open(QIODevice::ReadWrite)) {
+        transport->clear();
+        link.setTransport(std::move(transport));
+        link.reset();
+        if (tryGetDeviceInfo(link)) {
+            return ;
         }
-        QThread::sleep(1);
+        link.transport().close();
+    }
+    if (!cancelled) {
+        emit failure();
     }
 }
 
-bool SearchDevice::tryGetDeviceInfo(QSerialPort &port)
+bool SearchDevice::tryGetDeviceInfo(Link &link)
 {
-    using namespace std::chrono_literals;
-
-    Protocol proto(port);
+    Protocol proto(link);
     if (!proto.configure()) {
         return false;
     }
 
     struct Reader
     {
-        bool isDataEnough(int size) const
-        {
-            constexpr int min = std::min<int>(sizeof(MDM500::DeviceInfo),
-                                              sizeof(MDM500M::DeviceInfo));
-            return size >= min;
-        }
-
         bool checkPackage(Protocol::Command cmd, const void *data, int size)
         {
             if (cmd != Protocol::Command::ReadInfo) {
@@ -78,7 +161,7 @@ bool SearchDevice::tryGetDeviceInfo(QSerialPort &port)
         DeviceType type;
     } reader;
 
-    bool received = proto.get(Protocol::Command::ReadInfo, reader, 1s, Protocol::ReaderTag());
+    bool received = proto.get(Protocol::Command::ReadInfo, reader, kProbeTimeout, Protocol::ReaderTag());
     if (received) {
         emit found(reader.type);
     }
@@ -87,55 +170,131 @@ bool SearchDevice::tryGetDeviceInfo(QSerialPort &port)
 
 namespace MDM500M {
 
-GetAllDeviceInfo::GetAllDeviceInfo()
+GetAllDeviceInfo::GetAllDeviceInfo(const DeviceCache::Entry *cached)
 {
     qRegisterMetaType<Interfaces::GetAllDeviceInfo::Response>();
+    if (cached
+            && cached->info.size() == sizeof(m_cachedInfo)
+            && cached->thresholdLevels.size() == sizeof(m_cachedThresholdLevels)) {
+        memcpy(&m_cachedInfo, cached->info.constData(), sizeof(m_cachedInfo));
+        memcpy(&m_cachedThresholdLevels, cached->thresholdLevels.constData(), sizeof(m_cachedThresholdLevels));
+        m_hasCache = true;
+    }
 }
 
-void GetAllDeviceInfo::exec(QSerialPort &port, CancelToken cancelled)
+bool GetAllDeviceInfo::start(AsyncProtocol &proto, CancelToken cancelled)
 {
-    Response response;
-    ErrorsPackage errors;
-    Protocol proto(port);
+    if (m_hasCache) {
+        return startCached(proto, cancelled);
+    }
+    proto.submit({
+        AsyncProtocol::get(Protocol::Command::ReadInfo, m_response.info),
+        AsyncProtocol::get(Protocol::Command::ReadConfig, m_response.config),
+        AsyncProtocol::get(Protocol::Command::ReadErrors, m_errors),
+        AsyncProtocol::get(Protocol::Command::ReadThresholdLevels, m_response.thresholdLevels),
+        AsyncProtocol::get(Protocol::Command::ReadSignalLevels, m_response.signalLevels)
+    }, [this, &proto, cancelled](bool received) {
+        CHECK(received);
+        resetErrors(proto, cancelled);
+    });
+    return true;
+}
 
-    CHECK(proto.get(Protocol::Command::ReadInfo, response.info));
-    CHECK(proto.get(Protocol::Command::ReadConfig, response.config));
-    CHECK(proto.get(Protocol::Command::ReadErrors, errors));
-    CHECK(proto.get(Protocol::Command::ReadThresholdLevels, response.thresholdLevels));
-    CHECK(proto.get(Protocol::Command::ReadSignalLevels, response.signalLevels));
-    if (errors.isResetRequired()) {
-        Protocol::Error err;
-        CHECK(proto.set(Protocol::Command::ResetErrors, err));
-        Q_ASSERT(err == Protocol::Error::Ok);
+bool GetAllDeviceInfo::startCached(AsyncProtocol &proto, CancelToken cancelled)
+{
+    // Признаки изменения конфигурации приходят в ответе ReadConfig, поэтому
+    // без одного обмена не обойтись; зато он идет конвейером
+    proto.submit({
+        AsyncProtocol::get(Protocol::Command::ReadInfo, m_response.info),
+        AsyncProtocol::get(Protocol::Command::ReadConfig, m_response.config),
+        AsyncProtocol::get(Protocol::Command::ReadErrors, m_errors),
+        AsyncProtocol::get(Protocol::Command::ReadSignalLevels, m_response.signalLevels)
+    }, [this, &proto, cancelled](bool received) {
+        CHECK(received);
+        if (isCacheValid()) {
+            m_response.thresholdLevels = m_cachedThresholdLevels;
+            return resetErrors(proto, cancelled);
+        }
+        proto.submit(AsyncProtocol::get(Protocol::Command::ReadThresholdLevels, m_response.thresholdLevels),
+                     [this, &proto, cancelled](bool received) {
+            CHECK(received);
+            resetErrors(proto, cancelled);
+        });
+    }, AsyncProtocol::Mode::Pipelined);
+    return true;
+}
+
+bool GetAllDeviceInfo::isCacheValid() const
+{
+    if (memcmp(&m_response.info.serialNumber, &m_cachedInfo.serialNumber, sizeof(m_cachedInfo.serialNumber)) != 0) {
+        return false;
+    }
+    for (auto &&module : m_response.config.modules) {
+        if (module.changed) {
+            return false;
+        }
     }
-    response.log = errors.log;
+    return true;
+}
 
-    emit success(response);
+void GetAllDeviceInfo::resetErrors(AsyncProtocol &proto, CancelToken cancelled)
+{
+    if (!m_errors.isResetRequired()) {
+        return complete();
+    }
+    proto.submit(AsyncProtocol::set(Protocol::Command::ResetErrors, m_error),
+                 [this, cancelled](bool received) {
+        CHECK(received);
+        Q_ASSERT(m_error == Protocol::Error::Ok);
+        complete();
+    });
 }
 
-UpdateDeviceInfo::UpdateDeviceInfo()
+void GetAllDeviceInfo::complete()
 {
-    qRegisterMetaType<Interfaces::UpdateDeviceInfo::Response>();
+    m_response.log = m_errors.log;
+    emit success(m_response);
+    emit finished();
 }
 
-void UpdateDeviceInfo::exec(QSerialPort &port, CancelToken cancelled)
+UpdateDeviceInfo::UpdateDeviceInfo(const PollPlan &plan)
+    : m_plan(plan)
 {
-    Response response;
-    ErrorsPackage errors;
-    Protocol proto(port);
+    qRegisterMetaType<Interfaces::UpdateDeviceInfo::Response>();
+}
 
-    CHECK(proto.get(Protocol::Command::ReadErrors, errors));
-    CHECK(proto.get(Protocol::Command::ReadSignalLevels, response.signalLevels));
-    CHECK(proto.get(Protocol::Command::ReadModuleStates, response.states));
-    if (errors.isResetRequired()) {
-        Protocol::Error err;
-        CHECK(proto.set(Protocol::Command::ResetErrors, err));
-        Q_ASSERT(err == Protocol::Error::Ok);
+bool UpdateDeviceInfo::start(AsyncProtocol &proto, CancelToken cancelled)
+{
+    memset(&m_response, 0, sizeof(Response));
+    std::vector<AsyncProtocol::Request> requests {
+        AsyncProtocol::get(Protocol::Command::ReadErrors, m_errors)
+    };
+    if (m_plan.signalLevels) {
+        requests.push_back(AsyncProtocol::get(Protocol::Command::ReadSignalLevels, m_response.signalLevels));
     }
+    if (m_plan.moduleStates) {
+        requests.push_back(AsyncProtocol::get(Protocol::Command::ReadModuleStates, m_response.states));
+    }
+    proto.submit(std::move(requests), [this, &proto, cancelled](bool received) {
+        CHECK(received);
+        if (!m_errors.isResetRequired()) {
+            return complete();
+        }
+        proto.submit(AsyncProtocol::set(Protocol::Command::ResetErrors, m_error),
+                     [this, cancelled](bool received) {
+            CHECK(received);
+            Q_ASSERT(m_error == Protocol::Error::Ok);
+            complete();
+        });
+    }, AsyncProtocol::Mode::Pipelined);
+    return true;
+}
 
-    response.errors = errors.current;
-
-    emit success(response);
+void UpdateDeviceInfo::complete()
+{
+    m_response.errors = m_errors.current;
+    emit success(m_response);
+    emit finished();
 }
 
 SetControlModule::SetControlModule(int slot)
@@ -144,15 +303,21 @@ SetControlModule::SetControlModule(int slot)
     Q_ASSERT(slot >= 0 && slot < kSlotCount);
 }
 
-void SetControlModule::exec(QSerialPort &port, CancelToken cancelled)
+bool SetControlModule::supersedes(const Interfaces::Transaction &older) const
 {
-    Protocol proto(port);
-    Protocol::Error err;
-
-    CHECK(proto.set(Protocol::Command::WriteTempControlModule, err, m_data));
+    return qobject_cast<const SetControlModule *>(&older) != nullptr;
+}
 
-    Q_ASSERT(err == Protocol::Error::Ok);
-    emit success();
+bool SetControlModule::start(AsyncProtocol &proto, CancelToken cancelled)
+{
+    proto.submit(AsyncProtocol::set(Protocol::Command::WriteTempControlModule, m_error, m_data),
+                 [this, cancelled](bool received) {
+        CHECK(received);
+        Q_ASSERT(m_error == Protocol::Error::Ok);
+        emit success();
+        emit finished();
+    });
+    return true;
 }
 
 SetModuleConfig::SetModuleConfig(int slot, ModuleConfig config)
@@ -161,19 +326,26 @@ SetModuleConfig::SetModuleConfig(int slot, ModuleConfig config)
     Q_ASSERT(slot >= 0 && slot < kSlotCount);
 }
 
-void SetModuleConfig::exec(QSerialPort &port, CancelToken cancelled)
+bool SetModuleConfig::supersedes(const Interfaces::Transaction &older) const
 {
-    Protocol proto(port);
-    Protocol::Error err;
-
-    CHECK(proto.set(Protocol::Command::WriteTempModuleConfig, err, m_data));
+    auto config = qobject_cast<const SetModuleConfig *>(&older);
+    return config && config->m_data.slot == m_data.slot;
+}
 
-    switch (err) {
-    case Protocol::Error::Ok             : return emit success();
-    case Protocol::Error::BadParamNumber :
-    case Protocol::Error::WrongParam     : return emit wrongParametersDetected();
-    case Protocol::Error::CantWrite      : Q_ASSERT(false);
-    }
+bool SetModuleConfig::start(AsyncProtocol &proto, CancelToken cancelled)
+{
+    proto.submit(AsyncProtocol::set(Protocol::Command::WriteTempModuleConfig, m_error, m_data),
+                 [this, cancelled](bool received) {
+        CHECK(received);
+        switch (m_error) {
+        case Protocol::Error::Ok             : emit success(); break;
+        case Protocol::Error::BadParamNumber :
+        case Protocol::Error::WrongParam     : emit wrongParametersDetected(); break;
+        case Protocol::Error::CantWrite      : Q_ASSERT(false); break;
+        }
+        emit finished();
+    });
+    return true;
 }
 
 SetThresholdLevels::SetThresholdLevels(SignalLevels lvls)
@@ -181,15 +353,21 @@ SetThresholdLevels::SetThresholdLevels(SignalLevels lvls)
 {
 }
 
-void SetThresholdLevels::exec(QSerialPort &port, CancelToken cancelled)
+bool SetThresholdLevels::supersedes(const Interfaces::Transaction &older) const
 {
-    Protocol proto(port);
-    Protocol::Error err;
-
-    CHECK(proto.set(Protocol::Command::WriteThresholdLevels, err, m_data));
-    Q_ASSERT(err == Protocol::Error::Ok);
+    return qobject_cast<const SetThresholdLevels *>(&older) != nullptr;
+}
 
-    emit success();
+bool SetThresholdLevels::start(AsyncProtocol &proto, CancelToken cancelled)
+{
+    proto.submit(AsyncProtocol::set(Protocol::Command::WriteThresholdLevels, m_error, m_data),
+                 [this, cancelled](bool received) {
+        CHECK(received);
+        Q_ASSERT(m_error == Protocol::Error::Ok);
+        emit success();
+        emit finished();
+    });
+    return true;
 }
 
 SaveConfigToEprom::SaveConfigToEprom(const DeviceConfig &config)
@@ -197,41 +375,75 @@ SaveConfigToEprom::SaveConfigToEprom(const DeviceConfig &config)
 {
 }
 
-void SaveConfigToEprom::exec(QSerialPort &port, CancelToken cancelled)
+bool SaveConfigToEprom::start(AsyncProtocol &proto, CancelToken cancelled)
 {
     using namespace std::chrono_literals;
-    Protocol proto(port);
-    Protocol::Error err;
-
-    CHECK(proto.set(Protocol::Command::WriteConfig, err, m_config, 2s));
 
-    switch (err) {
-    case Protocol::Error::Ok             : return emit success();
-    case Protocol::Error::BadParamNumber : return Q_ASSERT(false);
-    case Protocol::Error::WrongParam     : return emit wrongParametersDetected();
-    case Protocol::Error::CantWrite      : return emit deviceCorruptionDetected();
-    }
+    auto request = AsyncProtocol::set(Protocol::Command::WriteConfig, m_error, m_config);
+    request.timeout = 2s;
+    proto.submit(std::move(request), [this, cancelled](bool received) {
+        CHECK(received);
+        switch (m_error) {
+        case Protocol::Error::Ok             : emit success(); break;
+        case Protocol::Error::BadParamNumber : Q_ASSERT(false); break;
+        case Protocol::Error::WrongParam     : emit wrongParametersDetected(); break;
+        case Protocol::Error::CantWrite      : emit deviceCorruptionDetected(); break;
+        }
+        emit finished();
+    });
+    return true;
 }
 
+constexpr std::chrono::milliseconds UpdateFirmware::kRebootTimeout;
+constexpr std::chrono::milliseconds UpdateFirmware::kStallTimeout;
+constexpr std::chrono::milliseconds UpdateFirmware::kBootTimeout;
+constexpr std::chrono::milliseconds UpdateFirmware::kBootProbeFirst;
+constexpr std::chrono::milliseconds UpdateFirmware::kBootProbeMax;
+
 UpdateFirmware::UpdateFirmware(Firmware firmware)
     : m_firmware(firmware)
 {
     qRegisterMetaType<Interfaces::UpdateFirmware::Status>();
+    qRegisterMetaType<Interfaces::UpdateFirmware::Timings>();
 }
 
-void UpdateFirmware::exec(QSerialPort &port, CancelToken)
+void UpdateFirmware::exec(Link &link, CancelToken cancelled)
 {
-    Protocol proto(port);
-    UpdaterProtocol boot(port);
+    using std::chrono::milliseconds;
+
+    Protocol proto(link);
+    UpdaterProtocol boot(link.transport(), cancelled);
+    Timings timings;
+    QElapsedTimer total;
+    total.start();
+    auto timed = [](milliseconds &phase, auto &&step) {
+        QElapsedTimer clock;
+        clock.start();
+        bool result = step();
+        phase += milliseconds(clock.elapsed());
+        return result;
+    };
 
     emit started();
-    bool result = reboot(proto)        // Перезагружаем устройство
-            && boot.configure()        // Настраиваем порт на работу с загрузчиком
-            && flash(boot)             // Передаем прошивку на устройство
-            && proto.configure()       // Настраиваем порт на работу с прошивкой
-            && waitForFirmware(proto)  // Ждем загрузки прошивки
-            && reboot(proto)           // Перезагружаем прошивку
-            && waitForFirmware(proto); // Ждем загрузки прошивки
+    bool result =
+               // Перезагружаем устройство
+               timed(timings.reboot, [&] { return reboot(proto); })
+               // Настраиваем порт на работу с загрузчиком и передаем прошивку
+            && timed(timings.flash, [&] { return boot.configure() && flash(proto, boot, cancelled); })
+               // Настраиваем порт на работу с прошивкой и ждем ее загрузки
+            && timed(timings.boot, [&] { return proto.configure() && waitForFirmware(proto, cancelled); })
+               // Перезагружаем прошивку
+            && timed(timings.reboot, [&] { return reboot(proto); })
+               // Ждем загрузки прошивки
+            && timed(timings.boot, [&] { return waitForFirmware(proto, cancelled); });
+    timings.total = milliseconds(total.elapsed());
+    qDebug("UpdateFirmware::exec(): перезагрузка %lld мс, прошивка %lld мс, "
+           "запуск %lld мс, всего %lld мс",
+           static_cast<long long>(timings.reboot.count()),
+           static_cast<long long>(timings.flash.count()),
+           static_cast<long long>(timings.boot.count()),
+           static_cast<long long>(timings.total.count()));
+    emit timingsMeasured(timings);
     // Сообщаем о результате
     if (result) {
         emit success();
@@ -240,44 +452,153 @@ void UpdateFirmware::exec(QSerialPort &port, CancelToken)
     }
 }
 
-bool UpdateFirmware::flash(UpdaterProtocol &boot)
+bool UpdateFirmware::flash(Protocol &proto, UpdaterProtocol &boot, const CancelToken &cancelled)
 {
+    using PageReply = UpdaterProtocol::PageReply;
+
+    // Кадры кодируются один раз на образ; цикл только передает их
+    auto frames = m_firmware.frames();
+    const int lastPage = m_firmware.pageCount() - 1;
+    int acknowledged = -1; // Контрольная точка: старшая подтвержденная страница
+    int restarts = 0;
+    // Загрузчик может отвечать, но не принимать страницы (постоянные ошибки
+    // CRC); передача прекращается, если подтверждений долго нет
+    int stalledRounds = 0;
+    QElapsedTimer sinceAcknowledged;
+    sinceAcknowledged.start();
+
     emit statusChanged(Flash);
-    emit progressMaxChanged(m_firmware.pageCount() - 1);
+    emit progressMaxChanged(lastPage);
     emit progressChanged(0);
 
-    int requestedPage = 0;
-    while (requestedPage < m_firmware.pageCount() - 1) {
-        requestedPage = boot.waitForRequest();
-        if (requestedPage == -1) {
+    int page = boot.waitForRequest();
+    forever {
+        // Отмена не должна приводить к повторам и перезагрузкам устройства
+        if (cancelled.isCancelled()) {
+            return false;
+        }
+        if (stalledRounds > kMaxStalledRounds
+                || sinceAcknowledged.hasExpired(kStallTimeout.count())) {
+            qWarning("UpdateFirmware::flash(): загрузчик не принимает страницы");
             emit error(Flash);
             return false;
         }
-        qDebug("UpdateFirmware::flash(): запрошена страница %d", (int) requestedPage);
-        if (!boot.writePage(requestedPage, m_firmware.pageSizeLog2(),
-                            m_firmware.page(requestedPage))) {
+        ++stalledRounds;
+        if (page < 0) {
+            // Загрузчик не отвечает: вероятно, он вышел в прошивку по
+            // таймауту. Устройство снова переводится в загрузчик, который
+            // сам выберет, с какой страницы продолжить
+            if (restarts == kMaxFlashRestarts) {
+                emit error(Flash);
+                return false;
+            }
+            if (!restartBootloader(proto, boot)) {
+                return false;
+            }
+            ++restarts;
+            emit statusChanged(Flash);
+            emit progressMaxChanged(lastPage);
+            emit progressChanged(std::max(acknowledged, 0));
+            page = boot.waitForRequest();
+            continue ;
+        }
+        if (page >= frames->count()) {
             emit error(Flash);
             return false;
         }
-        qDebug("UpdateFirmware::flash(): страница %d передана", (int) requestedPage);
-        emit progressChanged(requestedPage);
+        if (page > acknowledged + 1) {
+            qDebug("UpdateFirmware::flash(): продолжение со страницы %d", page);
+        }
+        qDebug("UpdateFirmware::flash(): запрошена страница %d", page);
+        auto frame = frames->frame(page);
+        int requested = -1;
+        auto reply = PageReply::NoAnswer;
+        // Сначала повторяется только эта страница
+        for (int attempt = 0; attempt <= kPageRetries && reply == PageReply::NoAnswer
+                              && !cancelled.isCancelled(); ++attempt) {
+            reply = boot.writePage(page, frame, requested);
+        }
+        switch (reply) {
+        case PageReply::Acknowledged:
+            qDebug("UpdateFirmware::flash(): страница %d передана", page);
+            acknowledged = std::max(acknowledged, page);
+            stalledRounds = 0;
+            sinceAcknowledged.restart();
+            emit progressChanged(page);
+            if (page == lastPage) {
+                return true;
+            }
+            page = boot.waitForRequest();
+            break;
+        case PageReply::Requested:
+            // Запрос следующей страницы заменяет потерянное подтверждение
+            if (requested > page) {
+                acknowledged = std::max(acknowledged, page);
+                stalledRounds = 0;
+                sinceAcknowledged.restart();
+                emit progressChanged(page);
+                if (page == lastPage) {
+                    return true;
+                }
+            }
+            page = requested;
+            break;
+        case PageReply::NoAnswer:
+            // Повторы не помогли: ждем запроса загрузчика
+            page = boot.waitForRequest();
+            break;
+        case PageReply::Fatal:
+            emit error(Flash);
+            return false;
+        }
+    }
+}
+
+bool UpdateFirmware::restartBootloader(Protocol &proto, UpdaterProtocol &boot)
+{
+    qDebug("UpdateFirmware::flash(): повторный переход в загрузчик");
+    if (!proto.configure()) {
+        emit error(Flash);
+        return false;
+    }
+    // Об отказе перезагрузки сообщает сам reboot()
+    if (!reboot(proto)) {
+        return false;
+    }
+    if (!boot.configure()) {
+        emit error(Flash);
+        return false;
     }
     return true;
 }
 
-bool UpdateFirmware::waitForFirmware(Protocol &proto)
+bool UpdateFirmware::waitForFirmware(Protocol &proto, const CancelToken &cancelled)
 {
+    using std::chrono::milliseconds;
+
     emit statusChanged(WaitForBoot);
     emit progressMaxChanged(0);
     emit progressChanged(-1);
 
-    DeviceInfo info;
-    for (int attempt = 0; attempt < 5; ++attempt) {
-        if (proto.get(Protocol::Command::ReadInfo, info)) {
-            qDebug("UpdateFirmware::reboot(): устройство загружено");
+    // Проверка не спит между попытками: окно ожидания ответа и есть пауза,
+    // и любой пакет, пришедший в нем, завершает ожидание
+    QDeadlineTimer deadline(kBootTimeout);
+    auto listen = kBootProbeFirst;
+    while (!deadline.hasExpired() && !cancelled.isCancelled()) {
+        auto window = std::min(listen, milliseconds(std::max<qint64>(deadline.remainingTime(), 1)));
+        QElapsedTimer clock;
+        clock.start();
+        if (proto.probe(Protocol::Command::ReadInfo, window)) {
+            qDebug("UpdateFirmware::waitForFirmware(): устройство загружено за %lld мс",
+                   static_cast<long long>(kBootTimeout.count() - deadline.remainingTime()));
             return true;
         }
-        QThread::msleep(2500);
+        // Запрос не ушел в порт: окно выжидается, чтобы не крутить цикл
+        auto rest = window - milliseconds(clock.elapsed());
+        if (rest > milliseconds::zero() && !InterruptibleWait::sleep(rest, cancelled)) {
+            break;
+        }
+        listen = std::min(listen * 2, kBootProbeMax);
     }
     emit error(WaitForBoot);
     return false;
@@ -289,8 +610,10 @@ bool UpdateFirmware::reboot(Protocol &proto)
     emit progressMaxChanged(0);
     emit progressChanged(-1);
 
+    // Повторный Reboot после позднего ответа попал бы в загрузчик или в
+    // только что запущенную прошивку, поэтому команда не повторяется
     Protocol::Error err;
-    if (proto.set(Protocol::Command::Reboot, err)) {
+    if (proto.setOnce(Protocol::Command::Reboot, err, kRebootTimeout)) {
         Q_ASSERT(err == Protocol::Error::Ok);
         qDebug("UpdateFirmware::reboot(): устройство перезагружено");
         return true;
@@ -299,14 +622,14 @@ bool UpdateFirmware::reboot(Protocol &proto)
     return false;
 }
 
-GetAllDeviceInfo *TransactionFabric::getAllDeviceInfo()
+GetAllDeviceInfo *TransactionFabric::getAllDeviceInfo(const DeviceCache::Entry *cached)
 {
-    return new GetAllDeviceInfo();
+    return new GetAllDeviceInfo(cached);
 }
 
-UpdateDeviceInfo *TransactionFabric::updateDeviceInfo()
+UpdateDeviceInfo *TransactionFabric::updateDeviceInfo(const PollPlan &plan)
 {
-    return new UpdateDeviceInfo();
+    return new UpdateDeviceInfo(plan);
 }
 
 SetControlModule *TransactionFabric::setControlModule(int slot)
@@ -343,41 +666,49 @@ GetAllDeviceInfo::GetAllDeviceInfo()
     qRegisterMetaType<Interfaces::GetAllDeviceInfo::Response>();
 }
 
-void GetAllDeviceInfo::exec(QSerialPort &port, CancelToken cancelled)
-{
-    Protocol proto(port);
-
-    DeviceInfo info;
-    DeviceConfig config;
-    SignalLevels signalLevels;
-
-    CHECK(proto.get(Protocol::Command::ReadInfo, info));
-    CHECK(proto.get(Protocol::Command::ReadConfig, config));
-    CHECK(proto.get(Protocol::Command::ReadSignalLevels, signalLevels));
-
-    Response response;
-    memset(&response, 0, sizeof(Response));
-    response.info.serialNumber.value = info.serialNumber;
-    response.config = config.convertToMDM500M();
-    response.signalLevels = signalLevels;
-    response.log = MDM500M::DeviceErrors {};
-    emit success(std::move(response));
+bool GetAllDeviceInfo::start(AsyncProtocol &proto, CancelToken cancelled)
+{
+    proto.submit({
+        AsyncProtocol::get(Protocol::Command::ReadInfo, m_info),
+        AsyncProtocol::get(Protocol::Command::ReadConfig, m_config),
+        AsyncProtocol::get(Protocol::Command::ReadSignalLevels, m_signalLevels)
+    }, [this, cancelled](bool received) {
+        CHECK(received);
+
+        Response response;
+        memset(&response, 0, sizeof(Response));
+        response.info.serialNumber.value = m_info.serialNumber;
+        response.config = m_config.convertToMDM500M();
+        response.signalLevels = m_signalLevels;
+        response.log = MDM500M::DeviceErrors {};
+        emit success(std::move(response));
+        emit finished();
+    });
+    return true;
 }
 
-UpdateDeviceInfo::UpdateDeviceInfo()
+UpdateDeviceInfo::UpdateDeviceInfo(const PollPlan &plan)
+    : m_plan(plan)
 {
     qRegisterMetaType<Interfaces::UpdateDeviceInfo::Response>();
 }
 
-void UpdateDeviceInfo::exec(QSerialPort &port, CancelToken cancelled)
+bool UpdateDeviceInfo::start(AsyncProtocol &proto, CancelToken cancelled)
 {
-    Protocol proto(port);
-    Response response;
-    memset(&response, 0, sizeof(Response));
-
-    CHECK(proto.get(Protocol::Command::ReadSignalLevels, response.signalLevels));
-
-    emit success(std::move(response));
+    memset(&m_response, 0, sizeof(Response));
+    if (!m_plan.signalLevels) {
+        // Модулей нет, а ошибки МДМ-500 выводятся из уровней сигнала
+        emit success(m_response);
+        emit finished();
+        return true;
+    }
+    proto.submit(AsyncProtocol::get(Protocol::Command::ReadSignalLevels, m_response.signalLevels),
+                 [this, cancelled](bool received) {
+        CHECK(received);
+        emit success(m_response);
+        emit finished();
+    });
+    return true;
 }
 
 SaveConfigToEprom::SaveConfigToEprom(const MDM500M::DeviceConfig &config)
@@ -385,55 +716,48 @@ SaveConfigToEprom::SaveConfigToEprom(const MDM500M::DeviceConfig &config)
 {
 }
 
-void SaveConfigToEprom::exec(QSerialPort &port, CancelToken cancelled)
+bool SaveConfigToEprom::start(AsyncProtocol &proto, CancelToken cancelled)
 {
     using namespace std::chrono_literals;
 
-    struct Reader
-    {
-        bool isDataEnough(int size) const
-        {
-            return size >= 0;
-        }
-
-        bool checkPackage(Protocol::Command cmd, const void *, int size)
-        {
-            if (size != 0) {
-                return false;
-            }
-            if (cmd == Protocol::Command::Ok) {
-                deviceCorruptionDetected = false;
-                return true;
-            }
-            if (cmd == Protocol::Command::Error) {
-                deviceCorruptionDetected = true;
-                return true;
-            }
+    AsyncProtocol::Request request;
+    request.cmd = Protocol::Command::WriteConfig;
+    request.params = QByteArray(reinterpret_cast<const char *>(&m_config), sizeof(m_config));
+    request.timeout = 2s;
+    request.reader = [this](Protocol::Command cmd, const void *, int size) {
+        if (size != 0) {
             return false;
         }
-
-        bool deviceCorruptionDetected = false;
-    } reader;
-
-    Protocol proto(port);
-
-    CHECK(proto.set(Protocol::Command::WriteConfig, m_config, reader, 2s, Protocol::ReaderTag()));
-
-    if (reader.deviceCorruptionDetected) {
-        emit deviceCorruptionDetected();
-        return ;
-    }
-    emit success();
+        if (cmd == Protocol::Command::Ok) {
+            m_deviceCorruptionDetected = false;
+            return true;
+        }
+        if (cmd == Protocol::Command::Error) {
+            m_deviceCorruptionDetected = true;
+            return true;
+        }
+        return false;
+    };
+    proto.submit(std::move(request), [this, cancelled](bool received) {
+        CHECK(received);
+        if (m_deviceCorruptionDetected) {
+            emit deviceCorruptionDetected();
+        } else {
+            emit success();
+        }
+        emit finished();
+    });
+    return true;
 }
 
-GetAllDeviceInfo *TransactionFabric::getAllDeviceInfo()
+GetAllDeviceInfo *TransactionFabric::getAllDeviceInfo(const DeviceCache::Entry *)
 {
     return new GetAllDeviceInfo();
 }
 
-UpdateDeviceInfo *TransactionFabric::updateDeviceInfo()
+UpdateDeviceInfo *TransactionFabric::updateDeviceInfo(const PollPlan &plan)
 {
-    return new UpdateDeviceInfo();
+    return new UpdateDeviceInfo(plan);
 }
 
 SaveConfigToEprom *TransactionFabric::saveConfigToEprom(const MDM500M::DeviceConfig &config)
@@ -1,12 +1,17 @@
 ﻿#pragma once
 
-#include <QSerialPort>
+#include <chrono>
+
+#include <QStringList>
 
 #include "Cancelation.h"
+#include "DeviceCache.h"
 #include "Firmware.h"
+#include "Protocol.h"
 #include "Types.h"
 
-class Protocol;
+class AsyncProtocol;
+class Link;
 class UpdaterProtocol;
 
 namespace Interfaces {
@@ -16,10 +21,65 @@ class Transaction : public QObject
     Q_OBJECT
 
 public:
-    virtual void exec(QSerialPort &port, CancelToken cancelToken) = 0;
+    /**
+     * @brief Классы приоритета транзакций, по возрастанию
+     *
+     * Из очереди устройства первой выполняется транзакция наибольшего
+     * приоритета. Ожидающие транзакции со временем повышаются в приоритете,
+     * но не выше Firmware, поэтому действие оператора ждет не больше одной
+     * уже выполняемой транзакции.
+     */
+    enum class Priority
+    {
+        Poll,        /**< Фоновый опрос состояния        */
+        InitialLoad, /**< Поиск и начальное чтение данных */
+        Firmware,    /**< Обновление прошивки            */
+        Interactive  /**< Команды оператора               */
+    };
+
+    virtual Priority priority() const;
+    /**
+     * @brief Проверить, делает ли эта транзакция ненужной ожидающую older
+     *
+     * Вытесненная транзакция удаляется из очереди, не начавшись, и излучает
+     * только сигнал abandoned().
+     */
+    virtual bool supersedes(const Transaction &older) const;
+    /**
+     * @brief Задать срок выполнения транзакции
+     *
+     * Транзакция, не начавшаяся к этому сроку, снимается с очереди, а
+     * выполняемая - прерывается; в обоих случаях излучается abandoned().
+     * Вызывается до передачи транзакции в TransactionInvoker.
+     */
+    void setDeadline(CancelToken::Clock::time_point deadline);
+    CancelToken::Clock::time_point deadline() const;
+    /**
+     * @brief Выполнить транзакцию, не возвращая управление до ее завершения
+     *
+     * Точка входа только для блокирующих транзакций (SearchDevice,
+     * UpdateFirmware): LinkSession вызывает ее в отдельном потоке, если
+     * start() вернул ложь. Неблокирующие транзакции ее не переопределяют.
+     */
+    virtual void exec(Link &link, CancelToken cancelToken);
+    /**
+     * @brief Начать выполнение транзакции на неблокирующем протоколе
+     *
+     * По завершении транзакция излучает сигнал finished().
+     * @return ложь, если транзакция выполняется только методом exec()
+     */
+    virtual bool start(AsyncProtocol &proto, CancelToken cancelToken);
 
 signals:
     void failure();
+    void finished();
+    /**
+     * @brief Транзакция отменена, вытеснена или не уложилась в срок
+     */
+    void abandoned();
+
+private:
+    CancelToken::Clock::time_point m_deadline = CancelToken::Clock::time_point::max();
 };
 
 class GetAllDeviceInfo : public Transaction
@@ -27,6 +87,8 @@ class GetAllDeviceInfo : public Transaction
     Q_OBJECT
 
 public:
+    Priority priority() const override;
+
     struct Response
     {
         MDM500M::DeviceConfig config;
@@ -45,6 +107,8 @@ class UpdateDeviceInfo : public Transaction
     Q_OBJECT
 
 public:
+    Priority priority() const override;
+
     struct Response
     {
         MDM500M::SignalLevels signalLevels;
@@ -60,6 +124,9 @@ class SetControlModule : public Transaction
 {
     Q_OBJECT
 
+public:
+    Priority priority() const override;
+
 signals:
     void success();
 };
@@ -68,6 +135,9 @@ class SetModuleConfig : public Transaction
 {
     Q_OBJECT
 
+public:
+    Priority priority() const override;
+
 signals:
     void success();
     void wrongParametersDetected();
@@ -77,6 +147,9 @@ class SetThresholdLevels : public Transaction
 {
     Q_OBJECT
 
+public:
+    Priority priority() const override;
+
 signals:
     void success();
 };
@@ -85,6 +158,9 @@ class SaveConfigToEprom : public Transaction
 {
     Q_OBJECT
 
+public:
+    Priority priority() const override;
+
 signals:
     void success();
     void wrongParametersDetected();
@@ -96,6 +172,8 @@ class UpdateFirmware : public Transaction
     Q_OBJECT
 
 public:
+    Priority priority() const override;
+
     enum Status
     {
         Reboot,
@@ -104,8 +182,25 @@ public:
     };
     Q_ENUM(Status)
 
+    /**
+     * @brief Длительность этапов обновления; этапы, выполняемые дважды,
+     * суммируются
+     */
+    struct Timings
+    {
+        std::chrono::milliseconds reboot   { 0 }; /**< Команды перезагрузки              */
+        std::chrono::milliseconds flash    { 0 }; /**< Передача страниц, с повторами     */
+        std::chrono::milliseconds boot     { 0 }; /**< Ожидание запуска прошивки         */
+        std::chrono::milliseconds total    { 0 };
+    };
+
 signals:
     void started();
+    /**
+     * @brief Излучается перед success() или failure(), в том числе при
+     * отказе на любом этапе
+     */
+    void timingsMeasured(const Interfaces::UpdateFirmware::Timings &timings);
     void success();
     void error(Interfaces::UpdateFirmware::Status whileDoing);
     void statusChanged(Interfaces::UpdateFirmware::Status status);
@@ -119,8 +214,17 @@ class TransactionFabric
 public:
     virtual ~TransactionFabric() = default;
 
-    virtual GetAllDeviceInfo *getAllDeviceInfo() = 0;
-    virtual UpdateDeviceInfo *updateDeviceInfo() = 0;
+    /**
+     * @brief Начальное чтение данных устройства
+     * @param cached данные из DeviceCache о последнем подключении к этому
+     * порту или nullptr
+     */
+    virtual GetAllDeviceInfo *getAllDeviceInfo(const DeviceCache::Entry *cached) = 0;
+    /**
+     * @brief Периодический опрос; команды, не входящие в plan, не
+     * отправляются, а соответствующие поля ответа остаются нулевыми
+     */
+    virtual UpdateDeviceInfo *updateDeviceInfo(const PollPlan &plan) = 0;
     virtual SetControlModule *setControlModule(int slot) = 0;
     virtual SetModuleConfig *setModuleConfig(int slot, MDM500M::ModuleConfig config) = 0;
     virtual SetThresholdLevels *setThresholdLevels(const MDM500M::SignalLevels &) = 0;
@@ -131,6 +235,7 @@ public:
 } // namespace Interfaces
 Q_DECLARE_METATYPE(Interfaces::GetAllDeviceInfo::Response)
 Q_DECLARE_METATYPE(Interfaces::UpdateDeviceInfo::Response)
+Q_DECLARE_METATYPE(Interfaces::UpdateFirmware::Timings)
 
 class SearchDevice : public Interfaces::Transaction
 {
@@ -140,11 +245,30 @@ public:
     typedef ::DeviceType DeviceType;
     Q_ENUM(DeviceType)
 
-    SearchDevice();
-    void exec(QSerialPort &port, CancelToken iscancelled) override;
+    /**
+     * @brief Проверка одного порта на наличие устройства
+     *
+     * Порты перебирает DeviceDiscovery, запуская проверки параллельно.
+     * Если устройство не найдено, излучается failure().
+     * @param address адрес транспорта (см. Transport::create)
+     */
+    SearchDevice(QString address);
+    Priority priority() const override;
+    void exec(Link &link, CancelToken iscancelled) override;
 
 private:
-    bool tryGetDeviceInfo(QSerialPort &port);
+    /**
+     * Ожидание ответа на ReadInfo. Оценка времени ответа на новом порту еще
+     * не накоплена (начальные 1000 мс), поэтому проверка ограничена своим
+     * коротким сроком: иначе каждый порт без устройства стоил бы секунду на
+     * каждом проходе поиска. Устройство отвечает на ReadInfo за единицы мс,
+     * запас оставлен для серверов последовательных портов.
+     */
+    static constexpr std::chrono::milliseconds kProbeTimeout { 300 };
+
+    bool tryGetDeviceInfo(Link &link);
+
+    QString m_address;
 
 signals:
     void found(SearchDevice::DeviceType);
@@ -152,13 +276,34 @@ signals:
 
 namespace MDM500M {
 
+/**
+ * @brief Начальное чтение данных МДМ-500М
+ *
+ * Если известны данные последнего подключения к порту, команды чтения
+ * отправляются конвейером, а пороговые уровни берутся из кэша, когда
+ * серийный номер совпадает и ни у одного модуля не выставлен признак
+ * ModuleConfig::changed. Иначе пороги дочитываются отдельной командой.
+ */
 class GetAllDeviceInfo : public Interfaces::GetAllDeviceInfo
 {
     Q_OBJECT
 
 public:
-    GetAllDeviceInfo();
-    void exec(QSerialPort &port, CancelToken cancelled) override;
+    GetAllDeviceInfo(const DeviceCache::Entry *cached = nullptr);
+    bool start(AsyncProtocol &proto, CancelToken cancelled) override;
+
+private:
+    bool startCached(AsyncProtocol &proto, CancelToken cancelled);
+    bool isCacheValid() const;
+    void resetErrors(AsyncProtocol &proto, CancelToken cancelled);
+    void complete();
+
+    bool m_hasCache = false;
+    DeviceInfo m_cachedInfo;
+    SignalLevels m_cachedThresholdLevels;
+    Response m_response;
+    ErrorsPackage m_errors;
+    Protocol::Error m_error;
 };
 
 class UpdateDeviceInfo : public Interfaces::UpdateDeviceInfo
@@ -166,8 +311,16 @@ class UpdateDeviceInfo : public Interfaces::UpdateDeviceInfo
     Q_OBJECT
 
 public:
-    UpdateDeviceInfo();
-    void exec(QSerialPort &port, CancelToken cancelled) override;
+    UpdateDeviceInfo(const PollPlan &plan);
+    bool start(AsyncProtocol &proto, CancelToken cancelled) override;
+
+private:
+    void complete();
+
+    PollPlan m_plan;
+    Response m_response;
+    ErrorsPackage m_errors;
+    Protocol::Error m_error;
 };
 
 class SetControlModule : public Interfaces::SetControlModule
@@ -176,10 +329,12 @@ class SetControlModule : public Interfaces::SetControlModule
 
 public:
     SetControlModule(int slot);
-    void exec(QSerialPort &port, CancelToken cancelled) override;
+    bool supersedes(const Interfaces::Transaction &older) const override;
+    bool start(AsyncProtocol &proto, CancelToken cancelled) override;
 
 private:
     uint8_t m_data;
+    Protocol::Error m_error;
 };
 
 class SetModuleConfig : public Interfaces::SetModuleConfig
@@ -188,10 +343,12 @@ class SetModuleConfig : public Interfaces::SetModuleConfig
 
 public:
     SetModuleConfig(int slot, ModuleConfig config);
-    void exec(QSerialPort &port, CancelToken cancelled) override;
+    bool supersedes(const Interfaces::Transaction &older) const override;
+    bool start(AsyncProtocol &proto, CancelToken cancelled) override;
 
 private:
     ModuleConfigWithSlot m_data;
+    Protocol::Error m_error;
 };
 
 class SetThresholdLevels : public Interfaces::SetThresholdLevels
@@ -200,10 +357,12 @@ class SetThresholdLevels : public Interfaces::SetThresholdLevels
 
 public:
     SetThresholdLevels(SignalLevels lvls);
-    void exec(QSerialPort &port, CancelToken cancelled) override;
+    bool supersedes(const Interfaces::Transaction &older) const override;
+    bool start(AsyncProtocol &proto, CancelToken cancelled) override;
 
 private:
     SignalLevels m_data;
+    Protocol::Error m_error;
 };
 
 class SaveConfigToEprom : public Interfaces::SaveConfigToEprom
@@ -212,10 +371,11 @@ class SaveConfigToEprom : public Interfaces::SaveConfigToEprom
 
 public:
     SaveConfigToEprom(const DeviceConfig &config);
-    void exec(QSerialPort &port, CancelToken cancelled) override;
+    bool start(AsyncProtocol &proto, CancelToken cancelled) override;
 
 private:
     DeviceConfig m_config;
+    Protocol::Error m_error;
 };
 
 class UpdateFirmware : public Interfaces::UpdateFirmware
@@ -224,11 +384,43 @@ class UpdateFirmware : public Interfaces::UpdateFirmware
 
 public:
     UpdateFirmware(Firmware firmware);
-    void exec(QSerialPort &port, CancelToken cancelled) override;
+    void exec(Link &link, CancelToken cancelled) override;
 
 private:
-    bool flash(UpdaterProtocol &boot);
-    bool waitForFirmware(Protocol &proto);
+    static constexpr int kPageRetries = 3;      /**< Повторы одной страницы           */
+    static constexpr int kMaxFlashRestarts = 2; /**< Повторные переходы в загрузчик  */
+    static constexpr int kMaxStalledRounds = 8; /**< Обмены подряд без подтверждений */
+    static constexpr std::chrono::milliseconds kRebootTimeout  { 2000 };
+    static constexpr std::chrono::milliseconds kStallTimeout   { 30000 };
+    static constexpr std::chrono::milliseconds kBootTimeout    { 15000 };
+    static constexpr std::chrono::milliseconds kBootProbeFirst { 100 };
+    static constexpr std::chrono::milliseconds kBootProbeMax   { 1600 };
+
+    /**
+     * @brief Передать прошивку загрузчику
+     *
+     * Сбой не начинает обновление заново: сначала повторяется только
+     * сбойная страница, затем ожидается запрос загрузчика, и только если
+     * загрузчик молчит, устройство снова переводится в загрузчик. Загрузчик
+     * сам запрашивает следующую нужную ему страницу, поэтому передача
+     * продолжается с нее, а не с нулевой.
+     *
+     * Если ни одна страница не подтверждена за kMaxStalledRounds обменов
+     * или kStallTimeout, передача прекращается с ошибкой; при отмене -
+     * сразу и без ошибки.
+     */
+    bool flash(Protocol &proto, UpdaterProtocol &boot, const CancelToken &cancelled);
+    bool restartBootloader(Protocol &proto, UpdaterProtocol &boot);
+    /**
+     * @brief Дождаться запуска прошивки
+     *
+     * Устройство проверяется командой ReadInfo с окном ожидания, растущим
+     * вдвое от kBootProbeFirst до kBootProbeMax, поэтому быстро
+     * загрузившееся устройство обнаруживается почти сразу. Признаком
+     * запуска служит любой верный пакет, а не только ответ на последнюю
+     * проверку.
+     */
+    bool waitForFirmware(Protocol &proto, const CancelToken &cancelled);
     bool reboot(Protocol &proto);
 
     Firmware m_firmware;
@@ -237,8 +429,8 @@ private:
 class TransactionFabric : public Interfaces::TransactionFabric
 {
 public:
-    GetAllDeviceInfo *getAllDeviceInfo() override;
-    UpdateDeviceInfo *updateDeviceInfo() override;
+    GetAllDeviceInfo *getAllDeviceInfo(const DeviceCache::Entry *cached) override;
+    UpdateDeviceInfo *updateDeviceInfo(const PollPlan &plan) override;
     SetControlModule *setControlModule(int slot) override;
     SetModuleConfig *setModuleConfig(int slot, ModuleConfig config) override;
     SetThresholdLevels *setThresholdLevels(const SignalLevels &) override;
@@ -256,7 +448,12 @@ class GetAllDeviceInfo : public Interfaces::GetAllDeviceInfo
 
 public:
     GetAllDeviceInfo();
-    void exec(QSerialPort &port, CancelToken cancelled) override;
+    bool start(AsyncProtocol &proto, CancelToken cancelled) override;
+
+private:
+    DeviceInfo m_info;
+    DeviceConfig m_config;
+    SignalLevels m_signalLevels;
 };
 
 class UpdateDeviceInfo : public Interfaces::UpdateDeviceInfo
@@ -264,8 +461,12 @@ class UpdateDeviceInfo : public Interfaces::UpdateDeviceInfo
     Q_OBJECT
 
 public:
-    UpdateDeviceInfo();
-    void exec(QSerialPort &port, CancelToken cancelled) override;
+    UpdateDeviceInfo(const PollPlan &plan);
+    bool start(AsyncProtocol &proto, CancelToken cancelled) override;
+
+private:
+    PollPlan m_plan;
+    Response m_response;
 };
 
 class SaveConfigToEprom : public Interfaces::SaveConfigToEprom
@@ -274,17 +475,18 @@ class SaveConfigToEprom : public Interfaces::SaveConfigToEprom
 
 public:
     SaveConfigToEprom(const MDM500M::DeviceConfig &config);
-    void exec(QSerialPort &port, CancelToken cancelled) override;
+    bool start(AsyncProtocol &proto, CancelToken cancelled) override;
 
 private:
     DeviceConfig m_config;
+    bool m_deviceCorruptionDetected = false;
 };
 
 class TransactionFabric : public Interfaces::TransactionFabric
 {
 public:
-    GetAllDeviceInfo *getAllDeviceInfo() override;
-    UpdateDeviceInfo *updateDeviceInfo() override;
+    GetAllDeviceInfo *getAllDeviceInfo(const DeviceCache::Entry *cached) override;
+    UpdateDeviceInfo *updateDeviceInfo(const PollPlan &plan) override;
     SaveConfigToEprom *saveConfigToEprom(const MDM500M::DeviceConfig &) override;
 
     Interfaces::SetControlModule *setControlModule(int slot) override;
@@ -0,0 +1,64 @@
+#include <QUrl>
+
+#include "SerialTransport.h"
+#include "TcpTransport.h"
+#include "Transport.h"
+
+namespace {
+
+const QString kPtyScheme = "pty:";
+
+} // namespace
+
+bool Transport::isValidAddress(const QString &address)
+{
+    if (address.startsWith(kPtyScheme)) {
+        return address.size() > kPtyScheme.size();
+    }
+    if (address.contains("://")) {
+        QUrl url(address);
+        return url.isValid() && !url.host().isEmpty() && url.port() > 0
+                && (url.scheme() == "tcp" || url.scheme() == "rfc2217");
+    }
+    // В имени последовательного порта нет двоеточия: "tcp:host:port" -
+    // ошибка в записи адреса, а не порт
+    return !address.isEmpty() && !address.contains(':');
+}
+
+std::unique_ptr<Transport> Transport::create(const QString &address)
+{
+    if (address.startsWith(kPtyScheme)) {
+        return std::make_unique<PtyTransport>(address.mid(kPtyScheme.size()));
+    }
+    if (address.contains("://")) {
+        QUrl url(address);
+        if (!url.isValid() || url.host().isEmpty() || url.port() <= 0) {
+            qWarning("Transport::create(): неверный адрес %s", qPrintable(address));
+            return nullptr;
+        }
+        auto port = static_cast<quint16>(url.port());
+        if (url.scheme() == "tcp") {
+            return std::make_unique<TcpTransport>(url.host(), port, TcpTransport::Mode::Raw);
+        }
+        if (url.scheme() == "rfc2217") {
+            return std::make_unique<TcpTransport>(url.host(), port, TcpTransport::Mode::Rfc2217);
+        }
+        qWarning("Transport::create(): неизвестная схема %s", qPrintable(url.scheme()));
+        return nullptr;
+    }
+    if (!isValidAddress(address)) {
+        qWarning("Transport::create(): неверный адрес %s", qPrintable(address));
+        return nullptr;
+    }
+    return std::make_unique<SerialTransport>(address);
+}
+
+qintptr Transport::descriptor() const
+{
+    return -1;
+}
+
+bool Transport::isSequential() const
+{
+    return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <memory>
+
+#include <QIODevice>
+#include <QString>
+
+/**
+ * @brief Канал передачи байтов до устройства
+ *
+ * Протоколы работают только через этот интерфейс, поэтому одинаково
+ * обслуживают локальный последовательный порт, псевдотерминал, сервер
+ * последовательных портов по TCP и соединение в памяти. Линия всегда
+ * настраивается как 8N1 без управления потоком с включенными RTS и DTR,
+ * отличается только скорость.
+ */
+class Transport : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    using QIODevice::QIODevice;
+
+    /**
+     * @brief Создать транспорт по адресу
+     *
+     * Поддерживаемые адреса:
+     * - "COM3", "ttyUSB0", "/dev/ttyS0" - последовательный порт;
+     * - "pty:/dev/pts/3" - псевдотерминал;
+     * - "tcp://host:port" - сервер последовательных портов без протокола;
+     * - "rfc2217://host:port" - сервер последовательных портов по RFC 2217.
+     * @return nullptr, если адрес не распознан
+     */
+    static std::unique_ptr<Transport> create(const QString &address);
+    /**
+     * @brief Проверить адрес, не создавая транспорт (см. create())
+     */
+    static bool isValidAddress(const QString &address);
+
+    /**
+     * @brief Этот метод возвращает адрес, по которому создан транспорт.
+     */
+    virtual QString address() const = 0;
+    /**
+     * @brief Настроить скорость линии
+     */
+    virtual bool configure(qint32 baudRate) = 0;
+    /**
+     * @brief Сбросить непрочитанные и непереданные данные
+     */
+    virtual void clear() = 0;
+    /**
+     * @brief Этот метод возвращает файловый дескриптор, готовность которого
+     * к чтению означает поступление данных, или -1.
+     *
+     * Нужен для ожидания, прерываемого отменой (см. InterruptibleWait).
+     */
+    virtual qintptr descriptor() const;
+
+    bool isSequential() const override;
+};
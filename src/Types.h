@@ -16,6 +16,19 @@ enum class DeviceType : int
     MDM500M
 };
 
+/**
+ * @brief Набор команд периодического опроса
+ *
+ * Составляется по конфигурации устройства (см. Device::pollPlan()), чтобы
+ * не читать данные, которые не влияют на модель. Ошибки модулей читаются
+ * всегда.
+ */
+struct PollPlan
+{
+    bool signalLevels = true; /**< Хотя бы один слот занят модулем       */
+    bool moduleStates = true; /**< Установлен модуль с RDS/стерео (DM500FM) */
+};
+
 /**
  * @brief Версия программного обеспечения
  */
@@ -1,7 +1,9 @@
-#include <QSerialPort>
 #include <QThread>
 
 #include "BootLoad.h"
+#include "Crc16.h"
+#include "InterruptibleWait.h"
+#include "Transport.h"
 #include "UpdaterProtocol.h"
 
 static constexpr uint8_t marker = 0x55;
@@ -13,63 +15,34 @@ struct WriteParametrs
     QByteArray pageData;
 };
 
-uint16_t slow_crc16RAM(uint16_t sum, const void *data, uint16_t len)
-{
-    auto p = reinterpret_cast<const uint8_t *>(data);
-    if(!len){
-        return sum;
-    }
-    do {
-        uint8_t i;
-        uint8_t byte = *p++;
-        for (i = 0; i < 8; ++i) {
-            WORD osum = sum;
-            sum <<= 1;
-            if(byte & 0x80){
-                sum |= 1 ;
-            }
-            if(osum & 0x8000){
-                sum ^= 0x1021;
-            }
-            byte <<= 1;
-        }
-    } while(--len);
-    return sum;
-}
-
 inline bool checkCrc(const TBootPack &package)
 {
     auto begin = reinterpret_cast<const char *>(&package.type_boot);
     auto end   = reinterpret_cast<const char *>(&package.crc);
     auto size  = static_cast<uint16_t>(std::distance(begin, end));
-    return slow_crc16RAM(0, begin, size) == package.crc;
+    return Crc16::update(0, begin, size) == package.crc;
 }
 
-UpdaterProtocol::UpdaterProtocol(QSerialPort &port)
-    : m_port(port)
+UpdaterProtocol::UpdaterProtocol(Transport &transport, CancelToken cancelled)
+    : m_port(transport)
+    , m_cancelled(std::move(cancelled))
 {
 
 }
 
 bool UpdaterProtocol::configure()
 {
-    return m_port.setBaudRate(QSerialPort::Baud38400)
-        && m_port.setDataBits(QSerialPort::Data8)
-        && m_port.setFlowControl(QSerialPort::NoFlowControl)
-        && m_port.setParity(QSerialPort::NoParity)
-        && m_port.setRequestToSend(true)
-        && m_port.setDataTerminalReady(true);
+    return m_port.configure(kBaudRate);
 }
 
 bool UpdaterProtocol::wait(size_t size, QDeadlineTimer timer)
 {
-    while (!timer.hasExpired()) {
-        if (static_cast<size_t>(m_port.bytesAvailable()) >= size) {
-            return true;
+    while (static_cast<size_t>(m_port.bytesAvailable()) < size) {
+        if (!InterruptibleWait::readyRead(m_port, timer, m_cancelled)) {
+            return false;
         }
-        m_port.waitForReadyRead(static_cast<int>(timer.remainingTime()));
     }
-    return false;
+    return true;
 }
 
 uint8_t UpdaterProtocol::getChar()
@@ -103,7 +76,13 @@ bool UpdaterProtocol::readPackage(ETypeBoot &type, int &page, QDeadlineTimer tim
     return false;
 }
 
-bool UpdaterProtocol::writePackage(int pageNumber, int pageSizeLog, QByteArray pageData)
+int UpdaterProtocol::frameSize(int pageSize)
+{
+    return static_cast<int>(sizeof(TBootHeader)) + pageSize + static_cast<int>(sizeof(uint16_t));
+}
+
+void UpdaterProtocol::encodeFrame(char *frame, int pageNumber, int pageSizeLog,
+                                  const char *page, int pageSize)
 {
     Q_ASSERT(pageSizeLog > 0 && pageSizeLog < 16);
 
@@ -113,58 +92,54 @@ bool UpdaterProtocol::writePackage(int pageNumber, int pageSizeLog, QByteArray p
     header.type_boot     = tbWritePage;
     header.nmb_page      = static_cast<uint16_t>(pageNumber);
     header.log_page_size = static_cast<uint16_t>(pageSizeLog);
+    memcpy(frame, &header, sizeof(TBootHeader));
+    memcpy(frame + sizeof(TBootHeader), page, static_cast<size_t>(pageSize));
 
     // Вычисление контрольной суммы
     uint16_t crc;
     {
-        const void *begin = &header.type_boot;
-        uint16_t size = sizeof(TBootHeader) - sizeof(TBootHeader::start_byte);
-        crc = slow_crc16RAM(0, begin, size);
-    }
-    {
-        const void *begin = pageData.data();
-        uint16_t size = static_cast<uint16_t>(pageData.size());
-        crc = slow_crc16RAM(crc, begin, size);
+        const void *begin = frame + sizeof(TBootHeader::start_byte);
+        size_t size = sizeof(TBootHeader) - sizeof(TBootHeader::start_byte) + static_cast<size_t>(pageSize);
+        crc = Crc16::update(0, begin, size);
     }
+    memcpy(frame + sizeof(TBootHeader) + pageSize, &crc, sizeof(crc));
+}
 
-    // Запись в порт
-    {
-        auto begin = reinterpret_cast<const char *>(&header);
-        qint64 size = sizeof(TBootHeader);
-        m_port.write(begin, size);
-    }
-    m_port.write(pageData);
-    {
-        auto begin = reinterpret_cast<const char *>(&crc);
-        qint64 size = sizeof(crc);
-        m_port.write(begin, size);
+bool UpdaterProtocol::writePackage(const QByteArray &frame)
+{
+    // Кадр уже закодирован целиком и уходит одной записью
+    if (m_port.write(frame) != frame.size()) {
+        return false;
     }
-
-    // Ожидание записи
-    return m_port.waitForBytesWritten();
+    return m_port.waitForBytesWritten(kWriteTimeout);
 }
 
-bool UpdaterProtocol::writePage(int pageNumber, int pageLogSize, QByteArray pageData)
+UpdaterProtocol::PageReply UpdaterProtocol::writePage(int pageNumber, const QByteArray &frame,
+                                                      int &requested)
 {
-    QDeadlineTimer timer(5000);
+    QDeadlineTimer timer(kAnswerTimeout);
     forever {
-        if (!writePackage(pageNumber, pageLogSize, pageData)) {
-            return false;
+        if (!writePackage(frame)) {
+            return PageReply::NoAnswer;
         }
         ETypeBoot ansType;
         int ansPage;
         if (!readPackage(ansType, ansPage, timer)) {
-            return false;
+            return PageReply::NoAnswer;
         }
         if (ansType == tbAcknowledg && ansPage == pageNumber) {
-            return true;
+            return PageReply::Acknowledged;
         }
         if (ansType == tbBootQuery && ansPage == pageNumber) {
             continue ;
         }
+        if (ansType == tbBootQuery) {
+            requested = ansPage;
+            return PageReply::Requested;
+        }
         if (ansType == tbError) {
             qWarning("UpdaterProtocol::writePage(): устройство сообщило о фатальной ошибке");
-            return false;
+            return PageReply::Fatal;
         }
     }
 }
@@ -5,26 +5,63 @@
 #include <QByteArray>
 #include <QDeadlineTimer>
 
+#include "Cancelation.h"
 #include "Types.h"
 #include "BootLoad.h"
 
-class QSerialPort;
+class Transport;
 
 class UpdaterProtocol
 {
 public:
-    UpdaterProtocol(QSerialPort &device);
+    /**
+     * @brief Ответ загрузчика на переданную страницу
+     */
+    enum class PageReply
+    {
+        Acknowledged, /**< Страница записана                           */
+        Requested,    /**< Загрузчик запросил другую страницу          */
+        NoAnswer,     /**< Ответа нет; страницу можно передать повторно */
+        Fatal         /**< Загрузчик сообщил о фатальной ошибке         */
+    };
+
+    UpdaterProtocol(Transport &transport, CancelToken cancelled = CancelToken());
     bool configure();
-    bool writePage(int pageNumber, int pageLogSize, QByteArray pageData);
+    /**
+     * @brief Передать страницу и дождаться ответа загрузчика
+     *
+     * Пока загрузчик повторно запрашивает эту же страницу (ошибка CRC),
+     * кадр передается снова. Запрос страницы с большим номером означает,
+     * что подтверждение потеряно, а страница записана.
+     * @param frame кадр страницы, закодированный encodeFrame()
+     * @param[out] requested номер запрошенной страницы для Requested
+     */
+    PageReply writePage(int pageNumber, const QByteArray &frame, int &requested);
     int waitForRequest();
 
+    /**
+     * @brief Размер кадра записи страницы: заголовок, страница и CRC
+     */
+    static int frameSize(int pageSize);
+    /**
+     * @brief Закодировать кадр записи страницы
+     * @param frame буфер размером frameSize(pageSize)
+     */
+    static void encodeFrame(char *frame, int pageNumber, int pageSizeLog,
+                            const char *page, int pageSize);
+
 private:
     bool wait(size_t size, QDeadlineTimer timer);
     uint8_t getChar();
     bool readPackage(ETypeBoot &type, int &page, QDeadlineTimer timer);
-    bool writePackage(int pageNumber, int pageSizeLog, QByteArray pageData);
+    bool writePackage(const QByteArray &frame);
+
+    static constexpr qint32 kBaudRate = 38400;
+    static constexpr int kWriteTimeout = 30000;
+    static constexpr int kAnswerTimeout = 2000;
 
-    QSerialPort &m_port;
+    Transport &m_port;
+    CancelToken m_cancelled;
 };
 
 
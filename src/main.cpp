@@ -1,4 +1,5 @@
 #include <QApplication>
+#include "LinkStatistics.h"
 #include "MainWindow.h"
 
 int main(int argc, char *argv[])
@@ -14,5 +15,7 @@ int main(int argc, char *argv[])
     MainWindow window;
     window.show();
 
-    return app.exec();
+    int code = app.exec();
+    LinkStatistics::dumpAll("statistics.log");
+    return code;
 }
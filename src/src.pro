@@ -1,4 +1,4 @@
-QT += gui widgets serialport
+QT += gui widgets serialport network
 
 CONFIG += c++14
 
@@ -39,14 +39,34 @@ RC_FILE = app_resource.rc
     }
 }
 
+win32: LIBS += -lpsapi
+
 OTHER_FILES = \
     app_resource.rc
 
 HEADERS += \
     Types.h \
     Cancelation.h \
+    InterruptibleWait.h \
     Protocol.h \
+    AsyncProtocol.h \
+    FrameDecoder.h \
+    RttEstimator.h \
+    LatencyHistogram.h \
+    LinkStatistics.h \
+    Link.h \
+    Transport.h \
+    SerialTransport.h \
+    TcpTransport.h \
+    LinkReactor.h \
+    LinkSession.h \
     Device.h \
+    DeviceCache.h \
+    DeviceController.h \
+    DeviceSupervisor.h \
+    DeviceDiscovery.h \
+    PortWatcher.h \
+    PollScheduler.h \
     Modules.h \
     MainWindow.h \
     SettingsView.h \
@@ -58,8 +78,11 @@ HEADERS += \
     NameRepository.h \
     EventLog.h \
     BootLoad.h \
+    Crc16.h \
     UpdaterProtocol.h \
     Firmware.h \
+    BootFrames.h \
+    FirmwareRollout.h \
     TransactionInvoker.h \
     Transactions.h \
     SettingsSerializers.h
@@ -67,8 +90,26 @@ HEADERS += \
 SOURCES += \
     main.cpp \
     Cancelation.cpp \
+    InterruptibleWait.cpp \
     Protocol.cpp \
+    AsyncProtocol.cpp \
+    FrameDecoder.cpp \
+    RttEstimator.cpp \
+    LatencyHistogram.cpp \
+    LinkStatistics.cpp \
+    Link.cpp \
+    Transport.cpp \
+    SerialTransport.cpp \
+    TcpTransport.cpp \
+    LinkReactor.cpp \
+    LinkSession.cpp \
     Device.cpp \
+    DeviceCache.cpp \
+    DeviceController.cpp \
+    DeviceSupervisor.cpp \
+    DeviceDiscovery.cpp \
+    PortWatcher.cpp \
+    PollScheduler.cpp \
     Modules.cpp \
     MainWindow.cpp \
     SettingsView.cpp \
@@ -78,8 +119,11 @@ SOURCES += \
     ModuleViews.cpp \
     NameRepository.cpp \
     EventLog.cpp \
+    Crc16.cpp \
     UpdaterProtocol.cpp \
     Firmware.cpp \
+    BootFrames.cpp \
+    FirmwareRollout.cpp \
     TransactionInvoker.cpp \
     Transactions.cpp \
     SettingsSerializers.cpp
@@ -0,0 +1,19 @@
+QT -= gui
+QT += testlib
+
+CONFIG += c++14 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_asyncprotocol
+
+include(../core.pri)
+
+SIM = $$PWD/../../simulator
+INCLUDEPATH += $$SIM
+
+HEADERS += \
+    $$SIM/DeviceSimulator.h
+
+SOURCES += \
+    tst_AsyncProtocol.cpp \
+    $$SIM/DeviceSimulator.cpp
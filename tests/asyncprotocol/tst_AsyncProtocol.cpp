@@ -0,0 +1,151 @@
+#include <memory>
+
+#include <QSignalSpy>
+#include <QtTest>
+
+#include "AsyncProtocol.h"
+#include "Cancelation.h"
+#include "DeviceSimulator.h"
+#include "Link.h"
+#include "LoopbackTransport.h"
+#include "Transactions.h"
+
+namespace {
+
+constexpr uint32_t kSerialNumber = 42;
+constexpr int kTimeout = 15000;
+
+} // namespace
+
+/**
+ * @brief AsyncProtocol и транзакции против имитатора через LoopbackTransport
+ *
+ * Имитатор и протокол работают в одном цикле событий, без псевдотерминалов
+ * и оборудования.
+ */
+class TestAsyncProtocol : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+    void readsAllDeviceInfo();
+    void pipelinedRecoversLostReplies();
+    void pipelinedReportsMissingReply();
+
+private:
+    void connectSimulator(DeviceSimulator::Options options);
+
+    std::unique_ptr<Link> m_link;
+    std::unique_ptr<LoopbackTransport> m_deviceEnd;
+    std::unique_ptr<DeviceSimulator> m_simulator;
+    std::unique_ptr<AsyncProtocol> m_proto;
+};
+
+void TestAsyncProtocol::cleanup()
+{
+    m_proto.reset();
+    m_simulator.reset();
+    m_deviceEnd.reset();
+    m_link.reset();
+}
+
+void TestAsyncProtocol::readsAllDeviceInfo()
+{
+    connectSimulator(DeviceSimulator::Options());
+    MDM500M::GetAllDeviceInfo transaction(nullptr);
+    Interfaces::GetAllDeviceInfo::Response response {};
+    int received = 0;
+    connect(&transaction, &Interfaces::GetAllDeviceInfo::success,
+            [&](const Interfaces::GetAllDeviceInfo::Response &answer) {
+        response = answer;
+        ++received;
+    });
+    QSignalSpy finished(&transaction, &Interfaces::Transaction::finished);
+
+    CancellationSource cancellation;
+    QVERIFY(transaction.start(*m_proto, cancellation.token()));
+    QVERIFY(finished.wait(kTimeout));
+
+    QCOMPARE(received, 1);
+    QCOMPARE(response.info.serialNumber.value, kSerialNumber);
+    QVERIFY(response.info.hardwareVersion == MDM500M::kHardwareVersion);
+}
+
+void TestAsyncProtocol::pipelinedRecoversLostReplies()
+{
+    DeviceSimulator::Options options;
+    options.silence = 0.1;
+    options.seed = 7;
+    connectSimulator(options);
+
+    // Пропущенные ответы повторяются по одному; каждый пакет должен
+    // завершиться успешно
+    for (int batch = 0; batch < 5; ++batch) {
+        MDM500M::DeviceInfo info {};
+        MDM500M::DeviceConfig config {};
+        MDM500M::ErrorsPackage errors {};
+        MDM500M::SignalLevels levels {};
+        int completions = 0;
+        bool received = false;
+        m_proto->submit({
+            AsyncProtocol::get(Protocol::Command::ReadInfo, info),
+            AsyncProtocol::get(Protocol::Command::ReadConfig, config),
+            AsyncProtocol::get(Protocol::Command::ReadErrors, errors),
+            AsyncProtocol::get(Protocol::Command::ReadSignalLevels, levels)
+        }, [&](bool result) {
+            ++completions;
+            received = result;
+        }, AsyncProtocol::Mode::Pipelined);
+        QTRY_COMPARE_WITH_TIMEOUT(completions, 1, kTimeout);
+        QVERIFY(received);
+        QCOMPARE(info.serialNumber.value, kSerialNumber);
+    }
+    uint64_t timeouts = 0;
+    for (auto cmd : { Protocol::Command::ReadInfo, Protocol::Command::ReadConfig,
+                      Protocol::Command::ReadErrors, Protocol::Command::ReadSignalLevels }) {
+        timeouts += m_link->statistics().counters(cmd).timeouts;
+    }
+    QVERIFY(timeouts > 0);
+}
+
+void TestAsyncProtocol::pipelinedReportsMissingReply()
+{
+    connectSimulator(DeviceSimulator::Options());
+    m_simulator->injectFault(Protocol::Command::ReadErrors, DeviceSimulator::Fault::NoReply);
+
+    MDM500M::DeviceInfo info {};
+    MDM500M::ErrorsPackage errors {};
+    int completions = 0;
+    bool received = true;
+    m_proto->submit({
+        AsyncProtocol::get(Protocol::Command::ReadInfo, info),
+        AsyncProtocol::get(Protocol::Command::ReadErrors, errors)
+    }, [&](bool result) {
+        ++completions;
+        received = result;
+    }, AsyncProtocol::Mode::Pipelined);
+    QTRY_COMPARE_WITH_TIMEOUT(completions, 1, kTimeout);
+    QVERIFY(!received);
+    // Ответ на другой запрос пакета не теряется
+    QCOMPARE(info.serialNumber.value, kSerialNumber);
+}
+
+void TestAsyncProtocol::connectSimulator(DeviceSimulator::Options options)
+{
+    auto pair = LoopbackTransport::createPair(QTest::currentTestFunction());
+    QVERIFY(pair.first->open(QIODevice::ReadWrite));
+    QVERIFY(pair.second->open(QIODevice::ReadWrite));
+    options.serialNumber = kSerialNumber;
+    options.latency = std::chrono::milliseconds(1);
+    m_deviceEnd = std::move(pair.second);
+    m_simulator = std::make_unique<DeviceSimulator>(*m_deviceEnd, options);
+    m_link = std::make_unique<Link>();
+    m_link->setTransport(std::move(pair.first));
+    m_proto = std::make_unique<AsyncProtocol>(*m_link);
+    QVERIFY(m_proto->configure());
+}
+
+QTEST_GUILESS_MAIN(TestAsyncProtocol)
+
+#include "tst_AsyncProtocol.moc"
@@ -0,0 +1,17 @@
+QT -= gui
+QT += testlib
+
+CONFIG += c++14 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_crc16
+
+SRC = $$PWD/../../src
+INCLUDEPATH += $$SRC
+
+HEADERS += \
+    $$SRC/Crc16.h
+
+SOURCES += \
+    tst_Crc16.cpp \
+    $$SRC/Crc16.cpp
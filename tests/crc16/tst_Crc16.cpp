@@ -0,0 +1,150 @@
+#include <random>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QtTest>
+
+#include "Crc16.h"
+
+namespace {
+
+/**
+ * @brief Побитовый алгоритм загрузчика, замененный Crc16::update
+ *
+ * Оставлен без изменений как эталон.
+ */
+uint16_t slow_crc16RAM(uint16_t sum, const void *data, uint16_t len)
+{
+    auto p = reinterpret_cast<const uint8_t *>(data);
+    if(!len){
+        return sum;
+    }
+    do {
+        uint8_t i;
+        uint8_t byte = *p++;
+        for (i = 0; i < 8; ++i) {
+            uint16_t osum = sum;
+            sum <<= 1;
+            if(byte & 0x80){
+                sum |= 1 ;
+            }
+            if(osum & 0x8000){
+                sum ^= 0x1021;
+            }
+            byte <<= 1;
+        }
+    } while(--len);
+    return sum;
+}
+
+constexpr int kPageSize = 4096;
+
+} // namespace
+
+class TestCrc16 : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void emptyMessage();
+    void allInitialValuesOneByte();
+    void allTwoByteMessages();
+    void randomSplitUpdates();
+    void throughput();
+};
+
+void TestCrc16::emptyMessage()
+{
+    for (uint32_t sum = 0; sum <= 0xFFFF; ++sum) {
+        QCOMPARE(Crc16::update(static_cast<uint16_t>(sum), nullptr, 0), static_cast<uint16_t>(sum));
+    }
+}
+
+void TestCrc16::allInitialValuesOneByte()
+{
+    for (uint32_t sum = 0; sum <= 0xFFFF; ++sum) {
+        for (uint32_t byte = 0; byte <= 0xFF; ++byte) {
+            const uint8_t message = static_cast<uint8_t>(byte);
+            const auto expected = slow_crc16RAM(static_cast<uint16_t>(sum), &message, 1);
+            const auto actual = Crc16::update(static_cast<uint16_t>(sum), &message, 1);
+            if (actual != expected) {
+                QFAIL(qPrintable(QString("sum %1, byte %2: %3 != %4")
+                                 .arg(sum, 4, 16, QChar('0')).arg(byte, 2, 16, QChar('0'))
+                                 .arg(actual, 4, 16, QChar('0')).arg(expected, 4, 16, QChar('0'))));
+            }
+        }
+    }
+}
+
+void TestCrc16::allTwoByteMessages()
+{
+    // Все двухбайтные сообщения для 256 начальных значений, покрывающих
+    // каждое значение старшего и младшего байта регистра
+    for (uint32_t sum = 0; sum <= 0xFFFF; sum += 0x0101) {
+        for (uint32_t word = 0; word <= 0xFFFF; ++word) {
+            const uint8_t message[2] = { static_cast<uint8_t>(word >> 8), static_cast<uint8_t>(word) };
+            const auto expected = slow_crc16RAM(static_cast<uint16_t>(sum), message, 2);
+            const auto actual = Crc16::update(static_cast<uint16_t>(sum), message, 2);
+            if (actual != expected) {
+                QFAIL(qPrintable(QString("sum %1, message %2: %3 != %4")
+                                 .arg(sum, 4, 16, QChar('0')).arg(word, 4, 16, QChar('0'))
+                                 .arg(actual, 4, 16, QChar('0')).arg(expected, 4, 16, QChar('0'))));
+            }
+        }
+    }
+}
+
+void TestCrc16::randomSplitUpdates()
+{
+    std::mt19937 random(20201017);
+    std::uniform_int_distribution<int> length(0, 600);
+    std::uniform_int_distribution<int> byte(0, 0xFF);
+    std::uniform_int_distribution<int> word(0, 0xFFFF);
+    std::vector<uint8_t> message;
+    for (int i = 0; i < 200000; ++i) {
+        message.resize(static_cast<size_t>(length(random)));
+        for (auto &&b : message) {
+            b = static_cast<uint8_t>(byte(random));
+        }
+        const auto sum = static_cast<uint16_t>(word(random));
+        const auto size = static_cast<uint16_t>(message.size());
+        const auto expected = slow_crc16RAM(sum, message.data(), size);
+        QCOMPARE(Crc16::update(sum, message.data(), size), expected);
+        // Продолжение суммы по частям, как заголовок и страница в UpdaterProtocol
+        const auto split = std::uniform_int_distribution<size_t>(0, message.size())(random);
+        auto partial = Crc16::update(sum, message.data(), split);
+        partial = Crc16::update(partial, message.data() + split, message.size() - split);
+        QCOMPARE(partial, expected);
+    }
+}
+
+void TestCrc16::throughput()
+{
+    constexpr int kPages = 16384; // 64 МиБ
+    std::vector<uint8_t> page(kPageSize);
+    std::mt19937 random(1);
+    for (auto &&b : page) {
+        b = static_cast<uint8_t>(random());
+    }
+    auto measure = [&](auto &&crc) {
+        uint16_t sum = 0;
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < kPages; ++i) {
+            sum = crc(sum, page.data(), static_cast<uint16_t>(page.size()));
+        }
+        const auto seconds = std::max<qint64>(timer.nsecsElapsed(), 1) / 1e9;
+        return std::make_pair(sum, kPages * double(kPageSize) / seconds / 1e6);
+    };
+    const auto reference = measure(slow_crc16RAM);
+    const auto table = measure([](uint16_t sum, const void *data, uint16_t size) {
+        return Crc16::update(sum, data, size);
+    });
+    QCOMPARE(table.first, reference.first);
+    qInfo("Страница %d байт: побитовый %.0f МБ/с, табличный %.0f МБ/с (x%.1f)",
+          kPageSize, reference.second, table.second, table.second / reference.second);
+}
+
+QTEST_APPLESS_MAIN(TestCrc16)
+
+#include "tst_Crc16.moc"
@@ -0,0 +1,17 @@
+QT -= gui
+QT += testlib
+
+CONFIG += c++14 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_framedecoder
+
+SRC = $$PWD/../../src
+INCLUDEPATH += $$SRC
+
+HEADERS += \
+    $$SRC/FrameDecoder.h
+
+SOURCES += \
+    tst_FrameDecoder.cpp \
+    $$SRC/FrameDecoder.cpp
@@ -0,0 +1,168 @@
+#include <vector>
+
+#include <QBuffer>
+#include <QtTest>
+
+#include "FrameDecoder.h"
+
+namespace {
+
+struct Frame
+{
+    uint8_t cmd;
+    QByteArray data;
+};
+
+/**
+ * @brief Собрать пакет: маркер, размер, команда, данные и КС
+ */
+QByteArray encode(uint8_t cmd, const QByteArray &data)
+{
+    QByteArray frame;
+    frame.append(static_cast<char>(FrameDecoder::kPackageMarker));
+    frame.append(static_cast<char>(FrameDecoder::kMinValueOfSizeField + data.size()));
+    frame.append(static_cast<char>(cmd));
+    frame.append(data);
+    uint8_t crc = 0;
+    for (int i = 1; i < frame.size(); ++i) {
+        crc = static_cast<uint8_t>(crc + static_cast<uint8_t>(frame[i]));
+    }
+    frame.append(static_cast<char>(crc));
+    return frame;
+}
+
+/**
+ * @brief Данные без байта маркера, чтобы в них не начинался ложный пакет
+ */
+QByteArray payload(int size, int seed)
+{
+    QByteArray data;
+    for (int i = 0; i < size; ++i) {
+        auto byte = static_cast<uint8_t>(seed + i * 3);
+        if (byte == FrameDecoder::kPackageMarker) {
+            byte = 0;
+        }
+        data.append(static_cast<char>(byte));
+    }
+    return data;
+}
+
+/**
+ * @brief Передать байты декодеру методом fill(), как из порта
+ */
+int feed(FrameDecoder &decoder, const QByteArray &bytes)
+{
+    QBuffer device;
+    device.setData(bytes);
+    device.open(QIODevice::ReadOnly);
+    return decoder.fill(device);
+}
+
+/**
+ * @brief Извлечь из декодера все готовые пакеты
+ */
+void drain(FrameDecoder &decoder, std::vector<Frame> &frames)
+{
+    while (decoder.decode([&](uint8_t cmd, const void *data, int size) {
+        frames.push_back({ cmd, QByteArray(static_cast<const char *>(data), size) });
+        return true;
+    })) {
+    }
+}
+
+} // namespace
+
+class TestFrameDecoder : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void skipsJunkBeforeMarker();
+    void joinsFrameSplitAcrossFills();
+    void decodesAcrossRingWrapAround();
+    void rejectsBadCrc();
+};
+
+void TestFrameDecoder::skipsJunkBeforeMarker()
+{
+    FrameDecoder decoder;
+    const auto data = payload(5, 1);
+    QCOMPARE(feed(decoder, payload(40, 7) + encode(4, data)), 40 + 9);
+
+    std::vector<Frame> frames;
+    drain(decoder, frames);
+    QCOMPARE(static_cast<int>(frames.size()), 1);
+    QCOMPARE(frames[0].cmd, uint8_t(4));
+    QCOMPARE(frames[0].data, data);
+    QCOMPARE(decoder.size(), 0);
+    QCOMPARE(decoder.rejectedCount(), 0);
+}
+
+void TestFrameDecoder::joinsFrameSplitAcrossFills()
+{
+    FrameDecoder decoder;
+    const auto data = payload(20, 2);
+    const auto frame = encode(1, data);
+    std::vector<Frame> frames;
+
+    // Пакет приходит по частям: маркер, заголовок, данные, КС
+    for (int split : { 1, 3, 15 }) {
+        feed(decoder, frame.mid(0, split));
+        drain(decoder, frames);
+        QVERIFY(frames.empty());
+        feed(decoder, frame.mid(split));
+        drain(decoder, frames);
+        QCOMPARE(static_cast<int>(frames.size()), 1);
+        QCOMPARE(frames[0].data, data);
+        frames.clear();
+    }
+    QCOMPARE(decoder.rejectedCount(), 0);
+}
+
+void TestFrameDecoder::decodesAcrossRingWrapAround()
+{
+    // Порции не совпадают с границами пакетов, поэтому буфер не пустеет
+    // и начало сдвигается по кольцу, а часть пакетов разрывается его концом
+    constexpr int kFrames = 24;
+    constexpr int kChunk = 150;
+    QByteArray stream;
+    for (int i = 0; i < kFrames; ++i) {
+        stream.append(encode(static_cast<uint8_t>(i), payload(100, i)));
+    }
+    QVERIFY(stream.size() > 2 * FrameDecoder::kCapacity);
+
+    FrameDecoder decoder;
+    std::vector<Frame> frames;
+    for (int pos = 0; pos < stream.size(); pos += kChunk) {
+        feed(decoder, stream.mid(pos, kChunk));
+        drain(decoder, frames);
+    }
+
+    QCOMPARE(static_cast<int>(frames.size()), kFrames);
+    for (int i = 0; i < kFrames; ++i) {
+        QCOMPARE(frames[static_cast<size_t>(i)].cmd, static_cast<uint8_t>(i));
+        QCOMPARE(frames[static_cast<size_t>(i)].data, payload(100, i));
+    }
+    QCOMPARE(decoder.rejectedCount(), 0);
+}
+
+void TestFrameDecoder::rejectsBadCrc()
+{
+    auto corrupted = encode(2, payload(8, 3));
+    corrupted[corrupted.size() - 1] = static_cast<char>(corrupted[corrupted.size() - 1] + 1);
+
+    FrameDecoder decoder;
+    feed(decoder, encode(1, payload(4, 1)) + corrupted + encode(3, payload(6, 5)));
+    std::vector<Frame> frames;
+    drain(decoder, frames);
+
+    // Синхронизация восстанавливается на следующем пакете
+    QCOMPARE(static_cast<int>(frames.size()), 2);
+    QCOMPARE(frames[0].cmd, uint8_t(1));
+    QCOMPARE(frames[1].cmd, uint8_t(3));
+    QCOMPARE(decoder.rejectedCount(), 1);
+}
+
+QTEST_APPLESS_MAIN(TestFrameDecoder)
+
+#include "tst_FrameDecoder.moc"
@@ -0,0 +1,12 @@
+QT -= gui
+QT += testlib
+
+CONFIG += c++14 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_linksession
+
+include(../core.pri)
+
+SOURCES += \
+    tst_LinkSession.cpp
@@ -0,0 +1,113 @@
+#include <QtTest>
+
+#include "LinkSession.h"
+#include "Transactions.h"
+
+namespace {
+
+/**
+ * @brief Команда оператора, которая только записывает свой запуск
+ *
+ * Команды с одинаковым неотрицательным slot вытесняют друг друга, как
+ * SetModuleConfig одного модуля.
+ */
+class FakeTransaction : public Interfaces::Transaction
+{
+public:
+    FakeTransaction(QString name, int slot, QStringList &started, bool hold = false)
+        : m_name(std::move(name))
+        , m_slot(slot)
+        , m_started(started)
+        , m_hold(hold)
+    {}
+
+    Priority priority() const override
+    {
+        return Priority::Interactive;
+    }
+
+    bool supersedes(const Transaction &older) const override
+    {
+        auto fake = dynamic_cast<const FakeTransaction *>(&older);
+        return fake && m_slot >= 0 && fake->m_slot == m_slot;
+    }
+
+    bool start(AsyncProtocol &, CancelToken) override
+    {
+        m_started << m_name;
+        if (!m_hold) {
+            emit finished();
+        }
+        return true;
+    }
+
+    void release()
+    {
+        emit finished();
+    }
+
+private:
+    QString m_name;
+    int m_slot;
+    QStringList &m_started;
+    bool m_hold;
+};
+
+} // namespace
+
+class TestLinkSession : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void supersedingKeepsOrder();
+    void supersedingDropsAll();
+};
+
+void TestLinkSession::supersedingKeepsOrder()
+{
+    QStringList started;
+    QStringList abandoned;
+    CancellationSource cancellation;
+    LinkSession session(cancellation.token());
+
+    // Пока выполняется первая команда, остальные ждут в очереди
+    auto busy = new FakeTransaction("busy", -1, started, true);
+    session.enqueue(busy);
+    QCOMPARE(started, QStringList { "busy" });
+
+    auto first = new FakeTransaction("config A", 1, started);
+    connect(first, &Interfaces::Transaction::abandoned, [&] { abandoned << "config A"; });
+    session.enqueue(first);
+    session.enqueue(new FakeTransaction("save", -1, started));
+    session.enqueue(new FakeTransaction("config B", 1, started));
+    QCOMPARE(abandoned, QStringList { "config A" });
+
+    // Сохранение поставлено раньше B и должно выполниться раньше него
+    busy->release();
+    QTRY_COMPARE(started, (QStringList { "busy", "save", "config B" }));
+}
+
+void TestLinkSession::supersedingDropsAll()
+{
+    QStringList started;
+    int abandoned = 0;
+    CancellationSource cancellation;
+    LinkSession session(cancellation.token());
+
+    auto busy = new FakeTransaction("busy", -1, started, true);
+    session.enqueue(busy);
+    for (int i = 0; i < 5; ++i) {
+        auto transaction = new FakeTransaction(QString("config %1").arg(i), 1, started);
+        connect(transaction, &Interfaces::Transaction::abandoned, [&] { ++abandoned; });
+        session.enqueue(transaction);
+    }
+    QCOMPARE(abandoned, 4);
+
+    busy->release();
+    QTRY_COMPARE(started, (QStringList { "busy", "config 4" }));
+}
+
+QTEST_GUILESS_MAIN(TestLinkSession)
+
+#include "tst_LinkSession.moc"
@@ -0,0 +1,21 @@
+QT -= gui
+QT += testlib
+
+CONFIG += c++14 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_rollout
+
+include(../core.pri)
+
+SIM = $$PWD/../../simulator
+INCLUDEPATH += $$SIM
+
+HEADERS += \
+    $$SIM/DeviceSimulator.h \
+    $$SIM/PtyMasterTransport.h
+
+SOURCES += \
+    tst_FirmwareRollout.cpp \
+    $$SIM/DeviceSimulator.cpp \
+    $$SIM/PtyMasterTransport.cpp
@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "BootLoad.h"
+#include "DeviceCache.h"
+#include "DeviceController.h"
+#include "DeviceDiscovery.h"
+#include "DeviceSimulator.h"
+#include "DeviceSupervisor.h"
+#include "EventLog.h"
+#include "Firmware.h"
+#include "FirmwareRollout.h"
+#include "LinkReactor.h"
+#include "Modules.h"
+#include "NameRepository.h"
+#include "PtyMasterTransport.h"
+
+namespace {
+
+constexpr int kPageCount = 8;
+constexpr int kPageData = 64;
+constexpr int kDiscoveryTimeout = 20000;
+constexpr int kRolloutTimeout = 60000;
+
+/**
+ * @brief Записать файл прошивки МДМ-500М из kPageCount страниц
+ */
+bool writeFirmware(const QString &fileName)
+{
+    TFileHeader header {};
+    memcpy(header.ID, "BOOT_FILE", sizeof(header.ID));
+    header.NumPages = kPageCount;
+    header.PageSize = sizeof(TPageHeader) + kPageData;
+    header.HardwareVersion = MDM500M::kHardwareVersion;
+    header.CListLength = 1;
+    header.SCListLength = 1;
+
+    QByteArray bytes(reinterpret_cast<const char *>(&header), sizeof(header));
+    auto append = [&bytes](uint16_t value) {
+        bytes.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    };
+    append(MDM500M::kHardwareVersion.modification);
+    const SoftwareVersion version(3, 2, 0, 0);
+    uint16_t rawVersion;
+    memcpy(&rawVersion, &version, sizeof(rawVersion));
+    append(rawVersion);
+    append(0); // Контрольная сумма файла не проверяется
+    for (int i = 0; i < kPageCount * header.PageSize; ++i) {
+        bytes.append(static_cast<char>(i * 7));
+    }
+
+    QFile file(fileName);
+    return file.open(QIODevice::WriteOnly) && file.write(bytes) == bytes.size();
+}
+
+} // namespace
+
+/**
+ * @brief Обновление прошивки группы имитаторов на псевдотерминалах
+ *
+ * Устройства находит и читает DeviceSupervisor, как в mdm500m-daemon;
+ * порядок устройств - по возрастанию адреса, первое из них контрольное.
+ */
+class TestFirmwareRollout : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanup();
+    void updatesAllDevices();
+    void failedCanaryHalts();
+    void skippedCanaryIsReplaced();
+    void failuresHaltAfterCanaries();
+
+private:
+    bool startDevices(int count);
+    DeviceSimulator &simulator(const DeviceController *controller) const;
+
+    QTemporaryDir m_dir;
+    Firmware m_firmware;
+    std::shared_ptr<LinkReactor> m_reactor;
+    std::vector<std::unique_ptr<PtyMasterTransport>> m_transports;
+    std::vector<std::unique_ptr<DeviceSimulator>> m_simulators;
+    std::unique_ptr<DeviceSupervisor> m_supervisor;
+};
+
+void TestFirmwareRollout::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    EventLog::setBaseDirectory(m_dir.path());
+    const auto fileName = m_dir.filePath("firmware.bsk");
+    QVERIFY(writeFirmware(fileName));
+    m_firmware = Firmware(fileName);
+    QVERIFY2(!m_firmware.isError(), qPrintable(m_firmware.errorString()));
+    QCOMPARE(m_firmware.pageCount(), kPageCount);
+    QVERIFY(m_firmware.isCompatible(MDM500M::kHardwareVersion));
+    m_reactor = std::make_shared<LinkReactor>();
+}
+
+void TestFirmwareRollout::cleanup()
+{
+    m_supervisor.reset();
+    m_simulators.clear();
+    m_transports.clear();
+}
+
+void TestFirmwareRollout::updatesAllDevices()
+{
+    QVERIFY(startDevices(3));
+    FirmwareRollout rollout(m_firmware, m_supervisor->controllers());
+    FirmwareRollout::Settings settings;
+    settings.parallelism = 2;
+    settings.canaries = 1;
+    rollout.setSettings(settings);
+
+    QStringList events;
+    int running = 0;
+    int maxRunning = 0;
+    connect(&rollout, &FirmwareRollout::deviceStarted, [&](DeviceController *) {
+        maxRunning = std::max(maxRunning, ++running);
+        events << "started";
+    });
+    connect(&rollout, &FirmwareRollout::deviceFinished, [&](DeviceController *, bool) {
+        --running;
+        events << "finished";
+    });
+    QSignalSpy finished(&rollout, &FirmwareRollout::finished);
+    rollout.start();
+    QVERIFY(finished.wait(kRolloutTimeout));
+
+    QCOMPARE(finished.first().first().toBool(), true);
+    QCOMPARE(rollout.count(FirmwareRollout::State::Succeeded), 3);
+    // Остальные устройства ждут контрольное, а затем идут по два
+    QCOMPARE(events.mid(0, 3), (QStringList { "started", "finished", "started" }));
+    QCOMPARE(maxRunning, 2);
+}
+
+void TestFirmwareRollout::failedCanaryHalts()
+{
+    QVERIFY(startDevices(3));
+    auto devices = m_supervisor->controllers();
+    simulator(devices[0]).injectFault(Protocol::Command::Reboot, DeviceSimulator::Fault::NoReply);
+    FirmwareRollout rollout(m_firmware, devices);
+
+    QSignalSpy finished(&rollout, &FirmwareRollout::finished);
+    rollout.start();
+    QVERIFY(finished.wait(kRolloutTimeout));
+
+    QCOMPARE(finished.first().first().toBool(), false);
+    QCOMPARE(rollout.state(devices[0]), FirmwareRollout::State::Failed);
+    QCOMPARE(rollout.state(devices[1]), FirmwareRollout::State::Skipped);
+    QCOMPARE(rollout.state(devices[2]), FirmwareRollout::State::Skipped);
+}
+
+void TestFirmwareRollout::skippedCanaryIsReplaced()
+{
+    QVERIFY(startDevices(3));
+    auto devices = m_supervisor->controllers();
+    simulator(devices[0]).injectFault(Protocol::Command::Reboot, DeviceSimulator::Fault::NoReply);
+    // Первое устройство списка отключено до начала и пропускается
+    devices.insert(devices.begin(), nullptr);
+    FirmwareRollout rollout(m_firmware, devices);
+    FirmwareRollout::Settings settings;
+    settings.parallelism = 2;
+    settings.canaries = 1;
+    rollout.setSettings(settings);
+
+    QSignalSpy finished(&rollout, &FirmwareRollout::finished);
+    rollout.start();
+    QVERIFY(finished.wait(kRolloutTimeout));
+
+    // Контрольным становится следующее устройство, и его отказ
+    // останавливает обновление
+    QCOMPARE(finished.first().first().toBool(), false);
+    QCOMPARE(rollout.state(devices[0]), FirmwareRollout::State::Skipped);
+    QCOMPARE(rollout.state(devices[1]), FirmwareRollout::State::Failed);
+    QCOMPARE(rollout.state(devices[2]), FirmwareRollout::State::Skipped);
+    QCOMPARE(rollout.state(devices[3]), FirmwareRollout::State::Skipped);
+}
+
+void TestFirmwareRollout::failuresHaltAfterCanaries()
+{
+    QVERIFY(startDevices(4));
+    auto devices = m_supervisor->controllers();
+    simulator(devices[1]).injectFault(Protocol::Command::Reboot, DeviceSimulator::Fault::NoReply);
+    simulator(devices[2]).injectFault(Protocol::Command::Reboot, DeviceSimulator::Fault::NoReply);
+    FirmwareRollout rollout(m_firmware, devices);
+    FirmwareRollout::Settings settings;
+    settings.parallelism = 1;
+    settings.canaries = 1;
+    settings.maxFailures = 2;
+    rollout.setSettings(settings);
+
+    QSignalSpy finished(&rollout, &FirmwareRollout::finished);
+    rollout.start();
+    QVERIFY(finished.wait(kRolloutTimeout));
+
+    QCOMPARE(finished.first().first().toBool(), false);
+    QCOMPARE(rollout.state(devices[0]), FirmwareRollout::State::Succeeded);
+    QCOMPARE(rollout.state(devices[1]), FirmwareRollout::State::Failed);
+    QCOMPARE(rollout.state(devices[2]), FirmwareRollout::State::Failed);
+    QCOMPARE(rollout.state(devices[3]), FirmwareRollout::State::Skipped);
+}
+
+bool TestFirmwareRollout::startDevices(int count)
+{
+    using std::chrono::milliseconds;
+
+    DeviceSimulator::Options options;
+    options.latency = milliseconds(1);
+    options.bootWait = milliseconds(300);
+    options.bootTime = milliseconds(100);
+    QStringList addresses;
+    for (int i = 0; i < count; ++i) {
+        auto transport = std::make_unique<PtyMasterTransport>();
+        if (!transport->open(QIODevice::ReadWrite)) {
+            qWarning("Не удалось создать псевдотерминал: %s", qPrintable(transport->errorString()));
+            return false;
+        }
+        options.serialNumber = static_cast<uint32_t>(i + 1);
+        options.seed = static_cast<quint32>(i);
+        m_simulators.push_back(std::make_unique<DeviceSimulator>(*transport, options));
+        addresses << transport->address();
+        m_transports.push_back(std::move(transport));
+    }
+
+    auto cache = std::make_shared<DeviceCache>(m_dir.filePath("devices.cache.ini"));
+    m_supervisor = std::make_unique<DeviceSupervisor>(m_reactor, addresses, cache);
+    m_supervisor->discovery().setSerialPortsScanned(false);
+    DeviceControllerBuilder builder;
+    builder.type = DeviceType::MDM500M;
+    builder.moduleFabric = std::make_shared<ModuleFabric>();
+    builder.nameRepo = std::make_shared<NameRepository>(new QFile(m_dir.filePath("devices.xml")));
+    builder.transactionFabric = std::make_shared<MDM500M::TransactionFabric>();
+    m_supervisor->setBuilder(DeviceType::MDM500M, builder);
+    m_supervisor->start();
+
+    return QTest::qWaitFor([&] {
+        auto controllers = m_supervisor->controllers();
+        return static_cast<int>(controllers.size()) == count
+                && std::all_of(controllers.begin(), controllers.end(), [](DeviceController *controller) {
+            return controller->isReady();
+        });
+    }, kDiscoveryTimeout);
+}
+
+DeviceSimulator &TestFirmwareRollout::simulator(const DeviceController *controller) const
+{
+    for (std::size_t i = 0; i < m_transports.size(); ++i) {
+        if (m_transports[i]->address() == controller->address()) {
+            return *m_simulators[i];
+        }
+    }
+    qFatal("Нет имитатора для %s", qPrintable(controller->address()));
+}
+
+QTEST_GUILESS_MAIN(TestFirmwareRollout)
+
+#include "tst_FirmwareRollout.moc"
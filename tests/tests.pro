@@ -0,0 +1,6 @@
+TEMPLATE = subdirs
+
+SUBDIRS = crc16 framedecoder linksession asyncprotocol
+
+# Имитатор работает через псевдотерминалы
+unix: SUBDIRS += rollout